@@ -70,8 +70,30 @@ void dcmiInit(void) {
  * @init
  */
 void dcmiObjectInit(DCMIDriver *dcmip) {
+	unsigned i;
 	dcmip->state = DCMI_STOP;
 	dcmip->config = NULL;
+	dcmip->band_buf = NULL;
+	dcmip->band_size = 0;
+	dcmip->band_lines = 0;
+	dcmip->frame_lines = 0;
+	dcmip->band_row = 0;
+	dcmip->frame_start = 0;
+	dcmip->frames = 0;
+	dcmip->overruns = 0;
+	dcmip->dma_errors = 0;
+	dcmip->fifo_errors = 0;
+	dcmip->crop.hoffcnt = 0;
+	dcmip->crop.vst = 0;
+	dcmip->crop.capcnt = 0;
+	dcmip->crop.vline = 0;
+	dcmip->thread = NULL;
+	dcmip->recoveries = 0;
+	for(i = 0; i < DCMI_RECOVERY_HIST_BINS; i++) {
+		dcmip->recovery_hist[i] = 0;
+	}
+	dcmip->recovery_start = 0;
+	dcmip->transaction_words = 0;
 #if defined(DCMI_DRIVER_EXT_INIT_HOOK)
 	DCMI_DRIVER_EXT_INIT_HOOK(dcmip); // Needed??
 #endif
@@ -97,14 +119,58 @@ void dcmiObjectInit(DCMIDriver *dcmip) {
  */
 void dcmiPrepare(DCMIDriver *dcmip, const DCMIConfig *config, uint32_t transactionSize, void* rxbuf0, void* rxbuf1) {
 	osalDbgCheck((dcmip != NULL) && (config != NULL) && (transactionSize < (65536*4)) && ((transactionSize%4)==0) && (rxbuf0 != NULL));
+	/* Bursts must not cross a 1 KB boundary, aligning the buffers on the burst size guarantees it.*/
+	uint32_t burst = dcmi_lld_burst_size(config);
+	osalDbgCheck((burst != 0) && ((transactionSize % burst) == 0) && (((uint32_t)rxbuf0 % burst) == 0) && (((uint32_t)rxbuf1 % burst) == 0));
 	osalSysLock();
 	osalDbgAssert((dcmip->state == DCMI_STOP), "invalid state");
 	dcmip->config = config;
+	dcmip->band_lines = 0;
 	dcmi_lld_prepare(dcmip, transactionSize, rxbuf0, rxbuf1);
 	dcmip->state = DCMI_READY;
 	osalSysUnlock();
 }
 
+ /**
+ * @brief   Configures the DCMI peripheral for band streaming.
+ * @details Instead of whole frames, the DMA fills a ring buffer of two bands
+ *          of bandLines rows each. The band callback (band_cb) is invoked
+ *          from the DMA interrupt as soon as a band is complete, so that it can
+ *          be processed while the rest of the frame is still being received.
+ *          The callback must be done with the band before the DMA comes back
+ *          to it, i.e. within one band period.
+ * @post    At the end of each frame the configured callback
+ *          (frame_end_cb) is invoked. The transfer complete callback is not
+ *          used in this mode.
+ *
+ * @param[in] dcmip				pointer to the @p DCMIDriver object
+ * @param[in] config			pointer to the @p DCMIConfig object, band_cb must be set
+ * @param[in] lineSize			size of an image row, in bytes
+ * @param[in] bandLines			number of rows per band
+ * @param[in] frameLines		number of rows per frame, must be a multiple of bandLines
+ * @param[out] ringbuf			the pointer to the ring buffer, 2 * lineSize * bandLines bytes
+ *
+ * @api
+ */
+void dcmiPrepareBands(DCMIDriver *dcmip, const DCMIConfig *config, uint32_t lineSize, uint16_t bandLines, uint16_t frameLines, void* ringbuf) {
+	uint32_t bandSize = lineSize * bandLines;
+	osalDbgCheck((dcmip != NULL) && (config != NULL) && (config->band_cb != NULL) && (ringbuf != NULL));
+	osalDbgCheck((bandLines > 0) && ((frameLines % bandLines) == 0) && ((bandSize % 4) == 0) && ((2 * bandSize) < (65536*4)));
+	uint32_t burst = dcmi_lld_burst_size(config);
+	osalDbgCheck((burst != 0) && ((bandSize % burst) == 0) && (((uint32_t)ringbuf % burst) == 0));
+	osalSysLock();
+	osalDbgAssert((dcmip->state == DCMI_STOP), "invalid state");
+	dcmip->config = config;
+	dcmip->band_buf = (uint8_t *)ringbuf;
+	dcmip->band_size = bandSize;
+	dcmip->band_lines = bandLines;
+	dcmip->frame_lines = frameLines;
+	dcmip->band_row = 0;
+	dcmi_lld_prepare(dcmip, 2 * bandSize, ringbuf, NULL);
+	dcmip->state = DCMI_READY;
+	osalSysUnlock();
+}
+
 /**
  * @brief Deactivates the DCMI peripheral.
  * @details This function disable the DCMI and related interrupts; also the DMA is released.
@@ -167,19 +233,168 @@ void dcmiStartStream(DCMIDriver *dcmip) {
  * @api
  */
 msg_t dcmiStopStream(DCMIDriver *dcmip) {
-	osalDbgCheck((dcmip != NULL));
+	return dcmiStopStreamTimeout(dcmip, OSAL_MS2ST(200));
+}
+
+ /**
+ * @brief   Captures a single frame from the DCMI and waits for it.
+ * @details The calling thread is suspended until the frame end interrupt,
+ *          after the frame_end_cb callback was invoked.
+ * @note    On timeout the capture is cancelled, but if a frame had already
+ *          started the DMA may hold part of it; the driver should then be
+ *          prepared again to restart from the beginning of the buffer.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The operation status.
+ * @retval MSG_OK       if the frame was captured.
+ * @retval MSG_TIMEOUT  if no frame was captured within the timeout.
+ * @retval MSG_RESET    if a DCMI or DMA error occurred.
+ *
+ * @api
+ */
+msg_t dcmiCaptureTimeout(DCMIDriver *dcmip, systime_t timeout) {
+	msg_t msg;
+	osalDbgCheck((dcmip != NULL));
 	osalSysLock();
-	osalDbgAssert(dcmip->state == DCMI_ACTIVE_STREAM, "not ready");
-    msg_t ret = dcmi_lld_stop_stream(dcmip);
-	if(ret == MSG_OK) {
+	osalDbgAssert(dcmip->state == DCMI_READY, "not ready");
+	dcmiStartOneShotI(dcmip);
+	msg = osalThreadSuspendTimeoutS(&dcmip->thread, timeout);
+	if(msg == MSG_TIMEOUT) {
+		dcmi_lld_request_stop(dcmip);
 		dcmip->state = DCMI_READY;
-	} else {
+	}
+	osalSysUnlock();
+	return msg;
+}
+
+ /**
+ * @brief   Stops reception of frames from the DCMI and waits for it.
+ * @details The frame being received, if any, is completed first. The calling
+ *          thread sleeps until the frame end interrupt instead of polling
+ *          the CAPTURE bit. A stream recovering from an error stops at once.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The operation status.
+ * @retval MSG_OK       if the capture is stopped.
+ * @retval MSG_TIMEOUT  if the current frame did not end within the timeout,
+ *                      the driver goes to the @p DCMI_TIMEOUT state.
+ * @retval MSG_RESET    if a DCMI or DMA error occurred.
+ *
+ * @api
+ */
+msg_t dcmiStopStreamTimeout(DCMIDriver *dcmip, systime_t timeout) {
+	msg_t msg = MSG_OK;
+	osalDbgCheck((dcmip != NULL));
+	osalSysLock();
+	osalDbgAssert((dcmip->state == DCMI_ACTIVE_STREAM) || (dcmip->state == DCMI_RECOVERING), "not ready");
+	dcmi_lld_request_stop(dcmip);
+	/* Between two frames the hardware stops at once, otherwise at the frame end.*/
+	if(dcmi_lld_is_capturing(dcmip)) {
+		msg = osalThreadSuspendTimeoutS(&dcmip->thread, timeout);
+		if((msg == MSG_OK) && dcmi_lld_is_capturing(dcmip)) {
+			msg = MSG_TIMEOUT;
+		}
+	}
+	if(msg == MSG_OK) {
+		dcmip->state = DCMI_READY;
+	} else if(msg == MSG_TIMEOUT) {
 		dcmip->state = DCMI_TIMEOUT;
-	}
+	}
 	osalSysUnlock();
-	return ret;
+	return msg;
 }
 
+/**
+ * @brief   Returns the index of the double buffering memory the DMA is not
+ *          writing to.
+ * @details From the transfer complete callback, this is the buffer that was
+ *          just filled.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @return              0 for rxbuf0, 1 for rxbuf1.
+ *
+ * @xclass
+ */
+uint8_t dcmiGetIdleBufferIndexX(DCMIDriver *dcmip) {
+	osalDbgCheck(dcmip != NULL);
+	return dcmi_lld_get_idle_buffer(dcmip);
+}
+
+/**
+ * @brief   Replaces the idle double buffering memory.
+ * @details Called from the transfer complete callback, this lets the
+ *          application hand a new buffer to the DMA in place of the one that
+ *          was just filled. Rotating through more than two buffers this way
+ *          means a filled buffer is never written again while a consumer
+ *          still reads it.
+ * @note    The DMA switches to the new buffer once the current one is full,
+ *          so the replacement must happen within one buffer period.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] buf       the new buffer, same size and alignment as the others
+ *
+ * @iclass
+ */
+void dcmiSetIdleBufferI(DCMIDriver *dcmip, void *buf) {
+	osalDbgCheck((dcmip != NULL) && (buf != NULL) && (dcmip->config != NULL));
+	osalDbgCheck(((uint32_t)buf % dcmi_lld_burst_size(dcmip->config)) == 0);
+	osalDbgAssert((dcmip->dmamode & STM32_DMA_CR_DBM) != 0, "double buffering required");
+	dcmi_lld_set_idle_buffer(dcmip, buf);
+}
+
+/**
+ * @brief   Sets the crop window.
+ * @details The window is kept by the driver and programmed again by every
+ *          @p dcmiPrepare(). If the driver is already prepared the crop
+ *          registers are updated immediately, which is only a couple of
+ *          register writes, and the hardware uses them from the next frame.
+ * @note    Moving the window is always possible, but if its size changes the
+ *          DMA transaction size must be updated as well by preparing the
+ *          driver again.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] crop      the crop window, or @p NULL to capture whole frames
+ *
+ * @iclass
+ */
+void dcmiSetCropI(DCMIDriver *dcmip, const DCMICrop *crop) {
+	osalDbgCheck(dcmip != NULL);
+	if(crop == NULL) {
+		dcmip->crop.capcnt = 0;
+	} else {
+		osalDbgCheck((crop->capcnt > 0) && (crop->vline > 0) && ((crop->capcnt % 4) == 0));
+		dcmip->crop = *crop;
+	}
+	if(dcmip->state != DCMI_STOP && dcmip->state != DCMI_UNINIT) {
+		dcmi_lld_set_crop(dcmip);
+	}
+}
+
+/**
+ * @brief   Sets the crop window.
+ * @see     dcmiSetCropI()
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] crop      the crop window, or @p NULL to capture whole frames
+ *
+ * @api
+ */
+void dcmiSetCrop(DCMIDriver *dcmip, const DCMICrop *crop) {
+	osalSysLock();
+	dcmiSetCropI(dcmip, crop);
+	osalSysUnlock();
+}
+
 #endif /* HAL_USE_DCMI */
 
 /** @} */
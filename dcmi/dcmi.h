@@ -34,6 +34,23 @@
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
+
+/**
+ * @brief   Number of bins of the recovery time histogram.
+ * @details Bin 0 counts recoveries shorter than
+ *          @p DCMI_RECOVERY_HIST_FIRST_MS, each following bin is twice as
+ *          wide and the last one counts everything longer.
+ */
+#if !defined(DCMI_RECOVERY_HIST_BINS) || defined(__DOXYGEN__)
+#define DCMI_RECOVERY_HIST_BINS			8
+#endif
+
+/**
+ * @brief   Upper limit of the first bin of the recovery time histogram, in ms.
+ */
+#if !defined(DCMI_RECOVERY_HIST_FIRST_MS) || defined(__DOXYGEN__)
+#define DCMI_RECOVERY_HIST_FIRST_MS		8
+#endif
 
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
@@ -54,7 +71,8 @@ typedef enum {
   DCMI_ACTIVE_ONESHOT = 4,			/**< Listening for frames, one shot.					*/
   DCMI_COMPLETE = 5,				/**< Frame complete, callback pending.					*/
   DCMI_ERROR = 6,					/**< DCMI or DMA error.									*/	
-  DCMI_TIMEOUT = 7					/**< DCMI timeout, cannot stop correctly.				*/
+  DCMI_TIMEOUT = 7,					/**< DCMI timeout, cannot stop correctly.				*/
+  DCMI_RECOVERING = 8				/**< Streaming restarted after an error, waiting for a frame.	*/
 } dcmistate_t;
 
 #include "dcmi_lld.h"
@@ -100,6 +118,22 @@ typedef enum {
  * @{
  */
 
+/**
+ * @brief   Wakes up the thread waiting for a frame end, if any.
+ * @note    This macro is meant to be used in the low level drivers
+ *          implementation only.
+ *
+ * @param[in] dcmip      pointer to the @p DCMIDriver object
+ * @param[in] msg        message passed to the thread
+ *
+ * @notapi
+ */
+#define _dcmi_wakeup_isr(dcmip, msg) {										\
+	osalSysLockFromISR();													\
+	osalThreadResumeI(&(dcmip)->thread, msg);								\
+	osalSysUnlockFromISR();													\
+}
+
 /**
  * @brief   Common DCMI Frame Complete ISR code.
  * @details This code handles the portable part of the ISR code:
@@ -132,6 +166,7 @@ typedef enum {
 			(dcmip)->state = DCMI_ACTIVE_STREAM;							\
 		}																	\
 	}																		\
+	_dcmi_wakeup_isr(dcmip, MSG_OK);										\
 }
 /** @} */
 
@@ -149,14 +184,45 @@ typedef enum {
  *
  * @notapi
  */
-#define _dcmi_isr_error_code(dcmip, err) {								\
-    if((dcmip)->state == DCMI_ACTIVE_STREAM) {							\
-        dcmi_lld_stop_stream(dcmip);									\
-    }																	\
-	(dcmip)->state = DCMI_ERROR;										\
+#define _dcmi_isr_error_code(dcmip, err) {								\
+	if(((dcmip)->state == DCMI_ACTIVE_STREAM) ||						\
+	   ((dcmip)->state == DCMI_RECOVERING)) {							\
+		dcmi_lld_recover(dcmip);										\
+		if((dcmip)->state == DCMI_ACTIVE_STREAM) {						\
+			(dcmip)->recovery_start = osalOsGetSystemTimeX();			\
+			(dcmip)->state = DCMI_RECOVERING;							\
+		}																\
+	} else {															\
+		(dcmip)->state = DCMI_ERROR;									\
+	}																	\
 	if ((dcmip)->config->error_cb != NULL) {							\
 		(dcmip)->config->error_cb(dcmip, err);							\
 	}																	\
+	/* A thread stopping the stream is done, the capture is disabled.*/	\
+	_dcmi_wakeup_isr(dcmip, ((dcmip)->state == DCMI_ERROR) ? MSG_RESET : MSG_OK); \
+}
+
+/**
+ * @brief   Common ISR code, end of the first frame after an error.
+ * @details Updates the recovery statistics and goes back to streaming.
+ * @note    This macro is meant to be used in the low level drivers
+ *          implementation only.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ *
+ * @notapi
+ */
+#define _dcmi_isr_recovered_code(dcmip) {								\
+	uint32_t ms = ST2MS(osalOsGetSystemTimeX() - (dcmip)->recovery_start); \
+	uint32_t limit = DCMI_RECOVERY_HIST_FIRST_MS;						\
+	uint8_t bin = 0;													\
+	while((ms >= limit) && (bin < (DCMI_RECOVERY_HIST_BINS - 1))) {	\
+		limit <<= 1;													\
+		bin++;															\
+	}																	\
+	(dcmip)->recovery_hist[bin]++;										\
+	(dcmip)->recoveries++;												\
+	(dcmip)->state = DCMI_ACTIVE_STREAM;								\
 }
 /** @} */
 
@@ -170,10 +236,17 @@ extern "C" {
 	void dcmiInit(void);
 	void dcmiObjectInit(DCMIDriver *dcmip);
     void dcmiPrepare(DCMIDriver *dcmip, const DCMIConfig *config, uint32_t transactionSize, void* rxbuf0, void* rxbuf1);
+    void dcmiPrepareBands(DCMIDriver *dcmip, const DCMIConfig *config, uint32_t lineSize, uint16_t bandLines, uint16_t frameLines, void* ringbuf);
     void dcmiUnprepare(DCMIDriver *dcmip);
     void dcmiStartOneShot(DCMIDriver *dcmip);
     void dcmiStartStream(DCMIDriver *dcmip);
     msg_t dcmiStopStream(DCMIDriver *dcmip);
+    msg_t dcmiCaptureTimeout(DCMIDriver *dcmip, systime_t timeout);
+    msg_t dcmiStopStreamTimeout(DCMIDriver *dcmip, systime_t timeout);
+    void dcmiSetCropI(DCMIDriver *dcmip, const DCMICrop *crop);
+    uint8_t dcmiGetIdleBufferIndexX(DCMIDriver *dcmip);
+    void dcmiSetIdleBufferI(DCMIDriver *dcmip, void *buf);
+    void dcmiSetCrop(DCMIDriver *dcmip, const DCMICrop *crop);
 
 #ifdef __cplusplus
 }
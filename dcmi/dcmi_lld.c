@@ -52,6 +52,20 @@ DCMIDriver DCMID;
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Hands a completed band to the band callback.
+ *
+ * @param[in] dcmip      pointer to the @p DCMIDriver object
+ * @param[in] half       half of the band ring buffer just filled
+ */
+static void dcmi_lld_serve_band(DCMIDriver *dcmip, uint8_t half) {
+	dcmip->config->band_cb(dcmip, dcmip->band_row, dcmip->band_lines, &dcmip->band_buf[half * dcmip->band_size]);
+	dcmip->band_row += dcmip->band_lines;
+	if(dcmip->band_row >= dcmip->frame_lines) {
+		dcmip->band_row = 0;
+	}
+}
+
 /**
  * @brief   Shared "DMA transaction complete" service routine.
  *
@@ -62,8 +76,25 @@ static void dcmi_lld_serve_dma_rx_interrupt(DCMIDriver *dcmip, uint32_t flags) {
 
 	/* DMA errors handling.*/
 	if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
+		dcmip->dma_errors++;
 		_dcmi_isr_error_code(dcmip, DCMI_ERR_DMAFAILURE);
 	}
+	/* A FIFO error is only counted, the data is not lost until the DCMI itself overruns.*/
+	if ((flags & STM32_DMA_ISR_FEIF) != 0) {
+		dcmip->fifo_errors++;
+	}
+	/* Band streaming: the half transfer means the first half of the ring is
+	   filled, the transfer complete the second one. Both can be pending if the
+	   interrupt was served late, in that order.*/
+	if(dcmip->band_lines != 0) {
+		if ((flags & STM32_DMA_ISR_HTIF) != 0) {
+			dcmi_lld_serve_band(dcmip, 0);
+		}
+		if ((flags & STM32_DMA_ISR_TCIF) != 0) {
+			dcmi_lld_serve_band(dcmip, 1);
+		}
+		return;
+	}
 	if( dcmip->config->transfer_complete_cb != NULL ) {
 		dcmip->config->transfer_complete_cb(dcmip);
 	}
@@ -85,10 +116,25 @@ OSAL_IRQ_HANDLER(Vector178) {
 	uint32_t flags =  DCMI->MISR;
 	if ((flags & DCMI_MISR_FRAME_MIS) != 0) { // Capture complete.
         DCMI->ICR |= DCMI_ICR_FRAME_ISC;
+        DCMID.frames++;
+        DCMID.band_row = 0; // Resynchronize the band rows on each frame.
+        if(DCMID.state == DCMI_RECOVERING) { // First complete frame since the error.
+            _dcmi_isr_recovered_code(&DCMID);
+        }
         _dcmi_isr_code(&DCMID);
 	}
+	// Handled after the frame end, both can be pending together and the timestamp belongs to the next frame.
+	if ((flags & DCMI_MISR_VSYNC_MIS) != 0) { // Vertical synchronization.
+        DCMI->ICR |= DCMI_ICR_VSYNC_ISC;
+        DCMID.frame_start = chSysGetRealtimeCounterX();
+        // After an error, the capture restarts during the vertical blanking so that the DMA gets a whole frame.
+        if(DCMID.state == DCMI_RECOVERING) {
+            DCMID.dcmi->CR |= DCMI_CR_CAPTURE;
+        }
+	}
 	if ((flags & DCMI_MISR_OVF_MIS) != 0) { // DMA overflow.
         DCMI->ICR |= DCMI_ICR_OVF_ISC;
+        DCMID.overruns++;
 		_dcmi_isr_error_code(&DCMID, DCMI_ERR_OVERFLOW);
 	}
     //DCMI->ICR |= DCMI_ICR_FRAME_ISC | DCMI_ICR_OVF_ISC | DCMI_ICR_ERR_ISC | DCMI_ICR_VSYNC_ISC | DCMI_ICR_LINE_ISC;
@@ -144,16 +190,34 @@ void dcmi_lld_prepare(DCMIDriver *dcmip, uint32_t transactionSize, void* rxbuf0,
 			b = dmaStreamAllocate(dcmip->dmastp, STM32_DCMI_DMA_IRQ_PRIORITY, (stm32_dmaisr_t)dcmi_lld_serve_dma_rx_interrupt, (void *)dcmip);
 			osalDbgAssert(!b, "stream already allocated");
 			dmaStreamSetPeripheral(dcmip->dmastp, &dcmip->dcmi->DR);
-			dmaStreamSetFIFO(dcmip->dmastp, STM32_DMA_FCR_DMDIS); // Direct mode enabled (FIFO disabled).
+			if(dcmip->config->fcr & STM32_DMA_FCR_DMDIS) {
+				dmaStreamSetFIFO(dcmip->dmastp, dcmip->config->fcr | STM32_DMA_FCR_FEIE); // FIFO mode, FIFO errors are counted.
+			} else {
+				dmaStreamSetFIFO(dcmip->dmastp, 0); // Direct mode enabled (FIFO disabled).
+			}
+			// Memory burst and data size, the peripheral side always reads single words.
+			dcmip->dmamode &= ~(STM32_DMA_CR_MBURST_MASK | STM32_DMA_CR_MSIZE_MASK);
+			if(dcmip->config->dmacr == 0) {
+				dcmip->dmamode |= STM32_DMA_CR_MBURST_SINGLE | STM32_DMA_CR_MSIZE_WORD;
+			} else {
+				dcmip->dmamode |= dcmip->config->dmacr & (STM32_DMA_CR_MBURST_MASK | STM32_DMA_CR_MSIZE_MASK);
+			}
 			dmaStreamSetMemory0(dcmip->dmastp, rxbuf0);
 			dmaStreamSetMemory1(dcmip->dmastp, rxbuf1);
-			dmaStreamSetTransactionSize(dcmip->dmastp, transactionSize/4);
+			dcmip->transaction_words = transactionSize/4;
+			dmaStreamSetTransactionSize(dcmip->dmastp, dcmip->transaction_words);
 			// If second buffer not given, then turn off double buffering.
 			if(rxbuf1 == NULL) {
 				dcmip->dmamode &= (~STM32_DMA_CR_DBM);
 			} else {
 				dcmip->dmamode |= STM32_DMA_CR_DBM;
 			}
+			// In band streaming mode the buffer is a ring of two bands, each half signals a band.
+			if(dcmip->band_lines != 0) {
+				dcmip->dmamode |= STM32_DMA_CR_HTIE;
+			} else {
+				dcmip->dmamode &= (~STM32_DMA_CR_HTIE);
+			}
 			dmaStreamSetMode(dcmip->dmastp, dcmip->dmamode);
 			dmaStreamEnable(dcmip->dmastp);
 
@@ -162,10 +226,11 @@ void dcmi_lld_prepare(DCMIDriver *dcmip, uint32_t transactionSize, void* rxbuf0,
 			nvicEnableVector(DCMI_IRQn, STM32_DCMI_IRQ_PRIORITY);
 			// Interrupt enable register.
 			dcmip->dcmi->IER |= DCMI_IER_FRAME_IE; // Capture complete.
-			//dcmip->dcmi->IER |= DCMI_IER_VSYNC_IE; // Interrupt generated when vsync become active (start of frame).
+			dcmip->dcmi->IER |= DCMI_IER_VSYNC_IE; // Interrupt generated when vsync become active (start of frame), used to timestamp frames.
 			dcmip->dcmi->IER |= DCMI_IER_OVF_IE; // Overrun (by DMA).
 			// Control Regsiter.
 			dcmip->dcmi->CR  = (dcmip->config->cr & ~(DCMI_CR_CAPTURE | DCMI_CR_ENABLE)); // Do not enable here because we don't still know the capture mode that will be used.
+			dcmi_lld_set_crop(dcmip);
 		}
 	}
 
@@ -224,37 +289,148 @@ void dcmi_lld_start_stream(DCMIDriver *dcmip) {
 }
 
  /**
- * @brief   Stops reception of frames from the DCMI.
+ * @brief   Requests the end of the capture.
+ * @details The capture is not interrupted: if a frame is being received, the
+ *          hardware keeps the CAPTURE bit set until the frame end.
  *
  * @param[in] dcmip     pointer to the @p DCMIDriver object
- *                      .
- * 
- * @return              The operation status.
- * @retval MSG_OK       if the function succeeded.
- * @retval MSG_TIMEOUT  if a timeout occurred before operation end.
  *
  * @notapi
  */
-msg_t dcmi_lld_stop_stream(DCMIDriver *dcmip) {
-    systime_t start, end;
-	if(dcmip->state == DCMI_ACTIVE_STREAM) {
-		dcmip->dcmi->CR &= ~(DCMI_CR_CAPTURE); // If a capture is ongoing, the bit will be effectively cleared by hardware after the frame end.
-		/* Calculating the time window for the timeout on waiting for CAPTURE flag bit to be cleared.*/
-        start = osalOsGetSystemTimeX();
-		end = start + OSAL_MS2ST(200);
-		/* Waits until CAPTURE flag is reset or, alternatively, for a timeout condition.*/
-		while (true) {
-			/* If the CAPTURE bit is cleared then the capture process is terminated correctly.*/
-            if((dcmip->dcmi->CR & DCMI_CR_CAPTURE) == 0) {
-				return MSG_OK;
-            }
-			/* If the system time went outside the allowed window then a timeout condition is returned.*/
-			if (!osalOsIsTimeWithinX(osalOsGetSystemTimeX(), start, end)) {
-				return MSG_TIMEOUT;
-			}
-		}
+void dcmi_lld_request_stop(DCMIDriver *dcmip) {
+	dcmip->dcmi->CR &= ~(DCMI_CR_CAPTURE);
+}
+
+ /**
+ * @brief   Restarts the DMA after an error.
+ * @details The DCMI is disabled at once, dropping the frame being received,
+ *          and the DMA stream is rewound to the beginning of the first buffer.
+ *          The DCMI is then enabled again without capturing; the VSYNC
+ *          interrupt sets the CAPTURE bit so that it starts on a frame
+ *          boundary.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ *
+ * @notapi
+ */
+void dcmi_lld_recover(DCMIDriver *dcmip) {
+	dcmip->dcmi->CR &= ~(DCMI_CR_CAPTURE | DCMI_CR_ENABLE);
+	dmaStreamDisable(dcmip->dmastp);
+	// The mode clears the current target bit, the memory addresses are kept.
+	dmaStreamSetTransactionSize(dcmip->dmastp, dcmip->transaction_words);
+	dmaStreamSetMode(dcmip->dmastp, dcmip->dmamode);
+	dmaStreamEnable(dcmip->dmastp);
+	dcmip->band_row = 0;
+	dcmip->dcmi->ICR = DCMI_ICR_FRAME_ISC | DCMI_ICR_OVF_ISC | DCMI_ICR_ERR_ISC | DCMI_ICR_VSYNC_ISC | DCMI_ICR_LINE_ISC;
+	dcmip->dcmi->CR |= DCMI_CR_ENABLE;
+}
+
+ /**
+ * @brief   Tells whether the DCMI is still capturing.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @return              true until the hardware clears the CAPTURE bit.
+ *
+ * @notapi
+ */
+bool dcmi_lld_is_capturing(DCMIDriver *dcmip) {
+	return (dcmip->dcmi->CR & DCMI_CR_CAPTURE) != 0;
+}
+
+/**
+ * @brief   Returns the size of a memory burst, in bytes.
+ * @details Checks the configuration against the DMA FIFO rules: bursts are
+ *          only possible in FIFO mode and the FIFO threshold must hold a whole
+ *          number of bursts.
+ *
+ * @param[in] config    pointer to the @p DCMIConfig object
+ * @return              The burst size, or 0 if the configuration is invalid.
+ *
+ * @notapi
+ */
+uint32_t dcmi_lld_burst_size(const DCMIConfig *config) {
+	uint32_t dmacr = config->dmacr;
+	uint32_t msize, beats, fth;
+
+	if(dmacr == 0) {
+		dmacr = STM32_DMA_CR_MBURST_SINGLE | STM32_DMA_CR_MSIZE_WORD;
+	}
+
+	switch(dmacr & STM32_DMA_CR_MSIZE_MASK) {
+		case STM32_DMA_CR_MSIZE_BYTE: msize = 1; break;
+		case STM32_DMA_CR_MSIZE_HWORD: msize = 2; break;
+		case STM32_DMA_CR_MSIZE_WORD: msize = 4; break;
+		default: return 0;
+	}
+
+	switch(dmacr & STM32_DMA_CR_MBURST_MASK) {
+		case STM32_DMA_CR_MBURST_SINGLE: beats = 1; break;
+		case STM32_DMA_CR_MBURST_INCR4: beats = 4; break;
+		case STM32_DMA_CR_MBURST_INCR8: beats = 8; break;
+		default: beats = 16; break;
+	}
+
+	if((config->fcr & STM32_DMA_FCR_DMDIS) == 0) {
+		// Direct mode: no burst and no packing, the memory gets the DCMI words as they are.
+		return (beats == 1 && msize == 4) ? 4 : 0;
+	}
+
+	// The threshold is 1 to 4 quarters of the 16 bytes FIFO.
+	fth = ((config->fcr & STM32_DMA_FCR_FTH_MASK) + 1) * 4;
+	if((fth % (msize * beats)) != 0) {
+		return 0;
+	}
+
+	// Even without burst, the DCMI words must fill whole memory locations.
+	return (msize * beats < 4) ? 4 : msize * beats;
+}
+
+/**
+ * @brief   Returns which of the two double buffering memories is idle.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @return              0 if the DMA is writing to the second buffer, 1 otherwise.
+ *
+ * @notapi
+ */
+uint8_t dcmi_lld_get_idle_buffer(DCMIDriver *dcmip) {
+	return (dcmip->dmastp->stream->CR & STM32_DMA_CR_CT) ? 0 : 1;
+}
+
+/**
+ * @brief   Replaces the memory address the DMA is not currently writing to.
+ * @note    The hardware only allows to change the idle memory register while
+ *          the stream is enabled in double buffer mode.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ * @param[in] buf       the new buffer
+ *
+ * @notapi
+ */
+void dcmi_lld_set_idle_buffer(DCMIDriver *dcmip, void *buf) {
+	if(dcmip->dmastp->stream->CR & STM32_DMA_CR_CT) {
+		dcmip->dmastp->stream->M0AR = (uint32_t)buf;
+	} else {
+		dcmip->dmastp->stream->M1AR = (uint32_t)buf;
+	}
+}
+
+/**
+ * @brief   Programs the crop registers from the driver crop window.
+ * @note    The new window is taken into account by the hardware from the next frame.
+ *
+ * @param[in] dcmip     pointer to the @p DCMIDriver object
+ *
+ * @notapi
+ */
+void dcmi_lld_set_crop(DCMIDriver *dcmip) {
+	if(dcmip->crop.capcnt == 0) {
+		dcmip->dcmi->CR &= ~DCMI_CR_CROP;
+	} else {
+		dcmip->dcmi->CWSTRTR = ((uint32_t)dcmip->crop.vst << 16) | dcmip->crop.hoffcnt;
+		dcmip->dcmi->CWSIZER = ((uint32_t)(dcmip->crop.vline - 1) << 16) | (dcmip->crop.capcnt - 1);
+		dcmip->dcmi->CR |= DCMI_CR_CROP;
 	}
-	return MSG_OK;
 }
 
 #endif /* HAL_USE_DCMI */
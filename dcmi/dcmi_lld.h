@@ -150,6 +150,28 @@ typedef void (*dcmicallback_t)(DCMIDriver *dcmip);
  */
 typedef void (*dcmierrorcallback_t)(DCMIDriver *adcp, dcmierror_t err);
 
+/**
+ * @brief   DCMI band callback type.
+ *
+ * @param[in] dcmip		pointer to the @p DCMIDriver object triggering the callback.
+ * @param[in] first_row	index of the first image row contained in the band.
+ * @param[in] n_rows		number of rows in the band.
+ * @param[in] band		pointer to the first byte of the band, valid until the
+ *						DMA wraps around to it, i.e. for one band period.
+ */
+typedef void (*dcmibandcallback_t)(DCMIDriver *dcmip, uint16_t first_row, uint16_t n_rows, const uint8_t *band);
+
+/**
+ * @brief   Crop window, the values are counts (the registers hold them minus one).
+ * @note    A null capcnt disables cropping.
+ */
+typedef struct {
+  uint16_t					hoffcnt;	/**< Horizontal offset, in pixel clocks.	*/
+  uint16_t					vst;		/**< First line captured.					*/
+  uint16_t					capcnt;		/**< Captured width, in pixel clocks.		*/
+  uint16_t					vline;		/**< Number of lines captured.				*/
+} DCMICrop;
+
 /**
  * @brief   Driver configuration structure.
  */
@@ -170,6 +192,23 @@ typedef struct {
    * @brief DCMI CR register initialization data.
    */
   uint32_t					cr;
+  /**
+   * @brief Band callback or @p NULL, only used in band streaming mode.
+   */
+  dcmibandcallback_t		band_cb;
+  /**
+   * @brief DMA FIFO control register: 0 for direct mode, otherwise
+   *        STM32_DMA_FCR_DMDIS | STM32_DMA_FCR_FTH_xxx.
+   */
+  uint32_t					fcr;
+  /**
+   * @brief DMA memory side: STM32_DMA_CR_MBURST_xxx | STM32_DMA_CR_MSIZE_xxx,
+   *        0 for single word transfers.
+   * @note  Bursts need the FIFO, and the FIFO threshold must be a multiple of
+   *        the burst size (e.g. INCR4 of words needs FTH_FULL, INCR8 of half
+   *        words too). The buffers must be aligned on the burst size.
+   */
+  uint32_t					dmacr;
 } DCMIConfig;
 
 /**
@@ -196,6 +235,73 @@ struct DCMIDriver {
    * @brief DMA mode bit mask.
    */
   uint32_t					dmamode;
+  /**
+   * @brief Realtime counter value at the last VSYNC, i.e. at the start of the
+   *        vertical blanking preceding the frame being captured.
+   */
+  uint32_t					frame_start;
+  /**
+   * @brief Number of frames captured.
+   */
+  volatile uint32_t			frames;
+  /**
+   * @brief Number of DCMI overruns (data lost because the DMA was too slow).
+   */
+  volatile uint32_t			overruns;
+  /**
+   * @brief Number of DMA transfer or direct mode errors.
+   */
+  volatile uint32_t			dma_errors;
+  /**
+   * @brief Number of DMA FIFO errors (the FIFO overflowed before being drained).
+   */
+  volatile uint32_t			fifo_errors;
+  /**
+   * @brief Number of times streaming resumed after an error.
+   */
+  volatile uint32_t			recoveries;
+  /**
+   * @brief Histogram of the recovery times, from the error to the end of the
+   *        next complete frame.
+   */
+  volatile uint32_t			recovery_hist[DCMI_RECOVERY_HIST_BINS];
+  /**
+   * @brief System time of the error that started the current recovery.
+   */
+  systime_t					recovery_start;
+  /**
+   * @brief DMA transaction size in words, restored on recovery.
+   */
+  uint32_t					transaction_words;
+  /**
+   * @brief Ring buffer holding two bands in band streaming mode.
+   */
+  uint8_t					*band_buf;
+  /**
+   * @brief Size of a band in bytes.
+   */
+  uint32_t					band_size;
+  /**
+   * @brief Number of rows per band, 0 when not in band streaming mode.
+   */
+  uint16_t					band_lines;
+  /**
+   * @brief Number of rows per frame.
+   */
+  uint16_t					frame_lines;
+  /**
+   * @brief First row of the next band to be delivered.
+   */
+  uint16_t					band_row;
+  /**
+   * @brief Current crop window.
+   */
+  DCMICrop					crop;
+  /**
+   * @brief Thread waiting for a frame end or an error, see
+   *        @p dcmiCaptureTimeout() and @p dcmiStopStreamTimeout().
+   */
+  thread_reference_t		thread;
 };
 
 /*===========================================================================*/
@@ -218,7 +324,13 @@ extern "C" {
 	void dcmi_lld_unprepare(DCMIDriver *dcmip);
 	void dcmi_lld_start_oneshot(DCMIDriver *dcmip);
     void dcmi_lld_start_stream(DCMIDriver *dcmip);
-	msg_t dcmi_lld_stop_stream(DCMIDriver *dcmip);
+	void dcmi_lld_request_stop(DCMIDriver *dcmip);
+	void dcmi_lld_recover(DCMIDriver *dcmip);
+	bool dcmi_lld_is_capturing(DCMIDriver *dcmip);
+	void dcmi_lld_set_crop(DCMIDriver *dcmip);
+	uint32_t dcmi_lld_burst_size(const DCMIConfig *config);
+	uint8_t dcmi_lld_get_idle_buffer(DCMIDriver *dcmip);
+	void dcmi_lld_set_idle_buffer(DCMIDriver *dcmip, void *buf);
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,10 @@
 #include "main.h"
 #include "config_flash_storage.h"
 #include "discovery_demo/accelerometer.h"
+#include "vision/blob_tracker.h"
+#include "vision/motion_detector.h"
+#include "vision/flow_estimator.h"
+#include "vision/line_follower.h"
 
 /* Struct used to share Aseba parameters between C-style API and Aseba. */
 static parameter_t aseba_settings[SETTINGS_COUNT];
@@ -34,6 +38,13 @@ const AsebaVMDescription vmDescription = {
 
      {6, "leds"},
      {3, "acc"},
+     {BLOB_MAX_CLASSES, "blob_count"},
+     {VM_BLOBS_SIZE, "blobs"},
+     {2, "motion_tiles"},
+     {1, "motion_count"},
+     {VM_MOTION_SIZE, "motion"},
+     {3, "flow"},
+     {4, "line"},
 
      {0, NULL}
 }
@@ -43,6 +54,10 @@ const AsebaVMDescription vmDescription = {
 const AsebaLocalEventDescription localEvents[] = {
     {"new_acc", "New accelerometer measurement"},
     {"button", "User button clicked"},
+    {"blobs", "New blob list"},
+    {"motion", "Motion detected"},
+    {"flow", "New ego-motion estimate"},
+    {"line", "New line profile"},
     {NULL, NULL}
 };
 
@@ -98,6 +113,81 @@ void button_cb(void)
     SET_EVENT(EVENT_BUTTON);
 }
 
+// This function must update the blob variables, largest blobs first
+void blobs_cb(void)
+{
+    static blob_tracker_result_t result;
+    const blob_t *blob;
+    sint16 *dst = vmVariables.blobs;
+    int cls, i;
+
+    blob_tracker_get(&result);
+    memset(vmVariables.blobs, 0, sizeof(vmVariables.blobs));
+
+    for (cls = 0; cls < BLOB_MAX_CLASSES; cls++) {
+        vmVariables.blob_count[cls] = result.count[cls];
+        for (i = 0; i < BLOB_MAX_PER_CLASS; i++, dst += VM_BLOB_FIELDS) {
+            if (i >= result.count[cls]) {
+                continue;
+            }
+            blob = &result.blobs[cls][i];
+            dst[0] = blob->cx;
+            dst[1] = blob->cy;
+            dst[2] = blob->area > 32767 ? 32767 : blob->area;
+            dst[3] = blob->x_min;
+            dst[4] = blob->y_min;
+            dst[5] = blob->x_max;
+            dst[6] = blob->y_max;
+        }
+    }
+    SET_EVENT(EVENT_BLOBS);
+}
+
+// This function must update the motion variables, tiles are numbered row by row
+void motion_cb(void)
+{
+    static motion_detector_result_t result;
+    int i;
+
+    motion_detector_get(&result);
+    vmVariables.motion_tiles[0] = result.tiles_x;
+    vmVariables.motion_tiles[1] = result.tiles_y;
+    vmVariables.motion_count = result.active_tiles;
+    for (i = 0; i < VM_MOTION_SIZE; i++) {
+        vmVariables.motion[i] = (sint16)(result.activity[i / 2] >> (16 * (i % 2)));
+    }
+    SET_EVENT(EVENT_MOTION);
+}
+
+// This function must update the flow variable: translation x and y in 1/16
+// pixel of the halved image, then rotation in milliradians
+void flow_cb(void)
+{
+    static flow_estimator_result_t result;
+
+    flow_estimator_get(&result);
+    vmVariables.flow[0] = result.flow.tx;
+    vmVariables.flow[1] = result.flow.ty;
+    vmVariables.flow[2] = result.flow.rotation;
+    SET_EVENT(EVENT_FLOW);
+}
+
+// This function must update the line variable: found, then centre, left and
+// right edges in 1/16 pixel
+void line_cb(void)
+{
+    static line_follower_result_t result;
+
+    line_follower_get(&result);
+    vmVariables.line[0] = result.found;
+    if (result.found) {
+        vmVariables.line[1] = result.line.centre;
+        vmVariables.line[2] = result.line.left;
+        vmVariables.line[3] = result.line.right;
+    }
+    SET_EVENT(EVENT_LINE);
+}
+
 
 // Native functions
 static AsebaNativeFunctionDescription AsebaNativeDescription__system_reboot =
@@ -9,6 +9,8 @@ extern "C" {
 #include "vm/vm.h"
 #include "vm/natives.h"
 #include "parameter/parameter.h"
+#include "vision/blob.h"
+#include "vision/motion.h"
 
 /** Number of variables usable by the Aseba script. */
 #define VM_VARIABLES_FREE_SPACE 256
@@ -18,10 +20,24 @@ extern "C" {
 
 #define SETTINGS_COUNT 32
 
+/** Values exported per blob: centroid x and y, area, then the bounding box
+ * x_min, y_min, x_max, y_max. */
+#define VM_BLOB_FIELDS 7
+
+/** Size of the blobs variable, BLOB_MAX_PER_CLASS blobs per colour class. */
+#define VM_BLOBS_SIZE (BLOB_MAX_CLASSES * BLOB_MAX_PER_CLASS * VM_BLOB_FIELDS)
+
+/** Size of the motion variable, one bit per tile, 16 tiles per word. */
+#define VM_MOTION_SIZE (MOTION_MAX_TILES / 16)
+
 /** Enum containing all the possible events. */
 enum AsebaLocalEvents {
     EVENT_ACC=0,   // New accelerometer measurement
     EVENT_BUTTON, // Button click
+    EVENT_BLOBS,  // New blob list
+    EVENT_MOTION, // Motion detected
+    EVENT_FLOW,   // New ego-motion estimate
+    EVENT_LINE,   // New line profile
 };
 
 
@@ -39,6 +55,13 @@ struct _vmVariables {
     // Variables
     uint16 leds[6];
     sint16 acc[3];
+    sint16 blob_count[BLOB_MAX_CLASSES];
+    sint16 blobs[VM_BLOBS_SIZE];
+    sint16 motion_tiles[2];
+    sint16 motion_count;
+    sint16 motion[VM_MOTION_SIZE];
+    sint16 flow[3];
+    sint16 line[4];
 
     // Free space
     sint16 freeSpace[VM_VARIABLES_FREE_SPACE];
@@ -55,6 +78,10 @@ void aseba_write_variables_to_system(AsebaVMState *vm);
 
 void accelerometer_cb(void);
 void button_cb(void);
+void blobs_cb(void);
+void motion_cb(void);
+void flow_cb(void);
+void line_cb(void);
 
 extern struct _vmVariables vmVariables;
 
@@ -0,0 +1,97 @@
+#include "auto_exposure.h"
+
+/* Above this mean luma most of the frame is clipped. */
+#define AE_SATURATED_LUMA 250
+
+/* Below this mean luma the chroma is mostly noise. */
+#define AWB_MIN_LUMA 32
+
+void ae_init(ae_t *ae)
+{
+    ae->exposure = 128 * AE_ONE_LINE;
+    ae->min_exposure = AE_ONE_LINE / 4;
+    ae->max_exposure = 0xFFFF * AE_ONE_LINE;
+    ae->target = 110;
+    ae->tolerance = 6;
+}
+
+bool ae_update(ae_t *ae, const histogram_t *hist)
+{
+    uint32_t mean = histogram_mean(hist), exposure;
+
+    if (hist->count == 0 || (mean + ae->tolerance >= ae->target && mean <= ae->target + (uint32_t)ae->tolerance)) {
+        return false;
+    }
+
+    /* Halfway to exposure * target / mean, at most doubling. A saturated
+     * frame is only known to be too bright, it is halved. */
+    if (mean >= AE_SATURATED_LUMA) {
+        exposure = ae->exposure / 2;
+    } else if (3 * mean <= ae->target) {
+        exposure = 2 * ae->exposure;
+    } else {
+        exposure = (uint64_t)ae->exposure * (ae->target + mean) / (2 * mean);
+    }
+
+    if (exposure < ae->min_exposure) {
+        exposure = ae->min_exposure;
+    } else if (exposure > ae->max_exposure) {
+        exposure = ae->max_exposure;
+    }
+
+    if (exposure == ae->exposure) {
+        return false;
+    }
+    ae->exposure = exposure;
+
+    return true;
+}
+
+void awb_init(awb_t *awb)
+{
+    awb->gain_r = 0x5E;
+    awb->gain_g = AWB_UNITY_GAIN;
+    awb->gain_b = 0x5D;
+    awb->min_gain = AWB_UNITY_GAIN / 4;
+    awb->max_gain = 0xFF;
+    awb->tolerance = 2;
+}
+
+/* Scales a gain to cancel a chroma offset. A channel off by a factor k gives
+ * a chroma offset of about 0.5 * (k - 1) * luma, half of it is corrected. */
+static uint8_t correct(const awb_t *awb, uint8_t gain, int32_t offset, int32_t luma)
+{
+    int32_t g = gain - gain * offset / luma;
+
+    if (offset >= -awb->tolerance && offset <= awb->tolerance) {
+        return gain;
+    }
+    if (g < awb->min_gain) {
+        g = awb->min_gain;
+    } else if (g > awb->max_gain) {
+        g = awb->max_gain;
+    }
+
+    return g;
+}
+
+bool awb_update(awb_t *awb, const histogram_t *hist)
+{
+    uint8_t u, v, r, b, luma = histogram_mean(hist);
+
+    if (hist->chroma_count == 0 || luma < AWB_MIN_LUMA) {
+        return false;
+    }
+
+    histogram_mean_chroma(hist, &u, &v);
+    r = correct(awb, awb->gain_r, (int32_t)v - 128, luma);
+    b = correct(awb, awb->gain_b, (int32_t)u - 128, luma);
+
+    if (r == awb->gain_r && b == awb->gain_b) {
+        return false;
+    }
+    awb->gain_r = r;
+    awb->gain_b = b;
+
+    return true;
+}
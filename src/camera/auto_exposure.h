@@ -0,0 +1,65 @@
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vision/histogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Software auto exposure and grey world white balance.
+ *
+ * Unlike the loops built into the sensor, these are driven by statistics
+ * of a chosen metering region. Each update moves the settings halfway to
+ * the value which would reach the target, the caller is expected to wait
+ * until the new settings show in the frames before the next update. */
+
+/** Integration time of one line, exposures are in 1/256 line as taken by
+ * po8030_set_exposure(). */
+#define AE_ONE_LINE 256
+
+/** Unity gain of the PO8030 colour gains, bit 6 set. */
+#define AWB_UNITY_GAIN 0x40
+
+typedef struct {
+    uint32_t exposure;                      /**< Current integration time, in 1/256 line. */
+    uint32_t min_exposure, max_exposure;
+    uint8_t target;                         /**< Mean luma aimed at. */
+    uint8_t tolerance;                      /**< Dead band around the target. */
+} ae_t;
+
+typedef struct {
+    uint8_t gain_r, gain_g, gain_b;         /**< PO8030 format, see AWB_UNITY_GAIN. */
+    uint8_t min_gain, max_gain;
+    uint8_t tolerance;                      /**< Dead band around neutral chroma. */
+} awb_t;
+
+/** Sets the default target and range, starting from the sensor default
+ * integration time of 128 lines. */
+void ae_init(ae_t *ae);
+
+/** Computes the next integration time from the statistics of a frame
+ * taken with the current one.
+ *
+ * @returns true if the integration time changed.
+ */
+bool ae_update(ae_t *ae, const histogram_t *hist);
+
+/** Sets the default range, starting from the sensor default gains. */
+void awb_init(awb_t *awb);
+
+/** Computes the next red and blue gains, green is kept as reference.
+ *
+ * Frames too dark to tell the colours apart are ignored.
+ *
+ * @returns true if a gain changed.
+ */
+bool awb_update(awb_t *awb, const histogram_t *hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUTO_EXPOSURE_H */
@@ -0,0 +1,176 @@
+#include <ch.h>
+#include <hal.h>
+#include "camera_control.h"
+#include "po8030.h"
+
+#define CAMERA_CONTROL_EVENT EVENT_MASK(0)
+#define CAMERA_CONTROL_FRAME_EVENT EVENT_MASK(1)
+
+/* The camera is considered streaming if a frame ended less than this ago,
+ * it is also the longest a command waits for the next frame boundary. */
+#define CAMERA_CONTROL_FRAME_TIMEOUT MS2ST(200)
+
+static camera_ctrl_queue_t queue;
+static thread_t *control_thd = NULL;
+static volatile systime_t last_frame_end = 0;
+static volatile bool frame_seen = false;
+static uint32_t executed = 0;
+static uint32_t synced = 0;
+static uint32_t failed = 0;
+static int8_t last_error = MSG_OK;
+
+static int8_t execute(const camera_ctrl_cmd_t *cmd)
+{
+    switch (cmd->kind) {
+        case CAMERA_CTRL_BRIGHTNESS:
+            return po8030_set_brightness(cmd->param.value);
+        case CAMERA_CTRL_CONTRAST:
+            return po8030_set_contrast(cmd->param.value);
+        case CAMERA_CTRL_MIRROR:
+            return po8030_set_mirror(cmd->param.mirror.vertical, cmd->param.mirror.horizontal);
+        case CAMERA_CTRL_AWB:
+            return po8030_set_awb(cmd->param.value);
+        case CAMERA_CTRL_RGB_GAIN:
+            return po8030_set_rgb_gain(cmd->param.gain.r, cmd->param.gain.g, cmd->param.gain.b);
+        case CAMERA_CTRL_AE:
+            return po8030_set_ae(cmd->param.value);
+        case CAMERA_CTRL_EXPOSURE:
+            return po8030_set_exposure(cmd->param.exposure.integral, cmd->param.exposure.fractional);
+        case CAMERA_CTRL_WINDOW:
+            return po8030_advanced_config((format_t)cmd->param.window.format,
+                                          cmd->param.window.x1, cmd->param.window.y1,
+                                          cmd->param.window.width, cmd->param.window.height,
+                                          (subsampling_t)cmd->param.window.subsampling_x,
+                                          (subsampling_t)cmd->param.window.subsampling_y);
+        default:
+            return -1;
+    }
+}
+
+static bool is_streaming(void)
+{
+    return frame_seen && chVTTimeElapsedSinceX(last_frame_end) < CAMERA_CONTROL_FRAME_TIMEOUT;
+}
+
+static THD_FUNCTION(camera_control_thd, p)
+{
+    camera_ctrl_cmd_t cmd;
+    int8_t err;
+
+    (void)p;
+    chRegSetThreadName("camera-control");
+
+    while (true) {
+        chEvtWaitAny(CAMERA_CONTROL_EVENT);
+
+        if (!camera_ctrl_queue_ready(&queue)) {
+            continue;
+        }
+
+        /* While streaming, wait for the vertical blanking so that all the
+         * pending commands land between two frames instead of tearing one. */
+        if (is_streaming()) {
+            chEvtGetAndClearEvents(CAMERA_CONTROL_FRAME_EVENT);
+            if (chEvtWaitAnyTimeout(CAMERA_CONTROL_FRAME_EVENT, CAMERA_CONTROL_FRAME_TIMEOUT) != 0) {
+                chSysLock();
+                synced++;
+                chSysUnlock();
+            }
+        }
+
+        /* Drain the queue: commands posted meanwhile are picked up as well. */
+        while (camera_ctrl_queue_take(&queue, &cmd)) {
+            err = execute(&cmd);
+
+            chSysLock();
+            executed++;
+            if (err != MSG_OK) {
+                failed++;
+                last_error = err;
+            }
+            chSysUnlock();
+
+            camera_ctrl_queue_complete(&cmd, err);
+        }
+    }
+}
+
+void camera_control_start(void)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    camera_ctrl_queue_init(&queue);
+    control_thd = chThdCreateStatic(wa, sizeof(wa), NORMALPRIO, camera_control_thd, NULL);
+}
+
+bool camera_control_post(const camera_ctrl_cmd_t *cmd)
+{
+    if (control_thd == NULL || !camera_ctrl_queue_post(&queue, cmd)) {
+        return false;
+    }
+
+    chEvtSignal(control_thd, CAMERA_CONTROL_EVENT);
+
+    return true;
+}
+
+void camera_control_begin(void)
+{
+    camera_ctrl_queue_begin(&queue);
+}
+
+void camera_control_commit(void)
+{
+    camera_ctrl_queue_commit(&queue);
+
+    if (control_thd != NULL) {
+        chEvtSignal(control_thd, CAMERA_CONTROL_EVENT);
+    }
+}
+
+void camera_control_frame_end_i(void)
+{
+    last_frame_end = chVTGetSystemTimeX();
+    frame_seen = true;
+
+    if (control_thd != NULL) {
+        chEvtSignalI(control_thd, CAMERA_CONTROL_FRAME_EVENT);
+    }
+}
+
+static void future_cb(void *arg, int8_t result)
+{
+    camera_control_future_t *future = (camera_control_future_t *)arg;
+
+    future->result = result;
+    chBSemSignal(&future->done);
+}
+
+void camera_control_future_init(camera_control_future_t *future, camera_ctrl_cmd_t *cmd)
+{
+    chBSemObjectInit(&future->done, true);
+    future->result = MSG_OK;
+    cmd->cb = future_cb;
+    cmd->cb_arg = future;
+}
+
+int8_t camera_control_future_wait(camera_control_future_t *future, systime_t timeout)
+{
+    if (chBSemWaitTimeout(&future->done, timeout) != MSG_OK) {
+        return MSG_TIMEOUT;
+    }
+
+    return future->result;
+}
+
+void camera_control_get_stats(camera_control_stats_t *stats)
+{
+    chSysLock();
+    stats->posted = queue.posted;
+    stats->merged = queue.merged;
+    stats->executed = executed;
+    stats->synced = synced;
+    stats->failed = failed;
+    stats->last_error = last_error;
+    chSysUnlock();
+}
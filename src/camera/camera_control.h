@@ -0,0 +1,87 @@
+#ifndef CAMERA_CONTROL_H
+#define CAMERA_CONTROL_H
+
+#include <ch.h>
+#include "camera_ctrl_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Lets a caller wait for the completion of a posted command. */
+typedef struct {
+    binary_semaphore_t done;
+    int8_t result;
+} camera_control_future_t;
+
+typedef struct {
+    uint32_t posted;    /**< Number of commands posted. */
+    uint32_t merged;    /**< Number of commands replaced before being executed. */
+    uint32_t executed;  /**< Number of commands sent to the sensor. */
+    uint32_t synced;    /**< Number of batches applied at a frame boundary. */
+    uint32_t failed;    /**< Number of executed commands which returned an error. */
+    int8_t last_error;
+} camera_control_stats_t;
+
+/** Starts the thread owning the camera I2C bus.
+ *
+ * Must be called once po8030_init() returned. From then on the sensor
+ * settings must only be changed through camera_control_post().
+ */
+void camera_control_start(void);
+
+/** Queues a command for the camera control thread and returns immediately.
+ *
+ * The command callback, if any, is called from the camera control thread
+ * once the command was executed, or from the caller's context if the
+ * command is replaced by a newer one of the same kind.
+ *
+ * @returns false if the command is invalid.
+ */
+bool camera_control_post(const camera_ctrl_cmd_t *cmd);
+
+/** Opens a transaction.
+ *
+ * Commands posted until camera_control_commit() are held back, then
+ * executed in one batch. While the camera is streaming, every batch is
+ * started right after a frame end so that it lands in the vertical blanking
+ * instead of in the middle of a frame.
+ *
+ * @note A batch only stays within one blanking interval if it is short
+ * enough, a register write takes about 75 us on the I2C bus.
+ */
+void camera_control_begin(void);
+
+/** Closes the transaction and hands the batch to the control thread. */
+void camera_control_commit(void);
+
+/** Notifies the control thread of a frame boundary.
+ *
+ * Must be called from the DCMI frame end callback.
+ *
+ * @iclass
+ */
+void camera_control_frame_end_i(void);
+
+/** Prepares a future and hooks it as the completion callback of cmd.
+ *
+ * @note The future must stay valid until the command completed, even if
+ * camera_control_future_wait() timed out.
+ */
+void camera_control_future_init(camera_control_future_t *future, camera_ctrl_cmd_t *cmd);
+
+/** Waits for the command bound to a future to complete.
+ *
+ * @returns MSG_TIMEOUT if the command did not complete in time, otherwise
+ * the result of the command (MSG_OK, an I2C error or CAMERA_CTRL_SUPERSEDED).
+ */
+int8_t camera_control_future_wait(camera_control_future_t *future, systime_t timeout);
+
+/** Copies the queue statistics. */
+void camera_control_get_stats(camera_control_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAMERA_CONTROL_H */
@@ -0,0 +1,118 @@
+#include <string.h>
+#include "camera_ctrl_queue.h"
+#include "camera_port.h"
+
+void camera_ctrl_queue_init(camera_ctrl_queue_t *queue)
+{
+    memset(queue, 0, sizeof(camera_ctrl_queue_t));
+}
+
+bool camera_ctrl_queue_post(camera_ctrl_queue_t *queue, const camera_ctrl_cmd_t *cmd)
+{
+    camera_ctrl_cmd_t old;
+    uint32_t mask;
+    bool superseded = false;
+
+    if ((unsigned)cmd->kind >= CAMERA_CTRL_NUM_KINDS) {
+        return false;
+    }
+    mask = 1u << cmd->kind;
+
+    CAMERA_LOCK();
+
+    if (queue->pending & mask) {
+        old = queue->slots[cmd->kind];
+        superseded = true;
+        queue->merged++;
+    }
+    queue->slots[cmd->kind] = *cmd;
+    queue->order[cmd->kind] = queue->next_order++;
+    queue->pending |= mask;
+    queue->posted++;
+
+    CAMERA_UNLOCK();
+
+    if (superseded) {
+        camera_ctrl_queue_complete(&old, CAMERA_CTRL_SUPERSEDED);
+    }
+
+    return true;
+}
+
+void camera_ctrl_queue_begin(camera_ctrl_queue_t *queue)
+{
+    CAMERA_LOCK();
+    queue->hold++;
+    CAMERA_UNLOCK();
+}
+
+void camera_ctrl_queue_commit(camera_ctrl_queue_t *queue)
+{
+    CAMERA_LOCK();
+    if (queue->hold > 0) {
+        queue->hold--;
+    }
+    CAMERA_UNLOCK();
+}
+
+bool camera_ctrl_queue_ready(camera_ctrl_queue_t *queue)
+{
+    bool ready;
+
+    CAMERA_LOCK();
+    ready = queue->hold == 0 && queue->pending != 0;
+    CAMERA_UNLOCK();
+
+    return ready;
+}
+
+bool camera_ctrl_queue_take(camera_ctrl_queue_t *queue, camera_ctrl_cmd_t *cmd)
+{
+    int oldest = -1;
+    int i;
+
+    CAMERA_LOCK();
+
+    for (i = 0; queue->hold == 0 && i < CAMERA_CTRL_NUM_KINDS; i++) {
+        if (!(queue->pending & (1u << i))) {
+            continue;
+        }
+        /* Signed difference so that the comparison survives wrap around. */
+        if (oldest < 0 || (int32_t)(queue->order[i] - queue->order[oldest]) < 0) {
+            oldest = i;
+        }
+    }
+
+    if (oldest >= 0) {
+        *cmd = queue->slots[oldest];
+        queue->pending &= ~(1u << oldest);
+    }
+
+    CAMERA_UNLOCK();
+
+    return oldest >= 0;
+}
+
+void camera_ctrl_queue_complete(const camera_ctrl_cmd_t *cmd, int8_t result)
+{
+    if (cmd->cb != NULL) {
+        cmd->cb(cmd->cb_arg, result);
+    }
+}
+
+uint8_t camera_ctrl_queue_pending_count(camera_ctrl_queue_t *queue)
+{
+    uint32_t pending;
+    uint8_t n = 0;
+
+    CAMERA_LOCK();
+    pending = queue->pending;
+    CAMERA_UNLOCK();
+
+    while (pending) {
+        pending &= pending - 1;
+        n++;
+    }
+
+    return n;
+}
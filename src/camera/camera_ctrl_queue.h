@@ -0,0 +1,124 @@
+#ifndef CAMERA_CTRL_QUEUE_H
+#define CAMERA_CTRL_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Result passed to the completion callback of a command which was replaced
+ * by a newer command of the same kind before being executed.
+ *
+ * Same value as ChibiOS' MSG_RESET.
+ */
+#define CAMERA_CTRL_SUPERSEDED (-2)
+
+typedef enum {
+    CAMERA_CTRL_BRIGHTNESS = 0,
+    CAMERA_CTRL_CONTRAST,
+    CAMERA_CTRL_MIRROR,
+    CAMERA_CTRL_AWB,
+    CAMERA_CTRL_RGB_GAIN,
+    CAMERA_CTRL_AE,
+    CAMERA_CTRL_EXPOSURE,
+    CAMERA_CTRL_WINDOW,
+    CAMERA_CTRL_NUM_KINDS,
+} camera_ctrl_kind_t;
+
+/** Completion callback, called with the result of the setter (MSG_OK or a
+ * negative error code) or with CAMERA_CTRL_SUPERSEDED. */
+typedef void (*camera_ctrl_cb_t)(void *arg, int8_t result);
+
+typedef struct {
+    camera_ctrl_kind_t kind;
+    union {
+        uint8_t value;      /**< Brightness, contrast or AWB / AE enable. */
+        struct {
+            uint8_t vertical;
+            uint8_t horizontal;
+        } mirror;
+        struct {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        } gain;
+        struct {
+            uint16_t integral;
+            uint8_t fractional;
+        } exposure;
+        struct {
+            uint8_t format;
+            uint8_t subsampling_x;
+            uint8_t subsampling_y;
+            uint16_t x1;
+            uint16_t y1;
+            uint16_t width;
+            uint16_t height;
+        } window;
+    } param;
+    camera_ctrl_cb_t cb;    /**< Optional, may be NULL. */
+    void *cb_arg;
+} camera_ctrl_cmd_t;
+
+/** Mailbox holding at most one pending command per kind.
+ *
+ * Posting a command of a kind which is already pending replaces it, as only
+ * the last value of a setting matters.
+ */
+typedef struct {
+    camera_ctrl_cmd_t slots[CAMERA_CTRL_NUM_KINDS];
+    uint32_t order[CAMERA_CTRL_NUM_KINDS];  /**< Post order of the pending slots. */
+    uint32_t pending;                       /**< Bitmask of the pending kinds. */
+    uint32_t next_order;
+    uint8_t hold;                           /**< Number of open transactions. */
+    uint32_t posted;
+    uint32_t merged;
+} camera_ctrl_queue_t;
+
+/** Initializes an empty queue. */
+void camera_ctrl_queue_init(camera_ctrl_queue_t *queue);
+
+/** Posts a command.
+ *
+ * If a command of the same kind is still pending it is replaced and its
+ * callback is called with CAMERA_CTRL_SUPERSEDED from the calling context.
+ * The new command is queued after every other pending command, so that the
+ * settings are applied in the order they were last requested.
+ *
+ * @returns false if the command kind is invalid.
+ */
+bool camera_ctrl_queue_post(camera_ctrl_queue_t *queue, const camera_ctrl_cmd_t *cmd);
+
+/** Opens a transaction.
+ *
+ * Until the matching camera_ctrl_queue_commit(), commands are queued but
+ * cannot be taken, so that they are all executed together afterwards.
+ * Transactions can be nested.
+ */
+void camera_ctrl_queue_begin(camera_ctrl_queue_t *queue);
+
+/** Closes a transaction opened by camera_ctrl_queue_begin(). */
+void camera_ctrl_queue_commit(camera_ctrl_queue_t *queue);
+
+/** Returns true if there are pending commands and no open transaction. */
+bool camera_ctrl_queue_ready(camera_ctrl_queue_t *queue);
+
+/** Removes the oldest pending command and copies it to cmd.
+ *
+ * @returns false if no command is pending or a transaction is open.
+ */
+bool camera_ctrl_queue_take(camera_ctrl_queue_t *queue, camera_ctrl_cmd_t *cmd);
+
+/** Calls the completion callback of an executed command, if any. */
+void camera_ctrl_queue_complete(const camera_ctrl_cmd_t *cmd, int8_t result);
+
+/** Returns the number of pending commands. */
+uint8_t camera_ctrl_queue_pending_count(camera_ctrl_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAMERA_CTRL_QUEUE_H */
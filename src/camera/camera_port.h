@@ -0,0 +1,30 @@
+#ifndef CAMERA_PORT_H
+#define CAMERA_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+
+#define CAMERA_LOCK() {}
+
+#define CAMERA_UNLOCK() {}
+
+#else
+
+#include <ch.h>
+
+/* The camera modules are used both from threads and from the DCMI / DMA
+ * interrupt handlers, so the lock must work in both contexts. */
+#define CAMERA_LOCK() syssts_t _camera_sts = chSysGetStatusAndLockX()
+
+#define CAMERA_UNLOCK() {chSysRestoreStatusX(_camera_sts); }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAMERA_PORT_H */
@@ -0,0 +1,62 @@
+#include "dcmi_crop.h"
+
+bool dcmi_crop_compute(const dcmi_crop_rect_t *rect, uint16_t frame_width, uint16_t frame_height,
+                       uint8_t bytes_per_pixel, uint8_t align, dcmi_crop_window_t *window)
+{
+    uint32_t hoffcnt, capcnt;
+
+    if (rect->width == 0 || rect->height == 0 || bytes_per_pixel == 0) {
+        return false;
+    }
+
+    if ((uint32_t)rect->x + rect->width > frame_width ||
+        (uint32_t)rect->y + rect->height > frame_height) {
+        return false;
+    }
+
+    if (((align & DCMI_CROP_EVEN_X) && (rect->x & 1)) ||
+        ((align & DCMI_CROP_EVEN_Y) && (rect->y & 1))) {
+        return false;
+    }
+
+    hoffcnt = (uint32_t)rect->x * bytes_per_pixel;
+    capcnt = (uint32_t)rect->width * bytes_per_pixel;
+
+    /* The DMA moves 32 bits words, every line must be word sized. */
+    if (capcnt % 4 != 0) {
+        return false;
+    }
+
+    if (hoffcnt > DCMI_CROP_MAX_PCLK || capcnt > DCMI_CROP_MAX_PCLK + 1 ||
+        rect->y > DCMI_CROP_MAX_VST || rect->height > DCMI_CROP_MAX_LINES + 1) {
+        return false;
+    }
+
+    window->hoffcnt = hoffcnt;
+    window->vst = rect->y;
+    window->capcnt = capcnt;
+    window->vline = rect->height;
+
+    return true;
+}
+
+void dcmi_crop_clamp(dcmi_crop_rect_t *rect, uint16_t frame_width, uint16_t frame_height)
+{
+    if (rect->width > frame_width) {
+        rect->width = frame_width;
+    }
+    if (rect->height > frame_height) {
+        rect->height = frame_height;
+    }
+    if ((uint32_t)rect->x + rect->width > frame_width) {
+        rect->x = frame_width - rect->width;
+    }
+    if ((uint32_t)rect->y + rect->height > frame_height) {
+        rect->y = frame_height - rect->height;
+    }
+}
+
+uint32_t dcmi_crop_size(const dcmi_crop_window_t *window)
+{
+    return (uint32_t)window->capcnt * window->vline;
+}
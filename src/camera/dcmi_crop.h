@@ -0,0 +1,71 @@
+#ifndef DCMI_CROP_H
+#define DCMI_CROP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest horizontal offset / capture count, in pixel clocks (14 bits). */
+#define DCMI_CROP_MAX_PCLK 0x3FFF
+
+/** Largest vertical start / line count (13 and 14 bits). */
+#define DCMI_CROP_MAX_VST 0x1FFF
+#define DCMI_CROP_MAX_LINES 0x3FFF
+
+/** Alignment constraints of the pixel format, see dcmi_crop_compute(). */
+#define DCMI_CROP_EVEN_X (1 << 0)   /**< Pixels come in pairs, e.g. YUV422. */
+#define DCMI_CROP_EVEN_Y (1 << 1)   /**< Rows come in pairs, e.g. raw Bayer. */
+
+/** Region of interest, in pixels of the sensor output. */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} dcmi_crop_rect_t;
+
+/** Crop window in DCMI units, as programmed in the CWSTRT / CWSIZE
+ * registers (but not minus one). */
+typedef struct {
+    uint16_t hoffcnt;   /**< Horizontal offset, in pixel clocks. */
+    uint16_t vst;       /**< First line captured. */
+    uint16_t capcnt;    /**< Captured width, in pixel clocks. */
+    uint16_t vline;     /**< Number of lines captured. */
+} dcmi_crop_window_t;
+
+/** Converts a rectangle to a DCMI crop window.
+ *
+ * With an 8 bits interface every byte takes one pixel clock, so the
+ * horizontal values are scaled by bytes_per_pixel (1 for greyscale,
+ * 2 for YUV422 / RGB565).
+ *
+ * align is a combination of DCMI_CROP_EVEN_X and DCMI_CROP_EVEN_Y. YUV422
+ * needs an even x so that the window starts on a Cb Y Cr Y macropixel, raw
+ * Bayer needs both so that the crop keeps the sensor pattern.
+ *
+ * @returns false if the rectangle is empty, does not fit in the frame, is
+ * not aligned as requested, or if a captured line is not a multiple of 4
+ * bytes as required by the DMA.
+ */
+bool dcmi_crop_compute(const dcmi_crop_rect_t *rect, uint16_t frame_width, uint16_t frame_height,
+                       uint8_t bytes_per_pixel, uint8_t align, dcmi_crop_window_t *window);
+
+/** Moves a rectangle so that it fits in the frame, keeping its size.
+ *
+ * Meant for tracking, where the region of interest follows a target and must
+ * not change size so that the DMA transfer does not need to be reprogrammed.
+ * The size itself is shrunk to the frame if it is larger.
+ */
+void dcmi_crop_clamp(dcmi_crop_rect_t *rect, uint16_t frame_width, uint16_t frame_height);
+
+/** Returns the number of bytes captured per frame with the given window. */
+uint32_t dcmi_crop_size(const dcmi_crop_window_t *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DCMI_CROP_H */
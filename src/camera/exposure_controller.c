@@ -0,0 +1,168 @@
+#include <ch.h>
+#include <hal.h>
+#include "exposure_controller.h"
+#include "camera_control.h"
+#include "po8030.h"
+#include "frame_consumer.h"
+#include "main.h"
+
+static struct {
+    parameter_namespace_t ns;
+    parameter_t ae_enabled, awb_enabled;
+    parameter_t target;
+    parameter_t roi_x, roi_y, roi_width, roi_height;
+    parameter_t settle_frames;
+} params;
+
+static CCM_BUFFER histogram_t hist;
+static exposure_controller_status_t status;
+
+/* Protects the status. */
+static MUTEX_DECL(controller_lock);
+
+/* The parameter tree has no ranges, out of range values are clamped. */
+static int32_t get_clamped(parameter_t *p, int32_t min, int32_t max)
+{
+    int32_t value = parameter_integer_get(p);
+
+    return value < min ? min : (value > max ? max : value);
+}
+
+/* Hands control back to the sensor loop, or takes it. */
+static void post_sensor_loop(camera_ctrl_kind_t kind, bool enabled)
+{
+    camera_ctrl_cmd_t cmd = {.kind = kind};
+
+    cmd.param.value = enabled;
+    camera_control_post(&cmd);
+}
+
+static THD_FUNCTION(exposure_controller_thd, p)
+{
+    frame_consumer_t consumer;
+    time_measurement_t tm;
+    frame_slot_t *frame;
+    camera_ctrl_cmd_t exposure = {.kind = CAMERA_CTRL_EXPOSURE};
+    camera_ctrl_cmd_t gain = {.kind = CAMERA_CTRL_RGB_GAIN};
+    histogram_roi_t roi = {0, 0, 0, 0};
+    uint32_t next_seq = 0, settle = 0;
+    bool ae_enabled = false, awb_enabled = false, color, ae_changed, awb_changed;
+    uint8_t u, v;
+
+    (void)p;
+    chRegSetThreadName("exposure-controller");
+
+    frame_consumer_init(&consumer, &frame_pool, &frame_ready_event);
+    chTMObjectInit(&tm);
+
+    while (true) {
+        frame = frame_consumer_wait(&consumer, FRAME_CONSUMER_YUV422 | FRAME_CONSUMER_GRAY,
+                                    PO8030_MAX_WIDTH, PO8030_MAX_HEIGHT);
+
+        if (parameter_namespace_contains_changed(&params.ns)) {
+            if (ae_enabled && !parameter_boolean_get(&params.ae_enabled)) {
+                post_sensor_loop(CAMERA_CTRL_AE, true);
+            }
+            if (awb_enabled && !parameter_boolean_get(&params.awb_enabled)) {
+                post_sensor_loop(CAMERA_CTRL_AWB, true);
+            }
+            ae_enabled = parameter_boolean_get(&params.ae_enabled);
+            awb_enabled = parameter_boolean_get(&params.awb_enabled);
+            roi.x = get_clamped(&params.roi_x, 0, PO8030_MAX_WIDTH);
+            roi.y = get_clamped(&params.roi_y, 0, PO8030_MAX_HEIGHT);
+            roi.width = get_clamped(&params.roi_width, 0, PO8030_MAX_WIDTH);
+            roi.height = get_clamped(&params.roi_height, 0, PO8030_MAX_HEIGHT);
+            settle = get_clamped(&params.settle_frames, 0, EXPOSURE_CONTROLLER_MAX_SETTLE);
+            chMtxLock(&controller_lock);
+            status.ae.target = get_clamped(&params.target, EXPOSURE_CONTROLLER_MIN_TARGET,
+                                           EXPOSURE_CONTROLLER_MAX_TARGET);
+            chMtxUnlock(&controller_lock);
+        }
+        if ((!ae_enabled && !awb_enabled) || frame->header.seq < next_seq) {
+            frame_consumer_release(&consumer, frame);
+            continue;
+        }
+
+        color = frame->header.format == FORMAT_YCBYCR;
+
+        chTMStartMeasurementX(&tm);
+        histogram_reset(&hist);
+        if (color) {
+            histogram_add_yuv422(&hist, frame->buffer, frame->header.width & ~1u, 0,
+                                 frame->header.height, &roi);
+        } else {
+            histogram_add_gray(&hist, frame->buffer, frame->header.width, 0,
+                               frame->header.height, &roi);
+        }
+        chTMStopMeasurementX(&tm);
+        if (!frame_consumer_release(&consumer, frame)) {
+            continue;
+        }
+
+        chMtxLock(&controller_lock);
+        ae_changed = ae_enabled && ae_update(&status.ae, &hist);
+        awb_changed = awb_enabled && color && awb_update(&status.awb, &hist);
+        histogram_mean_chroma(&hist, &u, &v);
+        status.mean = histogram_mean(&hist);
+        status.u = u;
+        status.v = v;
+        status.seq = consumer.last_seq;
+        status.cycles = tm.last;
+        if (ae_changed || awb_changed) {
+            status.updates++;
+        }
+        exposure.param.exposure.integral = status.ae.exposure / AE_ONE_LINE;
+        exposure.param.exposure.fractional = status.ae.exposure % AE_ONE_LINE;
+        gain.param.gain.r = status.awb.gain_r;
+        gain.param.gain.g = status.awb.gain_g;
+        gain.param.gain.b = status.awb.gain_b;
+        chMtxUnlock(&controller_lock);
+
+        if (!ae_changed && !awb_changed) {
+            continue;
+        }
+
+        /* Sent as one batch, applied by the camera control thread in the
+         * next vertical blanking. The following frames were exposed with the
+         * old settings, they are not metered. */
+        camera_control_begin();
+        if (ae_changed) {
+            camera_control_post(&exposure);
+        }
+        if (awb_changed) {
+            camera_control_post(&gain);
+        }
+        camera_control_commit();
+        next_seq = consumer.last_seq + 1 + settle;
+    }
+}
+
+void exposure_controller_declare_parameters(parameter_namespace_t *parent)
+{
+    ae_init(&status.ae);
+    awb_init(&status.awb);
+
+    parameter_namespace_declare(&params.ns, parent, "auto_exposure");
+    parameter_boolean_declare_with_default(&params.ae_enabled, &params.ns, "ae_enabled", false);
+    parameter_boolean_declare_with_default(&params.awb_enabled, &params.ns, "awb_enabled", false);
+    parameter_integer_declare_with_default(&params.target, &params.ns, "target", status.ae.target);
+    parameter_integer_declare_with_default(&params.roi_x, &params.ns, "roi_x", 0);
+    parameter_integer_declare_with_default(&params.roi_y, &params.ns, "roi_y", 0);
+    parameter_integer_declare_with_default(&params.roi_width, &params.ns, "roi_width", 0);
+    parameter_integer_declare_with_default(&params.roi_height, &params.ns, "roi_height", 0);
+    parameter_integer_declare_with_default(&params.settle_frames, &params.ns, "settle_frames", 2);
+}
+
+void exposure_controller_start(void)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    chThdCreateStatic(wa, sizeof(wa), NORMALPRIO - 1, exposure_controller_thd, NULL);
+}
+
+void exposure_controller_get(exposure_controller_status_t *out)
+{
+    chMtxLock(&controller_lock);
+    *out = status;
+    chMtxUnlock(&controller_lock);
+}
@@ -0,0 +1,58 @@
+#ifndef EXPOSURE_CONTROLLER_H
+#define EXPOSURE_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "parameter/parameter.h"
+#include "auto_exposure.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Range of the target setting, the mean luma can only be measured
+ * reliably away from black and from clipping. */
+#define EXPOSURE_CONTROLLER_MIN_TARGET 16
+#define EXPOSURE_CONTROLLER_MAX_TARGET 235
+
+/** Longest settle_frames setting. */
+#define EXPOSURE_CONTROLLER_MAX_SETTLE 30
+
+typedef struct {
+    ae_t ae;
+    awb_t awb;
+    uint8_t mean;           /**< Mean luma of the metering region. */
+    uint8_t u, v;           /**< Mean chroma of the metering region. */
+    uint32_t seq;           /**< Sequence number of the last metered frame. */
+    uint32_t updates;       /**< Number of settings changes sent to the sensor. */
+    uint32_t cycles;        /**< Metering time of the frame, in CPU cycles. */
+} exposure_controller_status_t;
+
+/** Declares the settings in the namespace auto_exposure of parent:
+ *
+ * - ae_enabled, awb_enabled: both off by default, the sensor's own loops
+ *   are given back control when they are turned off.
+ * - target: mean luma aimed at, clamped to EXPOSURE_CONTROLLER_MIN_TARGET
+ *   .. EXPOSURE_CONTROLLER_MAX_TARGET.
+ * - roi_x, roi_y, roi_width, roi_height: metering region, in pixels of the
+ *   captured frame, clamped to the sensor size. The whole frame is metered
+ *   while the width is 0.
+ * - settle_frames: frames skipped after a change, until it shows, at most
+ *   EXPOSURE_CONTROLLER_MAX_SETTLE.
+ *
+ * Must be called before the configuration is loaded.
+ */
+void exposure_controller_declare_parameters(parameter_namespace_t *parent);
+
+/** Starts the thread metering the published frames, greyscale frames only
+ * drive the exposure. Must be called once the camera control thread runs. */
+void exposure_controller_start(void);
+
+/** Copies the current settings and the latest statistics. */
+void exposure_controller_get(exposure_controller_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXPOSURE_CONTROLLER_H */
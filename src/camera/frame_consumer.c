@@ -0,0 +1,61 @@
+#include <ch.h>
+#include <hal.h>
+#include "frame_consumer.h"
+#include "po8030.h"
+
+/* Returns the size of a pixel if the format is accepted, 0 otherwise. */
+static uint8_t accepted_bytes_per_pixel(uint8_t format, uint8_t formats)
+{
+    if (format == FORMAT_YCBYCR && (formats & FRAME_CONSUMER_YUV422)) {
+        return 2;
+    }
+    if (format == FORMAT_YYYY && (formats & FRAME_CONSUMER_GRAY)) {
+        return 1;
+    }
+    return 0;
+}
+
+void frame_consumer_init(frame_consumer_t *consumer, frame_pool_t *pool, event_source_t *frame_ready)
+{
+    consumer->pool = pool;
+    consumer->last_seq = 0;
+    chEvtRegisterMask(frame_ready, &consumer->listener, FRAME_CONSUMER_EVENT);
+}
+
+frame_slot_t *frame_consumer_wait(frame_consumer_t *consumer, uint8_t formats,
+                                  uint16_t max_width, uint16_t max_height)
+{
+    frame_slot_t *frame;
+    uint8_t bytes_per_pixel;
+
+    while (true) {
+        chEvtWaitAny(FRAME_CONSUMER_EVENT);
+
+        frame = frame_pool_borrow_latest(consumer->pool);
+        if (frame == NULL) {
+            continue;
+        }
+
+        /* The same frame can be seen twice if it was published while the
+         * previous one was processed. */
+        bytes_per_pixel = accepted_bytes_per_pixel(frame->header.format, formats);
+        if (frame->header.seq == consumer->last_seq || bytes_per_pixel == 0 ||
+            frame->header.width > max_width || frame->header.height > max_height ||
+            frame->size < (size_t)bytes_per_pixel * frame->header.width * frame->header.height) {
+            frame_pool_release(consumer->pool, frame);
+            continue;
+        }
+
+        consumer->last_seq = frame->header.seq;
+        return frame;
+    }
+}
+
+bool frame_consumer_release(frame_consumer_t *consumer, frame_slot_t *frame)
+{
+    bool unchanged = frame_pool_unchanged(consumer->pool, frame, consumer->last_seq);
+
+    frame_pool_release(consumer->pool, frame);
+
+    return unchanged;
+}
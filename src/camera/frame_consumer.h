@@ -0,0 +1,53 @@
+#ifndef FRAME_CONSUMER_H
+#define FRAME_CONSUMER_H
+
+#include <ch.h>
+#include "frame_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Event the consumers are woken up with, a consumer thread must not use it
+ * for anything else. */
+#define FRAME_CONSUMER_EVENT EVENT_MASK(0)
+
+/** Formats a consumer accepts, see frame_consumer_wait(). */
+#define FRAME_CONSUMER_YUV422   (1 << 0)    /**< FORMAT_YCBYCR, 2 bytes per pixel. */
+#define FRAME_CONSUMER_GRAY     (1 << 1)    /**< FORMAT_YYYY, 1 byte per pixel. */
+
+/** State of a thread processing the frames of a pool. */
+typedef struct {
+    frame_pool_t *pool;
+    event_listener_t listener;
+    uint32_t last_seq;      /**< Last frame handed out, sequence numbers start at 1. */
+} frame_consumer_t;
+
+/** Registers the calling thread on the frame ready event source.
+ *
+ * Must be called from the consumer thread itself.
+ */
+void frame_consumer_init(frame_consumer_t *consumer, frame_pool_t *pool, event_source_t *frame_ready);
+
+/** Waits for a frame the consumer did not see yet and borrows it.
+ *
+ * Frames in another format than the ones in formats, larger than max_width
+ * by max_height or shorter than their header says are skipped. The frame
+ * must be given back with frame_consumer_release().
+ */
+frame_slot_t *frame_consumer_wait(frame_consumer_t *consumer, uint8_t formats,
+                                  uint16_t max_width, uint16_t max_height);
+
+/** Gives back a frame returned by frame_consumer_wait().
+ *
+ * @returns false if the DMA started overwriting the frame while it was
+ * borrowed (see frame_pool_unchanged()), whatever was computed from it must
+ * then be dropped.
+ */
+bool frame_consumer_release(frame_consumer_t *consumer, frame_slot_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_CONSUMER_H */
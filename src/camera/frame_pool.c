@@ -0,0 +1,230 @@
+#include <string.h>
+#include "frame_pool.h"
+#include "camera_port.h"
+
+static void slot_recycle(frame_pool_t *pool, frame_slot_t *slot)
+{
+    if (slot->state == FRAME_SLOT_READY && !slot->dma && slot != pool->latest && slot->refs == 0) {
+        slot->state = FRAME_SLOT_FREE;
+        slot->size = 0;
+    }
+}
+
+void frame_pool_init(frame_pool_t *pool, uint8_t *storage, size_t storage_size)
+{
+    memset(pool, 0, sizeof(frame_pool_t));
+    pool->storage = storage;
+    pool->storage_size = storage_size;
+}
+
+uint8_t frame_pool_configure(frame_pool_t *pool, size_t slot_size)
+{
+    uint8_t i, n;
+
+    /* Round the slots up so that every one of them stays aligned. */
+    slot_size = (slot_size + FRAME_POOL_ALIGNMENT - 1) & ~(size_t)(FRAME_POOL_ALIGNMENT - 1);
+
+    if (slot_size == 0 || slot_size > pool->storage_size) {
+        return 0;
+    }
+
+    CAMERA_LOCK();
+
+    for (i = 0; i < pool->num_slots; i++) {
+        if (pool->slots[i].refs != 0 || pool->slots[i].dma) {
+            CAMERA_UNLOCK();
+            return 0;
+        }
+    }
+
+    n = pool->storage_size / slot_size;
+    if (n > FRAME_POOL_MAX_SLOTS) {
+        n = FRAME_POOL_MAX_SLOTS;
+    }
+
+    memset(pool->slots, 0, sizeof(pool->slots));
+    for (i = 0; i < n; i++) {
+        pool->slots[i].buffer = &pool->storage[i * slot_size];
+    }
+    pool->latest = NULL;
+    pool->slot_size = slot_size;
+    pool->num_slots = n;
+
+    CAMERA_UNLOCK();
+
+    return n;
+}
+
+frame_slot_t *frame_pool_acquire(frame_pool_t *pool)
+{
+    frame_slot_t *slot = NULL;
+    uint8_t i;
+
+    CAMERA_LOCK();
+
+    for (i = 0; i < pool->num_slots; i++) {
+        if (pool->slots[i].state == FRAME_SLOT_FREE) {
+            slot = &pool->slots[i];
+            slot->state = FRAME_SLOT_CAPTURE;
+            slot->dma = true;
+            break;
+        }
+    }
+
+    CAMERA_UNLOCK();
+
+    return slot;
+}
+
+frame_slot_t *frame_pool_reclaim(frame_pool_t *pool)
+{
+    frame_slot_t *slot;
+
+    CAMERA_LOCK();
+
+    slot = pool->latest;
+    if (slot == NULL || slot->refs != 0 || slot->dma) {
+        slot = NULL;
+    } else {
+        if (!slot->consumed) {
+            pool->overwritten++;
+        }
+        slot->state = FRAME_SLOT_CAPTURE;
+        slot->size = 0;
+        slot->dma = true;
+        pool->latest = NULL;
+    }
+
+    CAMERA_UNLOCK();
+
+    return slot;
+}
+
+void frame_pool_abort(frame_pool_t *pool, frame_slot_t *slot)
+{
+    (void) pool;
+
+    CAMERA_LOCK();
+
+    if (slot->state == FRAME_SLOT_CAPTURE) {
+        slot->state = FRAME_SLOT_FREE;
+        slot->dma = false;
+    }
+
+    CAMERA_UNLOCK();
+}
+
+void frame_pool_detach(frame_pool_t *pool, frame_slot_t *slot)
+{
+    CAMERA_LOCK();
+
+    slot->dma = false;
+    if (slot->state == FRAME_SLOT_CAPTURE) {
+        slot->state = FRAME_SLOT_FREE;
+    } else {
+        slot_recycle(pool, slot);
+    }
+
+    CAMERA_UNLOCK();
+}
+
+void frame_pool_publish(frame_pool_t *pool, frame_slot_t *slot, size_t len)
+{
+    frame_slot_t *previous;
+
+    CAMERA_LOCK();
+
+    previous = pool->latest;
+    slot->state = FRAME_SLOT_READY;
+    slot->size = len;
+    slot->consumed = false;
+    slot->header.seq = ++pool->sequence;
+    pool->latest = slot;
+
+    if (previous != NULL && previous != slot) {
+        if (!previous->consumed) {
+            pool->overwritten++;
+        }
+        slot_recycle(pool, previous);
+    }
+
+    CAMERA_UNLOCK();
+}
+
+frame_slot_t *frame_pool_borrow_latest(frame_pool_t *pool)
+{
+    frame_slot_t *slot;
+
+    CAMERA_LOCK();
+
+    slot = pool->latest;
+    if (slot != NULL) {
+        slot->refs++;
+        slot->consumed = true;
+    }
+
+    CAMERA_UNLOCK();
+
+    return slot;
+}
+
+void frame_pool_retain(frame_pool_t *pool, frame_slot_t *slot)
+{
+    (void) pool;
+
+    CAMERA_LOCK();
+    slot->refs++;
+    CAMERA_UNLOCK();
+}
+
+bool frame_pool_unchanged(frame_pool_t *pool, const frame_slot_t *slot, uint32_t seq)
+{
+    bool unchanged;
+
+    CAMERA_LOCK();
+    /* The DMA only moves on to a slot once the other one was published. */
+    unchanged = !slot->dma || (slot->header.seq == seq && pool->latest == slot);
+    CAMERA_UNLOCK();
+
+    return unchanged;
+}
+
+void frame_pool_release(frame_pool_t *pool, frame_slot_t *slot)
+{
+    CAMERA_LOCK();
+
+    if (slot->refs > 0) {
+        slot->refs--;
+    }
+    slot_recycle(pool, slot);
+
+    CAMERA_UNLOCK();
+}
+
+uint32_t frame_pool_overwritten_count(frame_pool_t *pool)
+{
+    uint32_t n;
+
+    CAMERA_LOCK();
+    n = pool->overwritten;
+    CAMERA_UNLOCK();
+
+    return n;
+}
+
+uint8_t frame_pool_free_count(frame_pool_t *pool)
+{
+    uint8_t i, n = 0;
+
+    CAMERA_LOCK();
+
+    for (i = 0; i < pool->num_slots; i++) {
+        if (pool->slots[i].state == FRAME_SLOT_FREE) {
+            n++;
+        }
+    }
+
+    CAMERA_UNLOCK();
+
+    return n;
+}
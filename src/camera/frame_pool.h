@@ -0,0 +1,171 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of frames a pool can be split into. */
+#define FRAME_POOL_MAX_SLOTS 4
+
+/** Alignment of every slot in the pool, in bytes.
+ *
+ * The DCMI DMA writes memory with bursts of four 32 bits words, which must
+ * start on a 16 bytes boundary.
+ */
+#define FRAME_POOL_ALIGNMENT 16
+
+typedef enum {
+    FRAME_SLOT_FREE = 0,    /**< Can be handed to the DMA. */
+    FRAME_SLOT_CAPTURE,     /**< Owned by the DMA, being filled. */
+    FRAME_SLOT_READY,       /**< Contains a complete frame. */
+} frame_slot_state_t;
+
+/** The DCMI reported an overrun while the frame was captured, part of the
+ * data is missing. */
+#define FRAME_FLAG_OVERRUN      (1 << 0)
+/** A DMA error occurred while the frame was captured. */
+#define FRAME_FLAG_DMA_ERROR    (1 << 1)
+
+/** Description of a captured frame, filled by the producer before
+ * publishing it (except for seq, which is set by the pool). */
+typedef struct {
+    uint32_t seq;       /**< Sequence number, set when published. */
+    uint32_t t_start;   /**< Capture start, in realtime counter ticks. */
+    uint32_t t_end;     /**< Capture end, in realtime counter ticks. */
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;     /**< Sensor output format (format_t). */
+    uint8_t flags;      /**< FRAME_FLAG_* bitmask. */
+} frame_header_t;
+
+typedef struct {
+    uint8_t *buffer;
+    size_t size;        /**< Number of valid bytes in buffer. */
+    frame_slot_state_t state;
+    uint8_t refs;       /**< Number of consumers currently borrowing the slot. */
+    bool consumed;      /**< Borrowed at least once since it was published. */
+    bool dma;           /**< Still a DMA target, even once published. */
+    frame_header_t header;
+} frame_slot_t;
+
+typedef struct {
+    frame_slot_t slots[FRAME_POOL_MAX_SLOTS];
+    frame_slot_t *latest;   /**< Most recently completed frame or NULL. */
+    uint8_t *storage;
+    size_t storage_size;
+    size_t slot_size;
+    uint8_t num_slots;
+    uint32_t sequence;      /**< Number of frames published so far. */
+    uint32_t overwritten;   /**< Frames replaced before anybody borrowed them. */
+} frame_pool_t;
+
+/** Initializes an empty pool backed by the given storage.
+ *
+ * @note storage must be aligned on FRAME_POOL_ALIGNMENT bytes and must stay
+ * valid for the whole lifetime of the pool.
+ */
+void frame_pool_init(frame_pool_t *pool, uint8_t *storage, size_t storage_size);
+
+/** Splits the pool storage into as many slots of slot_size bytes as possible.
+ *
+ * All previous frames are discarded.
+ *
+ * @returns The number of slots created, or 0 if the pool is still in use
+ * (a slot is borrowed or still a DMA target) or if a single slot does not
+ * fit.
+ */
+uint8_t frame_pool_configure(frame_pool_t *pool, size_t slot_size);
+
+/** Takes a free slot and hands its ownership to the capture hardware.
+ *
+ * The slot stays owned by the DMA until frame_pool_detach(), publishing it
+ * does not give it back: without buffer rotation the DMA keeps capturing
+ * into the published slot, which therefore never goes back to the free
+ * list.
+ *
+ * @returns The slot to fill, or NULL if all slots are in use.
+ */
+frame_slot_t *frame_pool_acquire(frame_pool_t *pool);
+
+/** Takes the latest frame back for the capture hardware if nobody borrows it.
+ *
+ * Meant for the DMA when no slot is free: the latest frame also holds a slot,
+ * so with three slots rotating buffers would otherwise never find a free one
+ * again. The frame is about to be replaced by the one being published anyway.
+ *
+ * @returns The slot to fill, or NULL if there is no latest frame or if it is
+ * borrowed.
+ */
+frame_slot_t *frame_pool_reclaim(frame_pool_t *pool);
+
+/** Gives a slot back to the free list without publishing it, for example
+ * when a capture is cancelled. */
+void frame_pool_abort(frame_pool_t *pool, frame_slot_t *slot);
+
+/** Tells the pool that the DMA does not write to a slot anymore, because it
+ * was replaced by another one or because the capture stopped.
+ *
+ * A slot that was never published goes back to the free list, a published
+ * one once it is not the latest frame and nobody borrows it.
+ */
+void frame_pool_detach(frame_pool_t *pool, frame_slot_t *slot);
+
+/** Marks a captured slot as containing a complete frame of len bytes.
+ *
+ * The rest of the slot header must have been filled beforehand.
+ * The frame gets the next sequence number, starting at 1, so that consumers
+ * can tell new frames apart and detect dropped ones. The numbering is kept
+ * across frame_pool_configure().
+ *
+ * The slot becomes the latest frame of the pool. The previous latest frame
+ * goes back to the free list unless a consumer is still borrowing it.
+ */
+void frame_pool_publish(frame_pool_t *pool, frame_slot_t *slot, size_t len);
+
+/** Borrows the latest complete frame.
+ *
+ * The caller must give it back with frame_pool_release() once done.
+ *
+ * @returns The latest frame or NULL if no frame was captured yet.
+ */
+frame_slot_t *frame_pool_borrow_latest(frame_pool_t *pool);
+
+/** Adds a reference to an already borrowed frame, so it can be handed over
+ * to another consumer without copying it. */
+void frame_pool_retain(frame_pool_t *pool, frame_slot_t *slot);
+
+/** Tells whether a borrowed frame still holds the frame seq.
+ *
+ * A slot still owned by the DMA is overwritten by the next capture once a
+ * newer frame is published, consumers of such slots call this after reading
+ * and drop what they computed if it returns false.
+ *
+ * @note With a single buffer the DMA starts writing the slot again as soon as
+ * it is published, only the end of the next capture is detected then.
+ */
+bool frame_pool_unchanged(frame_pool_t *pool, const frame_slot_t *slot, uint32_t seq);
+
+/** Gives back a borrowed frame.
+ *
+ * When the last consumer releases a frame that is not the latest one anymore
+ * the slot goes back to the free list.
+ */
+void frame_pool_release(frame_pool_t *pool, frame_slot_t *slot);
+
+/** Returns the number of frames replaced by a newer one before any consumer
+ * borrowed them. */
+uint32_t frame_pool_overwritten_count(frame_pool_t *pool);
+
+/** Returns the number of slots that can currently be acquired. */
+uint8_t frame_pool_free_count(frame_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_POOL_H */
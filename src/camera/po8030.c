@@ -1,10 +1,20 @@
+#include <string.h>
 #include "po8030.h"
+#include "po8030_regcache.h"
 #include "ch.h"
 #include "usbcfg.h"
 #include "chprintf.h"
 
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Table entries writing a 16 bits value in a pair of _H/_L registers. */
+#define PO8030_REG16(bank, reg, value)                  \
+    {(bank), reg##_H, (uint8_t)((value) >> 8)},         \
+    {(bank), reg##_L, (uint8_t)((value) & 0xFF)}
+
 i2cflags_t errors = 0;
 static struct po8030_configuration po8030_conf;
+static po8030_regcache_t regcache;
 
 /**********************************************************************/
 static format_t currFormat = FORMAT_YCBYCR;
@@ -74,7 +84,53 @@ int8_t write_reg(uint8_t addr, uint8_t reg, uint8_t value) {
     return MSG_OK;
 }
 
+static int8_t bus_write(void *arg, uint8_t reg, uint8_t value) {
+    (void) arg;
+    return write_reg(PO8030_ADDR, reg, value);
+}
+
+static int8_t bus_read(void *arg, uint8_t reg, uint8_t *value) {
+    (void) arg;
+    return read_reg(PO8030_ADDR, reg, value);
+}
+
+#if PO8030_USE_BURST_WRITE
+static int8_t bus_write_burst(void *arg, uint8_t reg, const uint8_t *values, uint8_t n) {
+	systime_t timeout = MS2ST(4); // 4 ms
+	uint8_t txbuf[PO8030_REGCACHE_MAX_BURST + 1];
+	(void) arg;
+
+	txbuf[0] = reg;
+	memcpy(&txbuf[1], values, n);
+
+	i2cAcquireBus(&I2CD1);
+	msg_t status = i2cMasterTransmitTimeout(&I2CD1, PO8030_ADDR, txbuf, n + 1, NULL, 0, timeout);
+	i2cReleaseBus(&I2CD1);
+
+	if (status != MSG_OK){
+        errors = i2cGetErrors(&I2CD1);
+		return status;
+	}
+
+    return MSG_OK;
+}
+#endif
+
+/* Register accesses in the currently selected bank, going through the shadow. */
+static int8_t write_cached(uint8_t reg, uint8_t value) {
+    return po8030_regcache_write(&regcache, reg, value);
+}
+
+static int8_t read_cached(uint8_t reg, uint8_t *value) {
+    return po8030_regcache_read(&regcache, reg, value);
+}
+
 void po8030_init(void) {
+#if PO8030_USE_BURST_WRITE
+    static const po8030_bus_t bus = {bus_write, bus_read, bus_write_burst, NULL};
+#else
+    static const po8030_bus_t bus = {bus_write, bus_read, NULL, NULL};
+#endif
 
     static const I2CConfig i2cfg1 = {
         OPMODE_I2C,
@@ -90,6 +146,19 @@ void po8030_init(void) {
     chThdSleepMilliseconds(100);
     palWritePad(GPIOC, GPIOC_CAM_RST, PAL_HIGH);
 
+    // The sensor is back to its default values, start with an empty shadow.
+    po8030_regcache_init(&regcache, &bus);
+    // Registers updated by the sensor when auto exposure or auto white balance are enabled.
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_INTTIME_H);
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_INTTIME_M);
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_INTTIME_L);
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_WB_RGAIN);
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_WB_GGAIN);
+    po8030_regcache_mark_uncached(&regcache, BANK_A, PO8030_REG_WB_BGAIN);
+    po8030_regcache_mark_uncached(&regcache, BANK_C, PO8030_REG_EXPOSURE_T);
+    po8030_regcache_mark_uncached(&regcache, BANK_C, PO8030_REG_EXPOSURE_H);
+    po8030_regcache_mark_uncached(&regcache, BANK_C, PO8030_REG_EXPOSURE_M);
+    po8030_regcache_mark_uncached(&regcache, BANK_C, PO8030_REG_EXPOSURE_L);
 }
 
 int8_t po8030_read_id(uint16_t *id) {
@@ -108,7 +177,7 @@ int8_t po8030_read_id(uint16_t *id) {
 }
 
 int8_t po8030_set_bank(uint8_t bank) {
-    return write_reg(PO8030_ADDR, REG_BANK, bank);
+    return po8030_regcache_select_bank(&regcache, bank);
 }
 
 int8_t po8030_set_format(format_t fmt) {
@@ -118,28 +187,28 @@ int8_t po8030_set_format(format_t fmt) {
         return err;
     }
 
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_FORMAT, fmt)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_FORMAT, fmt)) != MSG_OK) {
         return err;
     }
 
     if(fmt == FORMAT_YYYY) {
-        if((err = write_reg(PO8030_ADDR, PO8030_REG_SYNC_CONTROL0, 0x01)) != MSG_OK) {
+        if((err = write_cached(PO8030_REG_SYNC_CONTROL0, 0x01)) != MSG_OK) {
             return err;
         }
         if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
             return err;
         }
-        if((err = write_reg(PO8030_ADDR, PO8030_REG_VSYNCSTARTROW_L, 0x03)) != MSG_OK) {
+        if((err = write_cached(PO8030_REG_VSYNCSTARTROW_L, 0x03)) != MSG_OK) {
             return err;
         }
     } else {
-        if((err = write_reg(PO8030_ADDR, PO8030_REG_SYNC_CONTROL0, 0x00)) != MSG_OK) {
+        if((err = write_cached(PO8030_REG_SYNC_CONTROL0, 0x00)) != MSG_OK) {
             return err;
         }
         if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
             return err;
         }
-        if((err = write_reg(PO8030_ADDR, PO8030_REG_VSYNCSTARTROW_L, 0x0A)) != MSG_OK) {
+        if((err = write_cached(PO8030_REG_VSYNCSTARTROW_L, 0x0A)) != MSG_OK) {
             return err;
         }
     }
@@ -149,390 +218,143 @@ int8_t po8030_set_format(format_t fmt) {
     return MSG_OK;
 }
 
-int8_t po8030_set_vga(void) {
-    int8_t err = 0;
-
-    if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
-        return err;
-    }
+/* Register tables of the predefined sizes, applied by po8030_apply_preset. */
+static const po8030_reg_t po8030_vga_regs[] = {
     // Window settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_H, 0x02)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_L, 0x80)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_L, 0xE0)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX2, 0x0280),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY2, 0x01E0),
     // AE full window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_H, 0x02)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_L, 0x80)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_L, 0xE0)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX2, 0x0280),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY2, 0x01E0),
     // AE center window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_L, 0xD6)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_L, 0xAB)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_L, 0xA1)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_L, 0x40)) != MSG_OK) {
-        return err;
-    }
-
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX1, 0x00D6),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX2, 0x01AB),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY1, 0x00A1),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY2, 0x0140),
     // Scale settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_X, 0x20)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_Y, 0x20)) != MSG_OK) {
-        return err;
-    }
-
-	po8030_conf.width = 640;
-	po8030_conf.height = 480;
-	po8030_conf.curr_subsampling_x = SUBSAMPLING_X1;
-	po8030_conf.curr_subsampling_y = SUBSAMPLING_X1;
-	
-    return MSG_OK;
-}
-
-int8_t po8030_set_qvga(void) {
-    int8_t err = 0;
+    {BANK_B, PO8030_REG_SCALE_X, 0x20},
+    {BANK_B, PO8030_REG_SCALE_Y, 0x20},
+};
 
-    if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
-        return err;
-    }
+static const po8030_reg_t po8030_qvga_regs[] = {
     // Window settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_L, 0x40)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_L, 0xF0)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX2, 0x0140),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY2, 0x00F0),
     // AE full window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_H, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_L, 0x40)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_L, 0xF0)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX2, 0x0140),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY2, 0x00F0),
     // AE center window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_L, 0x6B)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_L, 0xD6)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_L, 0x50)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_L, 0xA0)) != MSG_OK) {
-        return err;
-    }
-
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX1, 0x006B),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX2, 0x00D6),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY1, 0x0050),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY2, 0x00A0),
     // Scale settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_X, 0x40)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_Y, 0x40)) != MSG_OK) {
-        return err;
-    }
-	
-	po8030_conf.width = 320;
-	po8030_conf.height = 240;
-	po8030_conf.curr_subsampling_x = SUBSAMPLING_X1;
-	po8030_conf.curr_subsampling_y = SUBSAMPLING_X1;
+    {BANK_B, PO8030_REG_SCALE_X, 0x40},
+    {BANK_B, PO8030_REG_SCALE_Y, 0x40},
+};
 
-    return MSG_OK;
-}
-
-int8_t po8030_set_qqvga(void) {
-    int8_t err = 0;
-
-    if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
-        return err;
-    }
+static const po8030_reg_t po8030_qqvga_regs[] = {
     // Window settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_L, 0xA0)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_L, 0x78)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWX2, 0x00A0),
+    PO8030_REG16(BANK_A, PO8030_REG_WINDOWY2, 0x0078),
     // AE full window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_L, 0xA0)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_L, 0x01)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_L, 0x78)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX2, 0x00A0),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY1, 0x0001),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY2, 0x0078),
     // AE center window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_L, 0x36)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_L, 0x6B)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_L, 0x29)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_H, 0x00)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_L, 0x50)) != MSG_OK) {
-        return err;
-    }
-
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
-    }
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX1, 0x0036),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX2, 0x006B),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY1, 0x0029),
+    PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY2, 0x0050),
     // Scale settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_X, 0x80)) != MSG_OK) {
-        return err;
+    {BANK_B, PO8030_REG_SCALE_X, 0x80},
+    {BANK_B, PO8030_REG_SCALE_Y, 0x80},
+};
+
+struct po8030_preset {
+    const po8030_reg_t *regs;
+    size_t len;
+    uint16_t width;
+    uint16_t height;
+};
+
+static const struct po8030_preset po8030_presets[] = {
+    [SIZE_VGA] = {po8030_vga_regs, ARRAY_LEN(po8030_vga_regs), 640, 480},
+    [SIZE_QVGA] = {po8030_qvga_regs, ARRAY_LEN(po8030_qvga_regs), 320, 240},
+    [SIZE_QQVGA] = {po8030_qqvga_regs, ARRAY_LEN(po8030_qqvga_regs), 160, 120},
+};
+
+/* Scale buffer size depends on both format and size, indexed by [greyscale][size]. */
+static const po8030_reg_t po8030_scale_buffer_regs[2][3][2] = {
+    {
+        [SIZE_VGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x000A)},
+        [SIZE_QVGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x0146)}, // To be tested...
+        [SIZE_QQVGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x00F5)},
+    },
+    {
+        [SIZE_VGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x0008)},
+        [SIZE_QVGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x00A4)},
+        [SIZE_QQVGA] = {PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, 0x007C)},
+    },
+};
+
+static int8_t po8030_apply_preset(image_size_t imgsize) {
+    const struct po8030_preset *preset;
+    int8_t err = 0;
+
+    if(imgsize >= ARRAY_LEN(po8030_presets)) {
+        return -1;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_Y, 0x80)) != MSG_OK) {
+    preset = &po8030_presets[imgsize];
+
+    if((err = po8030_regcache_apply(&regcache, preset->regs, preset->len)) != MSG_OK) {
         return err;
     }
 
-	po8030_conf.width = 160;
-	po8030_conf.height = 120;
+	po8030_conf.width = preset->width;
+	po8030_conf.height = preset->height;
 	po8030_conf.curr_subsampling_x = SUBSAMPLING_X1;
 	po8030_conf.curr_subsampling_y = SUBSAMPLING_X1;
-	
+
     return MSG_OK;
 }
 
+int8_t po8030_set_vga(void) {
+    return po8030_apply_preset(SIZE_VGA);
+}
+
+int8_t po8030_set_qvga(void) {
+    return po8030_apply_preset(SIZE_QVGA);
+}
+
+int8_t po8030_set_qqvga(void) {
+    return po8030_apply_preset(SIZE_QQVGA);
+}
+
 int8_t po8030_set_size(image_size_t imgsize) {
-    if(imgsize == SIZE_VGA) {
-        return po8030_set_vga();
-    } else if(imgsize == SIZE_QVGA) {
-        return po8030_set_qvga();
-    } else if(imgsize == SIZE_QQVGA) {
-        return po8030_set_qqvga();
-    } else {
-		return -1;
-	}
+    return po8030_apply_preset(imgsize);
 }
 
 int8_t po8030_set_scale_buffer_size(format_t fmt, image_size_t imgsize) {
-    // Scale buffer size depends on both format and size
-    int8_t err = 0;
+    const po8030_reg_t *regs;
 
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
+    if(imgsize >= ARRAY_LEN(po8030_presets)) {
+        return -1;
     }
+    regs = po8030_scale_buffer_regs[po8030_get_bytes_per_pixel(fmt) == 1 ? 1 : 0][imgsize];
 
-    if(fmt == FORMAT_YYYY) {
-        switch(imgsize) {
-            case SIZE_VGA:
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x00)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0x08)) != MSG_OK) {
-                    return err;
-                }
-                break;
-
-            case SIZE_QVGA:
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x00)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0xA4)) != MSG_OK) {
-                    return err;
-                }
-                break;
-
-            case SIZE_QQVGA:
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x00)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0x7C)) != MSG_OK) {
-                    return err;
-                }
-                break;
-        }
-    } else {
-        switch(imgsize) {
-            case SIZE_VGA:
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x00)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0x0A)) != MSG_OK) {
-                    return err;
-                }
-                break;
-
-            case SIZE_QVGA: // To be tested...
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x01)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0x46)) != MSG_OK) {
-                    return err;
-                }
-                break;
-
-            case SIZE_QQVGA:
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, 0x00)) != MSG_OK) {
-                    return err;
-                }
-                if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, 0xF5)) != MSG_OK) {
-                    return err;
-                }
-                break;
-        }
-    }
-
-    return MSG_OK;
+    return po8030_regcache_apply(&regcache, regs, 2);
 }
 
 int8_t po8030_config(format_t fmt, image_size_t imgsize) {
@@ -542,7 +364,7 @@ int8_t po8030_config(format_t fmt, image_size_t imgsize) {
     if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_PAD_CONTROL, 0x00)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_PAD_CONTROL, 0x00)) != MSG_OK) {
         return err;
     }
 
@@ -651,7 +473,7 @@ int8_t po8030_advanced_config(format_t fmt, unsigned int x1, unsigned int y1, un
     if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_PAD_CONTROL, 0x00)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_PAD_CONTROL, 0x00)) != MSG_OK) {
         return err;
     }
 
@@ -659,115 +481,40 @@ int8_t po8030_advanced_config(format_t fmt, unsigned int x1, unsigned int y1, un
         return err;
     }
 	
-    if((err = po8030_set_bank(BANK_A)) != MSG_OK) {
-        return err;
-    }
-    // Window settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_H, (x1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX1_L, (x1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_H, (y1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY1_L, (y1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_H, (x2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWX2_L, (x2&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_H, (y2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WINDOWY2_L, (y2&0xFF))) != MSG_OK) {
-        return err;
-    }
-    // AE full window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_H, (x1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX1_L, (x1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_H, (x2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWX2_L, (x2&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_H, (y1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY1_L, (y1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_H, (y2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_FWY2_L, (y2&0xFF))) != MSG_OK) {
-        return err;
-    }
-    // AE center window selection.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_H, (auto_cw_x1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX1_L, (auto_cw_x1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_H, (auto_cw_x2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWX2_L, (auto_cw_x2&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_H, (auto_cw_y1>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY1_L, (auto_cw_y1&0xFF))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_H, (auto_cw_y2>>8))) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_AUTO_CWY2_L, (auto_cw_y2&0xFF))) != MSG_OK) {
-        return err;
-    }
-
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
-    }
-    // Scale settings.
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_X, subsampling_x)) != MSG_OK) {
-        return err;
-    }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_Y, subsampling_y)) != MSG_OK) {
-        return err;
-    }	
-	
-	// Set scale buffer.
-    if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
-        return err;
-    }
-
-    if(fmt == FORMAT_YYYY) {
+    if(po8030_get_bytes_per_pixel(fmt) == 1) {
 		scale_th_f = (648.0-(float)(x2-x1))*((float)(x2-x1)+8.0)/(656.0);
 		scale_th = (unsigned int)scale_th_f;
 	} else {
 		scale_th_f = ((648.0-(float)(x2-x1))*2.0)*((float)(x2-x1)*2.0+8.0)/(1304.0);
 		scale_th = (unsigned int)scale_th_f;
 	}
-	
-	if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_H, (scale_th>>8))) != MSG_OK) {
-		return err;
-	}
-	if((err = write_reg(PO8030_ADDR, PO8030_REG_SCALE_TH_L, (scale_th&0xFF))) != MSG_OK) {
-		return err;
-	}
+
+    const po8030_reg_t regs[] = {
+        // Window settings.
+        PO8030_REG16(BANK_A, PO8030_REG_WINDOWX1, x1),
+        PO8030_REG16(BANK_A, PO8030_REG_WINDOWY1, y1),
+        PO8030_REG16(BANK_A, PO8030_REG_WINDOWX2, x2),
+        PO8030_REG16(BANK_A, PO8030_REG_WINDOWY2, y2),
+        // AE full window selection.
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX1, x1),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWX2, x2),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY1, y1),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_FWY2, y2),
+        // AE center window selection.
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX1, auto_cw_x1),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWX2, auto_cw_x2),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY1, auto_cw_y1),
+        PO8030_REG16(BANK_A, PO8030_REG_AUTO_CWY2, auto_cw_y2),
+        // Scale settings.
+        {BANK_B, PO8030_REG_SCALE_X, subsampling_x},
+        {BANK_B, PO8030_REG_SCALE_Y, subsampling_y},
+        // Scale buffer.
+        PO8030_REG16(BANK_B, PO8030_REG_SCALE_TH, scale_th),
+    };
+
+    if((err = po8030_regcache_apply(&regcache, regs, ARRAY_LEN(regs))) != MSG_OK) {
+        return err;
+    }
 	
 	po8030_conf.width = x2 - x1 + 1;
 	po8030_conf.height = y2 - y1 + 1;
@@ -787,7 +534,7 @@ int8_t po8030_set_brightness(uint8_t value) {
     if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
         return err;
     }
-	return write_reg(PO8030_ADDR, PO8030_REG_BRIGHTNESS, value);
+	return write_cached(PO8030_REG_BRIGHTNESS, value);
 }
 
 /*! Set contrast.
@@ -798,7 +545,7 @@ int8_t po8030_set_contrast(uint8_t value) {
     if((err = po8030_set_bank(BANK_B)) != MSG_OK) {
         return err;
     }
-	return write_reg(PO8030_ADDR, PO8030_REG_CONTRAST, value);
+	return write_cached(PO8030_REG_CONTRAST, value);
 }
 
 /*! Set mirroring for both vertical and horizontal orientations.
@@ -820,7 +567,7 @@ int8_t po8030_set_mirror(uint8_t vertical, uint8_t horizontal) {
 		value |= 0x40;
 	}
 	
-	return write_reg(PO8030_ADDR, PO8030_REG_BAYER_CONTROL_01, value);
+	return write_cached(PO8030_REG_BAYER_CONTROL_01, value);
 }
 
 /*! Enable/disable auto white balance.
@@ -834,7 +581,7 @@ int8_t po8030_set_awb(uint8_t awb) {
         return err;
     }
 	
-	if((err = read_reg(PO8030_ADDR, PO8030_REG_AUTO_CONTROL_1, &value)) != MSG_OK) {
+	if((err = read_cached(PO8030_REG_AUTO_CONTROL_1, &value)) != MSG_OK) {
         return err;
     }
 	
@@ -844,7 +591,7 @@ int8_t po8030_set_awb(uint8_t awb) {
 		value |= 0x04;
 	}
 	
-	return write_reg(PO8030_ADDR, PO8030_REG_AUTO_CONTROL_1, value);
+	return write_cached(PO8030_REG_AUTO_CONTROL_1, value);
 }
 
 /*! Set white balance red, green, blue gain. 
@@ -864,13 +611,13 @@ int8_t po8030_set_rgb_gain(uint8_t r, uint8_t g, uint8_t b) {
         return err;
     }
 	
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WB_RGAIN, r)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_WB_RGAIN, r)) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WB_GGAIN, g)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_WB_GGAIN, g)) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_WB_BGAIN, b)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_WB_BGAIN, b)) != MSG_OK) {
         return err;
     }	
 
@@ -888,7 +635,7 @@ int8_t po8030_set_ae(uint8_t ae) {
         return err;
     }
 	
-	if((err = read_reg(PO8030_ADDR, PO8030_REG_AUTO_CONTROL_1, &value)) != MSG_OK) {
+	if((err = read_cached(PO8030_REG_AUTO_CONTROL_1, &value)) != MSG_OK) {
         return err;
     }
 	
@@ -898,7 +645,7 @@ int8_t po8030_set_ae(uint8_t ae) {
 		value |= 0x03;
 	}
 	
-	return write_reg(PO8030_ADDR, PO8030_REG_AUTO_CONTROL_1, value);
+	return write_cached(PO8030_REG_AUTO_CONTROL_1, value);
 }
 
 /*!	Set integration time. Total integration time is: (integral + fractional/256) line time. 
@@ -917,28 +664,57 @@ int8_t po8030_set_exposure(uint16_t integral, uint8_t fractional) {
         return err;
     }
 	
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_INTTIME_H, (integral>>8))) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_INTTIME_H, (integral>>8))) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_INTTIME_M, (integral&0xFF))) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_INTTIME_M, (integral&0xFF))) != MSG_OK) {
         return err;
     }
-    if((err = write_reg(PO8030_ADDR, PO8030_REG_INTTIME_L, fractional)) != MSG_OK) {
+    if((err = write_cached(PO8030_REG_INTTIME_L, fractional)) != MSG_OK) {
         return err;
     }
 	
 	return MSG_OK;
 }
 
+/*!	Copy the current sensor configuration (output size and format).
+ */
+void po8030_get_configuration(struct po8030_configuration *conf) {
+	*conf = po8030_conf;
+}
+
 /*!	Return the current image size in bytes.
  */
 uint32_t po8030_get_image_size(void) {
-	if(po8030_conf.curr_format == FORMAT_YYYY) {
-		return (uint32_t)po8030_conf.width * (uint32_t)po8030_conf.height;
-	} else {
-		return (uint32_t)po8030_conf.width * (uint32_t)po8030_conf.height * 2;
+	return (uint32_t)po8030_conf.width * (uint32_t)po8030_conf.height * po8030_get_bytes_per_pixel(po8030_conf.curr_format);
+}
+
+/*!	Return the number of bytes per pixel of a format: one for greyscale and the raw Bayer formats, two otherwise.
+ */
+uint8_t po8030_get_bytes_per_pixel(format_t fmt) {
+	switch(fmt) {
+		case FORMAT_YYYY:
+		case FORMAT_RGGB:
+		case FORMAT_GBRG:
+		case FORMAT_GRBG:
+		case FORMAT_BGGR:
+		case FORMAT_DPC_BAYER:
+			return 1;
+		default:
+			return 2;
 	}
 }
 
 
 
+
+/*!	Return the number of I2C transactions avoided (hits) and done (misses) since the last reset of the statistics.
+ */
+void po8030_get_regcache_stats(uint32_t *hits, uint32_t *misses) {
+	*hits = regcache.hits;
+	*misses = regcache.misses;
+}
+
+void po8030_reset_regcache_stats(void) {
+	po8030_regcache_reset_stats(&regcache);
+}
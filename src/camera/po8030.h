@@ -14,6 +14,12 @@ extern "C" {
 #define PO8030_MAX_WIDTH 640
 #define PO8030_MAX_HEIGHT 480
 
+// Set to TRUE to group consecutive register writes in a single I2C transaction
+// using the sensor address auto-increment.
+#ifndef PO8030_USE_BURST_WRITE
+#define PO8030_USE_BURST_WRITE FALSE
+#endif
+
 // Shared registers
 #define REG_DEVICE_ID_H 0x00
 #define REG_DEVICE_ID_L 0x01
@@ -143,6 +149,10 @@ int8_t po8030_set_rgb_gain(uint8_t r, uint8_t g, uint8_t b);
 int8_t po8030_set_ae(uint8_t ae);
 int8_t po8030_set_exposure(uint16_t integral, uint8_t fractional);
 uint32_t po8030_get_image_size(void);
+uint8_t po8030_get_bytes_per_pixel(format_t fmt);
+void po8030_get_configuration(struct po8030_configuration *conf);
+void po8030_get_regcache_stats(uint32_t *hits, uint32_t *misses);
+void po8030_reset_regcache_stats(void);
 
 // Utility functions used with the shell.
 void po8030_save_current_format(format_t fmt);
@@ -0,0 +1,229 @@
+#include <string.h>
+#include "po8030_regcache.h"
+
+static bool bit_get(const uint32_t *bitmap, uint8_t reg)
+{
+    return (bitmap[reg / 32] & (1u << (reg % 32))) != 0;
+}
+
+static void bit_set(uint32_t *bitmap, uint8_t reg)
+{
+    bitmap[reg / 32] |= (1u << (reg % 32));
+}
+
+/* Returns true if the register can be shadowed in the current bank. */
+static bool is_cacheable(po8030_regcache_t *cache, uint8_t reg)
+{
+    if (cache->bank >= PO8030_REGCACHE_BANKS || reg < PO8030_REGCACHE_SHARED_REGS) {
+        return false;
+    }
+
+    return !bit_get(cache->uncached[cache->bank], reg);
+}
+
+static void store(po8030_regcache_t *cache, uint8_t reg, uint8_t value)
+{
+    if (is_cacheable(cache, reg)) {
+        cache->values[cache->bank][reg] = value;
+        bit_set(cache->valid[cache->bank], reg);
+    }
+}
+
+static void forget(po8030_regcache_t *cache, uint8_t reg)
+{
+    if (is_cacheable(cache, reg)) {
+        cache->valid[cache->bank][reg / 32] &= ~(1u << (reg % 32));
+    }
+}
+
+/* Returns true if writing the value would change the sensor state. */
+static bool needs_write(po8030_regcache_t *cache, uint8_t reg, uint8_t value)
+{
+    if (!is_cacheable(cache, reg) || !bit_get(cache->valid[cache->bank], reg)) {
+        return true;
+    }
+
+    return cache->values[cache->bank][reg] != value;
+}
+
+/* Returns the number of entries, starting at the first one, that are
+ * consecutive registers of the same bank. */
+static size_t run_length(const po8030_reg_t *table, size_t len)
+{
+    size_t n = 1;
+
+    if (table[0].reg < PO8030_REGCACHE_SHARED_REGS) {
+        return 1;
+    }
+
+    while (n < len && n < PO8030_REGCACHE_MAX_BURST
+           && table[n].bank == table[0].bank
+           && table[n].reg == table[0].reg + n) {
+        n++;
+    }
+
+    return n;
+}
+
+/* Writes a run of consecutive registers with a single burst, trimmed to the
+ * registers that actually change. */
+static int8_t write_run(po8030_regcache_t *cache, const po8030_reg_t *run, size_t n)
+{
+    uint8_t values[PO8030_REGCACHE_MAX_BURST];
+    size_t first = 0, last = n, i;
+    int8_t err;
+
+    while (first < n && !needs_write(cache, run[first].reg, run[first].value)) {
+        first++;
+    }
+    while (last > first && !needs_write(cache, run[last - 1].reg, run[last - 1].value)) {
+        last--;
+    }
+
+    cache->hits += n - (last - first);
+
+    if (first == last) {
+        return 0;
+    }
+
+    if (last - first == 1) {
+        return po8030_regcache_write(cache, run[first].reg, run[first].value);
+    }
+
+    for (i = first; i < last; i++) {
+        values[i - first] = run[i].value;
+    }
+
+    cache->misses++;
+    err = cache->bus.write_burst(cache->bus.arg, run[first].reg, values, last - first);
+
+    for (i = first; i < last; i++) {
+        if (err == 0) {
+            store(cache, run[i].reg, run[i].value);
+        } else {
+            forget(cache, run[i].reg);
+        }
+    }
+
+    return err;
+}
+
+void po8030_regcache_init(po8030_regcache_t *cache, const po8030_bus_t *bus)
+{
+    memset(cache, 0, sizeof(po8030_regcache_t));
+    cache->bus = *bus;
+    cache->bank = PO8030_REGCACHE_BANK_UNKNOWN;
+}
+
+void po8030_regcache_invalidate(po8030_regcache_t *cache)
+{
+    memset(cache->valid, 0, sizeof(cache->valid));
+    cache->bank = PO8030_REGCACHE_BANK_UNKNOWN;
+}
+
+void po8030_regcache_mark_uncached(po8030_regcache_t *cache, uint8_t bank, uint8_t reg)
+{
+    if (bank < PO8030_REGCACHE_BANKS) {
+        bit_set(cache->uncached[bank], reg);
+    }
+}
+
+int8_t po8030_regcache_select_bank(po8030_regcache_t *cache, uint8_t bank)
+{
+    int8_t err;
+
+    if (cache->bank == bank) {
+        cache->hits++;
+        return 0;
+    }
+
+    cache->misses++;
+    err = cache->bus.write(cache->bus.arg, PO8030_REGCACHE_BANK_REG, bank);
+
+    /* On error we cannot know if the sensor switched or not. */
+    cache->bank = (err == 0) ? bank : PO8030_REGCACHE_BANK_UNKNOWN;
+
+    return err;
+}
+
+int8_t po8030_regcache_write(po8030_regcache_t *cache, uint8_t reg, uint8_t value)
+{
+    int8_t err;
+
+    if (reg == PO8030_REGCACHE_BANK_REG) {
+        return po8030_regcache_select_bank(cache, value);
+    }
+
+    if (!needs_write(cache, reg, value)) {
+        cache->hits++;
+        return 0;
+    }
+
+    cache->misses++;
+    err = cache->bus.write(cache->bus.arg, reg, value);
+
+    if (err == 0) {
+        store(cache, reg, value);
+    } else {
+        /* The register content is unknown after a failed write. */
+        forget(cache, reg);
+    }
+
+    return err;
+}
+
+int8_t po8030_regcache_read(po8030_regcache_t *cache, uint8_t reg, uint8_t *value)
+{
+    int8_t err;
+
+    if (is_cacheable(cache, reg) && bit_get(cache->valid[cache->bank], reg)) {
+        cache->hits++;
+        *value = cache->values[cache->bank][reg];
+        return 0;
+    }
+
+    cache->misses++;
+    err = cache->bus.read(cache->bus.arg, reg, value);
+
+    if (err == 0) {
+        store(cache, reg, *value);
+    }
+
+    return err;
+}
+
+int8_t po8030_regcache_apply(po8030_regcache_t *cache, const po8030_reg_t *table, size_t len)
+{
+    size_t i = 0, n, j;
+    int8_t err;
+
+    while (i < len) {
+        if ((err = po8030_regcache_select_bank(cache, table[i].bank)) != 0) {
+            return err;
+        }
+
+        n = run_length(&table[i], len - i);
+
+        if (n > 1 && cache->bus.write_burst != NULL) {
+            if ((err = write_run(cache, &table[i], n)) != 0) {
+                return err;
+            }
+        } else {
+            for (j = 0; j < n; j++) {
+                if ((err = po8030_regcache_write(cache, table[i + j].reg, table[i + j].value)) != 0) {
+                    return err;
+                }
+            }
+        }
+
+        i += n;
+    }
+
+    return 0;
+}
+
+void po8030_regcache_reset_stats(po8030_regcache_t *cache)
+{
+    cache->hits = 0;
+    cache->misses = 0;
+}
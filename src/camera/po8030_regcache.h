@@ -0,0 +1,99 @@
+#ifndef PO8030_REGCACHE_H
+#define PO8030_REGCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PO8030_REGCACHE_BANKS 4
+
+/** Value of the bank field when the selected bank is not known, for example
+ * right after a sensor reset. */
+#define PO8030_REGCACHE_BANK_UNKNOWN 0xFF
+
+/** Registers shared between all banks (device ID and bank select).
+ *
+ * They are never cached.
+ */
+#define PO8030_REGCACHE_SHARED_REGS 0x04
+#define PO8030_REGCACHE_BANK_REG 0x03
+
+/** Maximum number of registers written in a single burst transaction. */
+#define PO8030_REGCACHE_MAX_BURST 16
+
+/** Raw register access, provided by the platform. All functions return 0
+ * on success or a negative error code. */
+typedef struct {
+    int8_t (*write)(void *arg, uint8_t reg, uint8_t value);
+    int8_t (*read)(void *arg, uint8_t reg, uint8_t *value);
+    /** Writes n consecutive registers starting at reg in a single
+     * transaction, using the sensor address auto-increment. NULL if the bus
+     * or the sensor does not support it. */
+    int8_t (*write_burst)(void *arg, uint8_t reg, const uint8_t *values, uint8_t n);
+    void *arg;
+} po8030_bus_t;
+
+/** One entry of a register table. */
+typedef struct {
+    uint8_t bank;
+    uint8_t reg;
+    uint8_t value;
+} po8030_reg_t;
+
+/** RAM shadow of the four sensor register banks. */
+typedef struct {
+    po8030_bus_t bus;
+    uint8_t bank;
+    uint8_t values[PO8030_REGCACHE_BANKS][256];
+    uint32_t valid[PO8030_REGCACHE_BANKS][256 / 32];
+    uint32_t uncached[PO8030_REGCACHE_BANKS][256 / 32];
+    uint32_t hits;      /**< Number of bus transactions avoided. */
+    uint32_t misses;    /**< Number of bus transactions done. */
+} po8030_regcache_t;
+
+/** Initializes an empty cache on top of the given bus. */
+void po8030_regcache_init(po8030_regcache_t *cache, const po8030_bus_t *bus);
+
+/** Forgets all shadowed values and the current bank, for example after the
+ * sensor was reset. Registers marked as uncached stay uncached. */
+void po8030_regcache_invalidate(po8030_regcache_t *cache);
+
+/** Marks a register whose value can be changed by the sensor itself (auto
+ * exposure, auto white balance, ...) so that it is always accessed on the bus. */
+void po8030_regcache_mark_uncached(po8030_regcache_t *cache, uint8_t bank, uint8_t reg);
+
+/** Selects the given bank, unless it is already the current one. */
+int8_t po8030_regcache_select_bank(po8030_regcache_t *cache, uint8_t bank);
+
+/** Writes a register in the current bank.
+ *
+ * The bus transaction is skipped if the sensor already holds the value.
+ */
+int8_t po8030_regcache_write(po8030_regcache_t *cache, uint8_t reg, uint8_t value);
+
+/** Reads a register in the current bank, from the shadow if possible. */
+int8_t po8030_regcache_read(po8030_regcache_t *cache, uint8_t reg, uint8_t *value);
+
+/** Applies a table of register writes, in order.
+ *
+ * Bank switches and writes of values already in the sensor are skipped.
+ * Consecutive registers of the same bank are grouped in burst transactions
+ * if the bus supports it.
+ *
+ * @returns 0 on success or the first bus error, in which case the following
+ * entries are not applied.
+ */
+int8_t po8030_regcache_apply(po8030_regcache_t *cache, const po8030_reg_t *table, size_t len);
+
+/** Resets the hit and miss counters. */
+void po8030_regcache_reset_stats(po8030_regcache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PO8030_REGCACHE_H */
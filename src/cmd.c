@@ -13,6 +13,22 @@
 #include "main.h"
 #include "config_flash_storage.h"
 #include "camera/po8030.h"
+#include "camera/camera_control.h"
+#include "camera/dcmi_crop.h"
+#include "camera/exposure_controller.h"
+#include "vision/yuv422.h"
+#include "vision/color.h"
+#include "vision/bayer.h"
+#include "vision/pyramid.h"
+#include "vision/integral.h"
+#include "vision/motion.h"
+#include "vision/flow.h"
+#include "vision/line_profile.h"
+#include "vision/lut.h"
+#include "vision/blob_tracker.h"
+#include "vision/motion_detector.h"
+#include "vision/flow_estimator.h"
+#include "vision/line_follower.h"
 
 #define TEST_WA_SIZE        THD_WORKING_AREA_SIZE(256)
 #define SHELL_WA_SIZE   THD_WORKING_AREA_SIZE(2048)
@@ -327,39 +343,67 @@ static void cmd_config_load(BaseSequentialStream *chp, int argc, char **argv)
     }
 }
 
+/* The sensor is configured by the camera control thread. The shell still
+ * waits for the result, so that the next commands (e.g. cam_dcmi_prepare)
+ * see the new configuration and errors are reported. */
+#define CAMERA_COMMAND_TIMEOUT MS2ST(1000)
+
+static void post_camera_command(BaseSequentialStream *chp, const camera_ctrl_cmd_t *cmd)
+{
+    // Static since it must stay valid until the command completed, even after a timeout.
+    static camera_control_future_t future;
+    static bool pending = false;
+    camera_ctrl_cmd_t request = *cmd;
+    int8_t err;
+
+    if (pending) {
+        if (camera_control_future_wait(&future, CAMERA_COMMAND_TIMEOUT) == MSG_TIMEOUT) {
+            chprintf(chp, "Previous request still pending\r\n");
+            return;
+        }
+        pending = false;
+    }
+
+    camera_control_future_init(&future, &request);
+    if (!camera_control_post(&request)) {
+        chprintf(chp, "Cannot queue request\r\n");
+        return;
+    }
+
+    err = camera_control_future_wait(&future, CAMERA_COMMAND_TIMEOUT);
+    if (err == MSG_TIMEOUT) {
+        pending = true;
+        chprintf(chp, "Request timed out\r\n");
+    } else if (err != MSG_OK) {
+        chprintf(chp, "Cannot write register (%d)\r\n", err);
+    } else {
+        chprintf(chp, "Register written correctly\r\n");
+    }
+}
+
 static void cmd_cam_set_brightness(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t value, err;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_BRIGHTNESS};
 
     if (argc != 1) {
         chprintf(chp,
                  "Usage: cam_brightness value.\r\nDefault=0, max=127, min=-128.\r\n");
     } else {
-        value = (int8_t) atoi(argv[0]);
-        err = po8030_set_brightness(value);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot write register (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Register written correctly\r\n");
-        }
+        cmd.param.value = (int8_t) atoi(argv[0]);
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_contrast(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t value, err;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_CONTRAST};
 
     if (argc != 1) {
         chprintf(chp,
                  "Usage: cam_contrast value.\r\nDefault=64, max=255, min=0.\r\n");
     } else {
-        value = (int8_t) atoi(argv[0]);
-        err = po8030_set_contrast(value);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot write register (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Register written correctly\r\n");
-        }
+        cmd.param.value = (uint8_t) atoi(argv[0]);
+        post_camera_command(chp, &cmd);
     }
 }
 
@@ -370,13 +414,16 @@ static void cmd_cam_set_adv_conf_fmt(BaseSequentialStream *chp, int argc, char *
 
     if (argc != 1) {
         chprintf(chp,
-                 "Usage: cam_adv_conf_fmt format\r\nformat: 0=color, 1=grey\r\n");
+                 "Usage: cam_adv_conf_fmt format\r\nformat: 0=color, 1=grey, 2=raw bayer (RGGB)\r\n");
     } else {
         f = (uint8_t) atoi(argv[0]);
 
         if(f==0) {
             fmt = FORMAT_YCBYCR;
             chprintf(chp, "Registered color format\r\n");
+        } else if(f==2) {
+            fmt = FORMAT_RGGB;
+            chprintf(chp, "Registered raw bayer format\r\n");
         } else {
             fmt = FORMAT_YYYY;
             chprintf(chp, "Registered greyscale format\r\n");
@@ -426,212 +473,837 @@ static void cmd_cam_set_adv_conf_sub(BaseSequentialStream *chp, int argc, char *
 
 static void cmd_cam_set_adv_conf_win(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint16_t x1, y1, width, height;
-    subsampling_t subx, suby;
-    format_t fmt;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_WINDOW};
 
     if (argc != 4) {
         chprintf(chp,
                  "Usage: cam_adv_conf x1 y1 width height\r\n");
     } else {
-        x1 = (uint16_t) atoi(argv[0]);
-        y1 = (uint16_t) atoi(argv[1]);
-        width = (uint16_t) atoi(argv[2]);
-        height = (uint16_t) atoi(argv[3]);
-        fmt = po8030_get_saved_format();
-        subx = po8030_get_saved_subsampling_x();
-        suby = po8030_get_saved_subsampling_y();
-
-        err = po8030_advanced_config(fmt, x1, y1, width, height, subx, suby);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set configuration (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Configuration set correctly\r\n");
-        }
+        cmd.param.window.x1 = (uint16_t) atoi(argv[0]);
+        cmd.param.window.y1 = (uint16_t) atoi(argv[1]);
+        cmd.param.window.width = (uint16_t) atoi(argv[2]);
+        cmd.param.window.height = (uint16_t) atoi(argv[3]);
+        cmd.param.window.format = po8030_get_saved_format();
+        cmd.param.window.subsampling_x = po8030_get_saved_subsampling_x();
+        cmd.param.window.subsampling_y = po8030_get_saved_subsampling_y();
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_mirror(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint8_t v, h;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_MIRROR};
 
     if (argc != 2) {
         chprintf(chp,
                  "Usage: cam_mirror vertical_en horizontal_en\r\n1=enabled, 0=disabled\r\n");
     } else {
-        v = (uint8_t) atoi(argv[0]);
-        h = (uint8_t) atoi(argv[1]);
-
-        err = po8030_set_mirror(v, h);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set mirroring (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Mirroring set correctly\r\n");
-        }
+        cmd.param.mirror.vertical = (uint8_t) atoi(argv[0]);
+        cmd.param.mirror.horizontal = (uint8_t) atoi(argv[1]);
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_gain(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint8_t r, g, b;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_RGB_GAIN};
 
     if (argc != 3) {
         chprintf(chp,
                  "Usage: cam_gain red_gain green_gain blue_gain\r\nThis command disable auto white balance.\r\nDefault: r=94, g=64, b=93\r\n");
     } else {
-        r = (uint8_t) atoi(argv[0]);
-        g = (uint8_t) atoi(argv[1]);
-        b = (uint8_t) atoi(argv[2]);
-
-        err = po8030_set_rgb_gain(r, g, b);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set gain (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Gain set correctly\r\n");
-        }
+        cmd.param.gain.r = (uint8_t) atoi(argv[0]);
+        cmd.param.gain.g = (uint8_t) atoi(argv[1]);
+        cmd.param.gain.b = (uint8_t) atoi(argv[2]);
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_awb(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint8_t awb;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_AWB};
 
     if (argc != 1) {
         chprintf(chp,
                  "Usage: cam_awb awb_en.\r\n1=enabled, 0=disabled\r\n");
     } else {
-        awb = (uint8_t) atoi(argv[0]);
-
-        err = po8030_set_awb(awb);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set white balance (%d)\r\n", err);
-        } else {
-            chprintf(chp, "White balance set correctly\r\n");
-        }
+        cmd.param.value = (uint8_t) atoi(argv[0]);
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_ae(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint8_t ae;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_AE};
 
     if (argc != 1) {
         chprintf(chp,
                  "Usage: cam_ae ae_en.\r\n1=enabled, 0=disabled\r\n");
     } else {
-        ae = (uint8_t) atoi(argv[0]);
-
-        err = po8030_set_ae(ae);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set auto exposure (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Auto exposure set correctly\r\n");
-        }
+        cmd.param.value = (uint8_t) atoi(argv[0]);
+        post_camera_command(chp, &cmd);
     }
 }
 
 static void cmd_cam_set_exposure(BaseSequentialStream *chp, int argc, char *argv[])
 {
-    int8_t err;
-    uint16_t integral;
-    uint8_t fractional;
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_EXPOSURE};
 
     if (argc != 2) {
         chprintf(chp,
                  "Usage: cam_exposure integral fractional\r\nUnit is line time; total integration time = (integral + fractional/256) line time.\r\nDefault: integral=128, fractional=0\r\n");
     } else {
-        integral = (uint16_t) atoi(argv[0]);
-        fractional = (uint8_t) atoi(argv[1]);
+        cmd.param.exposure.integral = (uint16_t) atoi(argv[0]);
+        cmd.param.exposure.fractional = (uint8_t) atoi(argv[1]);
+        post_camera_command(chp, &cmd);
+    }
+}
 
-        err = po8030_set_exposure(integral, fractional);
-        if(err != MSG_OK) {
-            chprintf(chp, "Cannot set exposure time (%d)\r\n", err);
-        } else {
-            chprintf(chp, "Exposure time set correctly\r\n");
+static void cmd_cam_regcache(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    uint32_t hits, misses;
+
+    if (argc > 1 || (argc == 1 && strcmp(argv[0], "reset"))) {
+        chprintf(chp, "Usage: cam_regcache [reset]\r\n");
+        return;
+    }
+
+    po8030_get_regcache_stats(&hits, &misses);
+    chprintf(chp, "I2C transactions avoided : %u\r\n", hits);
+    chprintf(chp, "I2C transactions done    : %u\r\n", misses);
+
+    if (argc == 1) {
+        po8030_reset_regcache_stats();
+    }
+}
+
+static void cmd_cam_ctrl(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    camera_control_stats_t stats;
+
+    (void)argv;
+    if (argc > 0) {
+        chprintf(chp, "Usage: cam_ctrl\r\n");
+        return;
+    }
+
+    camera_control_get_stats(&stats);
+    chprintf(chp, "Requests posted   : %u\r\n", stats.posted);
+    chprintf(chp, "Requests merged   : %u\r\n", stats.merged);
+    chprintf(chp, "Requests executed : %u\r\n", stats.executed);
+    chprintf(chp, "Requests failed   : %u (last error %d)\r\n", stats.failed, stats.last_error);
+    chprintf(chp, "Frame-synced runs : %u\r\n", stats.synced);
+}
+
+static void cmd_cam_ae_status(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    exposure_controller_status_t status;
+
+    (void)argv;
+    if (argc > 0) {
+        chprintf(chp, "Usage: cam_ae_status\r\nSettings are in the auto_exposure namespace of config_tree.\r\n");
+        return;
+    }
+
+    exposure_controller_get(&status);
+    chprintf(chp, "Exposure          : %u + %u/256 lines\r\n",
+             status.ae.exposure / AE_ONE_LINE, status.ae.exposure % AE_ONE_LINE);
+    chprintf(chp, "RGB gains         : 0x%02x 0x%02x 0x%02x\r\n",
+             status.awb.gain_r, status.awb.gain_g, status.awb.gain_b);
+    chprintf(chp, "Settings changes  : %u\r\n", status.updates);
+    if (status.seq != 0) {
+        chprintf(chp, "Frame #%u metered in %u cycles: luma %u (target %u), chroma %u %u\r\n",
+                 status.seq, status.cycles, status.mean, status.ae.target, status.u, status.v);
+    }
+}
+
+static void cmd_cam_frames(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    frame_slot_t *frame;
+    uint32_t limit;
+    int i;
+
+    (void)argv;
+    if (argc > 0) {
+        chprintf(chp, "Usage: cam_frames\r\n");
+        return;
+    }
+
+    chprintf(chp, "Frames captured   : %u\r\n", DCMID.frames);
+    chprintf(chp, "DCMI overruns     : %u\r\n", DCMID.overruns);
+    chprintf(chp, "DMA errors        : %u\r\n", DCMID.dma_errors);
+    chprintf(chp, "DMA FIFO errors   : %u\r\n", DCMID.fifo_errors);
+    chprintf(chp, "Recoveries        : %u\r\n", DCMID.recoveries);
+    if (DCMID.recoveries > 0) {
+        limit = DCMI_RECOVERY_HIST_FIRST_MS;
+        for (i = 0; i < DCMI_RECOVERY_HIST_BINS - 1; i++) {
+            chprintf(chp, "  < %4u ms       : %u\r\n", limit, DCMID.recovery_hist[i]);
+            limit <<= 1;
         }
+        chprintf(chp, "  >= %4u ms      : %u\r\n", limit >> 1, DCMID.recovery_hist[i]);
+    }
+    chprintf(chp, "Frames published  : %u\r\n", frame_pool.sequence);
+    chprintf(chp, "Frames overwritten: %u\r\n", frame_pool_overwritten_count(&frame_pool));
+    chprintf(chp, "Frames dropped    : %u\r\n", frames_dropped);
+    chprintf(chp, "Bands received    : %u\r\n", band_count);
+
+    frame = frame_pool_borrow_latest(&frame_pool);
+    if (frame != NULL) {
+        chprintf(chp, "Latest frame      : #%u %ux%u format 0x%02x flags 0x%02x, captured in %u us\r\n",
+                 frame->header.seq, frame->header.width, frame->header.height,
+                 frame->header.format, frame->header.flags,
+                 RTC2US(STM32_SYSCLK, frame->header.t_end - frame->header.t_start));
+        frame_pool_release(&frame_pool, frame);
     }
 }
 
 static void cmd_cam_dcmi_prepare(BaseSequentialStream *chp, int argc, char **argv)
 {
     uint32_t image_size = 0;
+    uint32_t line_size;
+    uint16_t width, height;
 
     if (argc != 1) {
         chprintf(chp,
                  "Usage: cam_dcmi_prepare capture_mode\r\ncapture_mode: 0=oneshot, 1=continuous\r\n");
     } else {
         capture_mode = (uint8_t) atoi(argv[0]);
-        image_size = po8030_get_image_size();
+        capture_geometry(&width, &height, &line_size);
+        image_size = line_size * height;
 
         if(image_size > MAX_BUFF_SIZE) {
             chprintf(chp, "Cannot prepare dcmi, image size too big.\r\n");
             return;
         }
 
-        if(image_size > (MAX_BUFF_SIZE/2)) {
-            double_buffering = 0;
-        } else {
-            double_buffering = 1;
+        if((image_size % dcmi_lld_burst_size(&dcmicfg)) != 0) {
+            chprintf(chp, "Cannot prepare dcmi, image size must be a multiple of %u bytes.\r\n", dcmi_lld_burst_size(&dcmicfg));
+            return;
         }
 
-        if(sample_buffer != NULL) {
-            chprintf(chp, "Cannot prepare dcmi, buffer1 already allocated.\r\n");
+        // The DMA could still be writing to the buffers.
+        if(DCMID.state != DCMI_STOP) {
+            chprintf(chp, "Cannot prepare dcmi, unprepare first.\r\n");
             return;
         }
-        sample_buffer = (uint8_t*)malloc(image_size);
-        if(sample_buffer == NULL) {
-            chprintf(chp, "Could not allocate buffer1\r\n");
+
+        if(frame_pool_configure(&frame_pool, image_size) == 0) {
+            chprintf(chp, "Cannot prepare dcmi, frame buffers still in use.\r\n");
             return;
         }
 
-        if(capture_mode == CAPTURE_ONE_SHOT) {
-            dcmiPrepare(&DCMID, &dcmicfg, image_size, (uint32_t*)sample_buffer, NULL);
+        if(frame_pool.num_slots < 2) {
+            double_buffering = 0;
+        } else {
+            double_buffering = 1;
+        }
+        // Rotating the DMA buffers needs a third slot, for the latest frame while the DMA owns the two others.
+        buffer_rotation = (capture_mode == CAPTURE_CONTINUOUS && frame_pool.num_slots > 2);
+
+        capture_slot[0] = frame_pool_acquire(&frame_pool);
+        capture_slot[1] = NULL;
+
+        if(capture_mode == CAPTURE_ONE_SHOT || double_buffering == 0) {
+            dcmiPrepare(&DCMID, &dcmicfg, image_size, (uint32_t*)capture_slot[0]->buffer, NULL);
             chprintf(chp, "DCMI prepared with single-buffering\r\n");
         } else {
-            if(double_buffering == 0) {
-                dcmiPrepare(&DCMID, &dcmicfg, image_size, (uint32_t*)sample_buffer, NULL);
-                chprintf(chp, "DCMI prepared with single-buffering\r\n");
+            capture_slot[1] = frame_pool_acquire(&frame_pool);
+            dcmiPrepare(&DCMID, &dcmicfg, image_size, (uint32_t*)capture_slot[0]->buffer, (uint32_t*)capture_slot[1]->buffer);
+            if(buffer_rotation) {
+                chprintf(chp, "DCMI prepared with %u rotating buffers\r\n", frame_pool.num_slots);
             } else {
-                if(sample_buffer2 != NULL) {
-                    chprintf(chp, "Cannot prepare dcmi, buffer2 already allocated.\r\n");
-                    return;
-                }
-                sample_buffer2 = (uint8_t*)malloc(image_size);
-                if(sample_buffer2 == NULL) {
-                    chprintf(chp, "Could not allocate buffer2\r\n");
-                    return;
-                }
-                dcmiPrepare(&DCMID, &dcmicfg, image_size, (uint32_t*)sample_buffer, (uint32_t*)sample_buffer2);
                 chprintf(chp, "DCMI prepared with double-buffering\r\n");
             }
         }
     }
 }
 
+static void cmd_cam_dcmi_prepare_bands(BaseSequentialStream *chp, int argc, char **argv)
+{
+    uint32_t line_size, ring_size;
+    uint16_t band_lines, width, height;
+
+    if (argc != 1) {
+        chprintf(chp,
+                 "Usage: cam_dcmi_prepare_bands band_lines\r\nStreams the frames as bands of band_lines rows.\r\n");
+        return;
+    }
+
+    band_lines = (uint16_t) atoi(argv[0]);
+    capture_geometry(&width, &height, &line_size);
+    ring_size = 2 * line_size * band_lines;
+
+    if(band_lines == 0 || (height % band_lines) != 0) {
+        chprintf(chp, "Cannot prepare dcmi, the frame height (%u) must be a multiple of band_lines.\r\n", height);
+        return;
+    }
+
+    if(((line_size * band_lines) % dcmi_lld_burst_size(&dcmicfg)) != 0) {
+        chprintf(chp, "Cannot prepare dcmi, bands must be a multiple of %u bytes.\r\n", dcmi_lld_burst_size(&dcmicfg));
+        return;
+    }
+
+    if(ring_size > MAX_BUFF_SIZE || ring_size >= 65536*4) {
+        chprintf(chp, "Cannot prepare dcmi, bands too big.\r\n");
+        return;
+    }
+
+    if(DCMID.state != DCMI_STOP) {
+        chprintf(chp, "Cannot prepare dcmi, unprepare first.\r\n");
+        return;
+    }
+
+    // The ring buffer is taken from the frame pool, it is given back by cam_dcmi_unprepare.
+    if(frame_pool_configure(&frame_pool, ring_size) == 0) {
+        chprintf(chp, "Cannot prepare dcmi, frame buffers still in use.\r\n");
+        return;
+    }
+
+    capture_mode = CAPTURE_CONTINUOUS;
+    double_buffering = 0;
+    buffer_rotation = 0;
+    capture_slot[0] = frame_pool_acquire(&frame_pool);
+    capture_slot[1] = NULL;
+    dcmiPrepareBands(&DCMID, &dcmicfg, line_size, band_lines, height, capture_slot[0]->buffer);
+    chprintf(chp, "DCMI prepared with bands of %u rows (%u bytes)\r\n", band_lines, line_size * band_lines);
+}
+
+// Alignment the crop window needs to keep the pixel layout of the format.
+static uint8_t crop_align(format_t fmt)
+{
+    switch(fmt) {
+        case FORMAT_CBYCRY:
+        case FORMAT_CRYCBY:
+        case FORMAT_YCBYCR:
+        case FORMAT_YCRYCB:
+            return DCMI_CROP_EVEN_X;
+        case FORMAT_RGGB:
+        case FORMAT_GBRG:
+        case FORMAT_GRBG:
+        case FORMAT_BGGR:
+        case FORMAT_DPC_BAYER:
+            return DCMI_CROP_EVEN_X | DCMI_CROP_EVEN_Y;
+        default:
+            return 0;
+    }
+}
+
+static void cmd_cam_crop(BaseSequentialStream *chp, int argc, char **argv)
+{
+    struct po8030_configuration conf;
+    dcmi_crop_rect_t rect;
+    dcmi_crop_window_t window;
+    DCMICrop crop;
+
+    if (argc == 1 && !strcmp(argv[0], "off")) {
+        if(DCMID.state != DCMI_STOP && DCMID.crop.capcnt != 0) {
+            chprintf(chp, "Cannot change the frame size while prepared, unprepare first.\r\n");
+            return;
+        }
+        dcmiSetCrop(&DCMID, NULL);
+        chprintf(chp, "Crop disabled\r\n");
+        return;
+    }
+
+    if (argc != 4) {
+        chprintf(chp, "Usage: cam_crop x y width height | cam_crop off\r\n");
+        return;
+    }
+
+    rect.x = (uint16_t) atoi(argv[0]);
+    rect.y = (uint16_t) atoi(argv[1]);
+    rect.width = (uint16_t) atoi(argv[2]);
+    rect.height = (uint16_t) atoi(argv[3]);
+
+    po8030_get_configuration(&conf);
+    if(!dcmi_crop_compute(&rect, conf.width, conf.height, po8030_get_bytes_per_pixel(conf.curr_format),
+                          crop_align(conf.curr_format), &window)) {
+        chprintf(chp, "Invalid crop window for a %ux%u frame (lines must be a multiple of 4 bytes, x even for YUV422, x and y even for Bayer).\r\n", conf.width, conf.height);
+        return;
+    }
+
+    // While prepared the DMA transfer size is fixed, so the window can only be moved.
+    if(DCMID.state != DCMI_STOP &&
+       (window.capcnt != DCMID.crop.capcnt || window.vline != DCMID.crop.vline)) {
+        chprintf(chp, "Cannot change the frame size while prepared, unprepare first.\r\n");
+        return;
+    }
+
+    crop.hoffcnt = window.hoffcnt;
+    crop.vst = window.vst;
+    crop.capcnt = window.capcnt;
+    crop.vline = window.vline;
+    dcmiSetCrop(&DCMID, &crop);
+    chprintf(chp, "Crop window set (%u bytes per frame)\r\n", dcmi_crop_size(&window));
+}
+
+static void cmd_cam_capture(BaseSequentialStream *chp, int argc, char **argv)
+{
+    systime_t timeout = MS2ST(500);
+    systime_t start;
+    msg_t msg;
+
+    if (argc > 1) {
+        chprintf(chp, "Usage: cam_capture [timeout_ms]\r\n");
+        return;
+    }
+    if (argc == 1) {
+        timeout = MS2ST(atoi(argv[0]));
+    }
+    if (DCMID.state != DCMI_READY) {
+        chprintf(chp, "DCMI not ready, prepare it first.\r\n");
+        return;
+    }
+
+    start = chVTGetSystemTime();
+    msg = dcmiCaptureTimeout(&DCMID, timeout);
+    if (msg == MSG_OK) {
+        chprintf(chp, "Frame captured in %u ms\r\n", ST2MS(chVTTimeElapsedSinceX(start)));
+    } else if (msg == MSG_TIMEOUT) {
+        chprintf(chp, "Capture timeout\r\n");
+    } else {
+        chprintf(chp, "Capture error\r\n");
+    }
+}
+
+static void cmd_cam_stream(BaseSequentialStream *chp, int argc, char **argv)
+{
+    msg_t msg;
+
+    if (argc == 1 && !strcmp(argv[0], "start")) {
+        if (DCMID.state != DCMI_READY) {
+            chprintf(chp, "DCMI not ready, prepare it first.\r\n");
+            return;
+        }
+        dcmiStartStream(&DCMID);
+        chprintf(chp, "Streaming started\r\n");
+    } else if (argc == 1 && !strcmp(argv[0], "stop")) {
+        if (DCMID.state != DCMI_ACTIVE_STREAM && DCMID.state != DCMI_RECOVERING) {
+            chprintf(chp, "Not streaming.\r\n");
+            return;
+        }
+        msg = dcmiStopStream(&DCMID);
+        if (msg == MSG_OK) {
+            chprintf(chp, "Streaming stopped\r\n");
+        } else if (msg == MSG_TIMEOUT) {
+            chprintf(chp, "Stop timeout, the DCMI must be reset\r\n");
+        } else {
+            chprintf(chp, "Streaming stopped on error\r\n");
+        }
+    } else {
+        chprintf(chp, "Usage: cam_stream start|stop\r\n");
+    }
+}
+
 static void cmd_cam_dcmi_unprepare(BaseSequentialStream *chp, int argc, char **argv)
 {
     (void) argc;
     (void) argv;
+    int i;
+
+    // Otherwise the DMA may still write to the capture slots given back below.
+    if(DCMID.state != DCMI_READY) {
+        chprintf(chp, "Cannot unprepare dcmi while not ready (state %d), run cam_stream stop first.\r\n", DCMID.state);
+        return;
+    }
 
     dcmiUnprepare(&DCMID);
 
-    if(sample_buffer != NULL) {
-        free(sample_buffer);
-        sample_buffer = NULL;
+    for(i = 0; i < 2; i++) {
+        if(capture_slot[i] != NULL) {
+            frame_pool_detach(&frame_pool, capture_slot[i]);
+            capture_slot[i] = NULL;
+        }
     }
 
-    if(sample_buffer2 != NULL) {
-        free(sample_buffer2);
-        sample_buffer2 = NULL;
+    chprintf(chp, "DCMI released correctly\r\n");
+
+}
+
+static void cmd_blob_class(BaseSequentialStream *chp, int argc, char **argv)
+{
+    blob_threshold_t threshold;
+    uint8_t cls;
+
+    if (argc == 2 && !strcmp(argv[1], "off")) {
+        cls = (uint8_t) atoi(argv[0]);
+        if (!blob_tracker_set_class(cls, NULL)) {
+            chprintf(chp, "Invalid class, %u available.\r\n", BLOB_MAX_CLASSES);
+            return;
+        }
+        chprintf(chp, "Class %u disabled\r\n", cls);
+        return;
     }
 
-    chprintf(chp, "DCMI released correctly\r\n");
+    if (argc != 7) {
+        chprintf(chp, "Usage: blob_class class y_min y_max u_min u_max v_min v_max | blob_class class off\r\n");
+        return;
+    }
+
+    cls = (uint8_t) atoi(argv[0]);
+    threshold.y_min = (uint8_t) atoi(argv[1]);
+    threshold.y_max = (uint8_t) atoi(argv[2]);
+    threshold.u_min = (uint8_t) atoi(argv[3]);
+    threshold.u_max = (uint8_t) atoi(argv[4]);
+    threshold.v_min = (uint8_t) atoi(argv[5]);
+    threshold.v_max = (uint8_t) atoi(argv[6]);
+
+    if (!blob_tracker_set_class(cls, &threshold)) {
+        chprintf(chp, "Invalid class, %u available.\r\n", BLOB_MAX_CLASSES);
+        return;
+    }
+    chprintf(chp, "Class %u set\r\n", cls);
+}
+
+static void cmd_blobs(BaseSequentialStream *chp, int argc, char **argv)
+{
+    static blob_tracker_result_t result;
+    const blob_t *blob;
+    int cls, i;
+
+    if (argc > 1) {
+        chprintf(chp, "Usage: blobs [min_area]\r\n");
+        return;
+    }
+    if (argc == 1) {
+        blob_tracker_set_min_area(atoi(argv[0]));
+    }
+
+    blob_tracker_get(&result);
+    if (result.seq == 0) {
+        chprintf(chp, "No YUV422 frame processed yet.\r\n");
+        return;
+    }
+
+    chprintf(chp, "Frame #%u processed in %u cycles%s\r\n", result.seq, result.cycles,
+             result.overflow ? ", runs were dropped" : "");
+    for (cls = 0; cls < BLOB_MAX_CLASSES; cls++) {
+        for (i = 0; i < result.count[cls]; i++) {
+            blob = &result.blobs[cls][i];
+            chprintf(chp, "class %d: (%u, %u) area %u box %u,%u-%u,%u\r\n", cls,
+                     blob->cx, blob->cy, blob->area,
+                     blob->x_min, blob->y_min, blob->x_max, blob->y_max);
+        }
+    }
+}
+
+static void cmd_motion(BaseSequentialStream *chp, int argc, char **argv)
+{
+    static motion_detector_result_t result;
+    uint16_t tx, ty, tile = 0;
+
+    if (argc > 1) {
+        chprintf(chp, "Usage: motion [threshold]\r\n");
+        return;
+    }
+    if (argc == 1) {
+        motion_detector_set_threshold(atoi(argv[0]));
+    }
+
+    motion_detector_get(&result);
+    if (result.seq == 0) {
+        chprintf(chp, "No YUV422 frame processed yet.\r\n");
+        return;
+    }
+
+    chprintf(chp, "Frame #%u processed in %u cycles, %u active tiles\r\n",
+             result.seq, result.cycles, result.active_tiles);
+    for (ty = 0; ty < result.tiles_y; ty++) {
+        for (tx = 0; tx < result.tiles_x; tx++, tile++) {
+            chprintf(chp, "%c", (result.activity[tile / 32] >> (tile % 32)) & 1 ? '#' : '.');
+        }
+        chprintf(chp, "\r\n");
+    }
+}
+
+static void cmd_flow(BaseSequentialStream *chp, int argc, char **argv)
+{
+    static flow_estimator_result_t result;
+    const flow_vector_t *v;
+    uint8_t i;
+
+    (void)argv;
+    if (argc > 0) {
+        chprintf(chp, "Usage: flow\r\n");
+        return;
+    }
+
+    flow_estimator_get(&result);
+    if (result.seq == 0) {
+        chprintf(chp, "No estimate yet.\r\n");
+        return;
+    }
 
+    chprintf(chp, "Frame #%u processed in %u cycles\r\n", result.seq, result.cycles);
+    chprintf(chp, "translation %d,%d /%d px, rotation %d mrad\r\n",
+             result.flow.tx, result.flow.ty, FLOW_SCALE, result.flow.rotation);
+    for (i = 0; i < result.flow.num_vectors; i++) {
+        v = &result.flow.vectors[i];
+        chprintf(chp, "(%u, %u): %d,%d sad %u\r\n", v->x, v->y, v->dx, v->dy, v->sad);
+    }
+}
+
+static void cmd_line(BaseSequentialStream *chp, int argc, char **argv)
+{
+    static line_follower_result_t result;
+
+    if (argc == 3 && !strcmp(argv[0], "window")) {
+        if (line_follower_set_window(atoi(argv[1]), atoi(argv[2]))) {
+            chprintf(chp, "Request queued, prepare the DCMI again for the new frame size.\r\n");
+        } else {
+            chprintf(chp, "Invalid window, at most %u rows.\r\n", LINE_FOLLOWER_MAX_ROWS);
+        }
+        return;
+    }
+    if (argc == 3 && !strcmp(argv[0], "detect")) {
+        line_follower_set_detection(atoi(argv[1]), strcmp(argv[2], "bright") != 0);
+        return;
+    }
+    if (argc > 0) {
+        chprintf(chp, "Usage: line | line window y rows | line detect contrast dark|bright\r\n");
+        return;
+    }
+
+    line_follower_get(&result);
+    if (result.seq == 0) {
+        chprintf(chp, "No thin frame processed yet.\r\n");
+        return;
+    }
+
+    chprintf(chp, "Frame #%u processed in %u cycles\r\n", result.seq, result.cycles);
+    if (result.found) {
+        chprintf(chp, "line at %d /%d px (edges %d, %d), contrast %u\r\n",
+                 result.line.centre, LINE_PROFILE_SCALE, result.line.left, result.line.right,
+                 result.line.contrast);
+    } else {
+        chprintf(chp, "No line in %u pixels\r\n", result.width);
+    }
+}
+
+/* One QQVGA band of 8 rows, large enough to average out the call overhead. */
+#define VISION_BENCH_PIXELS (160 * 8)
+
+/* In CCM, the main RAM is taken by the frame pool. */
+static CCM_BUFFER uint8_t bench_src[2 * VISION_BENCH_PIXELS];
+static CCM_BUFFER uint8_t bench_ref[VISION_BENCH_PIXELS];
+static CCM_BUFFER uint8_t bench_dst[VISION_BENCH_PIXELS];
+static CCM_BUFFER uint8_t bench_ref_u[VISION_BENCH_PIXELS / 2], bench_ref_v[VISION_BENCH_PIXELS / 2];
+static CCM_BUFFER uint8_t bench_dst_u[VISION_BENCH_PIXELS / 2], bench_dst_v[VISION_BENCH_PIXELS / 2];
+static CCM_BUFFER uint8_t bench_rgb_ref[3 * VISION_BENCH_PIXELS], bench_rgb[3 * VISION_BENCH_PIXELS];
+static CCM_BUFFER uint32_t bench_integral[(160 + 1) * 4];
+
+static void vision_bench_report(BaseSequentialStream *chp, const char *name, time_measurement_t *tm)
+{
+    chprintf(chp, "%-9s: %u cycles (%u.%02u / pixel)\r\n", name, tm->last,
+             tm->last / VISION_BENCH_PIXELS, (tm->last * 100 / VISION_BENCH_PIXELS) % 100);
+}
+
+static void cmd_vision_bench(BaseSequentialStream *chp, int argc, char *argv[])
+{
+    time_measurement_t ref, fast;
+    const char *ref_name = "reference", *fast_name = "dsp";
+    bool exact = false, compared = true;
+    uint32_t i;
+
+    if (argc != 1) {
+        chprintf(chp, "Usage: vision_bench kernel\r\nKernels: gray, planar, rgb565, rgb888, from565, bayer, bin2x2, pyramid, integral, sad, flow, profile, lut\r\n");
+        return;
+    }
+
+    for (i = 0; i < sizeof(bench_src); i++) {
+        bench_src[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    chTMObjectInit(&ref);
+    chTMObjectInit(&fast);
+
+    if (!strcmp(argv[0], "gray")) {
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        yuv422_to_gray_ref(bench_src, bench_ref, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        yuv422_to_gray(bench_src, bench_dst, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_ref, bench_dst, VISION_BENCH_PIXELS);
+    } else if (!strcmp(argv[0], "planar")) {
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        yuv422_to_planar_ref(bench_src, bench_ref, bench_ref_u, bench_ref_v, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        yuv422_to_planar(bench_src, bench_dst, bench_dst_u, bench_dst_v, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_ref, bench_dst, VISION_BENCH_PIXELS) &&
+                !memcmp(bench_ref_u, bench_dst_u, sizeof(bench_ref_u)) &&
+                !memcmp(bench_ref_v, bench_dst_v, sizeof(bench_ref_v));
+    } else if (!strcmp(argv[0], "rgb565")) {
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        yuv422_to_rgb565_ref(bench_src, (uint16_t *)bench_rgb_ref, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        yuv422_to_rgb565(bench_src, (uint16_t *)bench_rgb, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_rgb_ref, bench_rgb, 2 * VISION_BENCH_PIXELS);
+    } else if (!strcmp(argv[0], "rgb888")) {
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        yuv422_to_rgb888_ref(bench_src, bench_rgb_ref, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        yuv422_to_rgb888(bench_src, bench_rgb, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_rgb_ref, bench_rgb, 3 * VISION_BENCH_PIXELS);
+    } else if (!strcmp(argv[0], "from565")) {
+        // The source buffer is reinterpreted as RGB565 pixels.
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        rgb565_to_yuv422_ref((uint16_t *)bench_src, bench_rgb_ref, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        rgb565_to_yuv422((uint16_t *)bench_src, bench_rgb, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_rgb_ref, bench_rgb, 2 * VISION_BENCH_PIXELS);
+    } else if (!strcmp(argv[0], "bayer")) {
+        // The source buffer is reinterpreted as a raw 160x8 RGGB band.
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        bayer_demosaic(bench_src, 160, 160, 8, BAYER_RGGB, BAYER_OUT_RGB565, bench_rgb_ref);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        bayer_demosaic(bench_src, 160, 160, 8, BAYER_RGGB, BAYER_OUT_GRAY, bench_rgb);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        // No DSP version, both outputs are timed instead.
+        ref_name = "rgb565";
+        fast_name = "gray";
+        compared = false;
+    } else if (!strcmp(argv[0], "bin2x2")) {
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        bayer_bin2x2(bench_src, 160, 160, 8, BAYER_RGGB, BAYER_OUT_RGB565, bench_rgb_ref);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        bayer_bin2x2(bench_src, 160, 160, 8, BAYER_RGGB, BAYER_OUT_GRAY, bench_rgb);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        // No DSP version, both outputs are timed instead.
+        ref_name = "rgb565";
+        fast_name = "gray";
+        compared = false;
+    } else if (!strcmp(argv[0], "pyramid")) {
+        // The source buffer is reinterpreted as a 160x16 greyscale image, halved to 80x8.
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        pyramid_downsample_ref(bench_src, 160, 160, 16, bench_ref);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        pyramid_downsample(bench_src, 160, 160, 16, bench_dst);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_ref, bench_dst, 80 * 8);
+    } else if (!strcmp(argv[0], "integral")) {
+        // The source buffer is reinterpreted as a 160x8 greyscale band, the
+        // second run also filters every row with a 3x3 box once possible.
+        integral_t ii;
+        uint16_t y;
+
+        integral_init(&ii, 160, 4, bench_integral, sizeof(bench_integral));
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        integral_add_rows(&ii, bench_src, 160, 8);
+        chTMStopMeasurementX(&ref);
+        integral_reset(&ii);
+        chTMStartMeasurementX(&fast);
+        for (y = 0; y < 8; y++) {
+            integral_add_rows(&ii, &bench_src[160 * y], 160, 1);
+            if (y > 0) {
+                integral_box_filter_row(&ii, y - 1, 1, &bench_dst[160 * (y - 1)]);
+            }
+        }
+        integral_box_filter_row(&ii, 7, 1, &bench_dst[160 * 7]);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        ref_name = "build";
+        fast_name = "build+box";
+        compared = false;
+    } else if (!strcmp(argv[0], "sad")) {
+        // Both halves of the source buffer are reinterpreted as 160x8 greyscale
+        // bands, compared tile by tile.
+        uint32_t sad_ref = 0, sad = 0;
+        uint16_t x;
+
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        for (x = 0; x < 160; x += MOTION_TILE_SIZE) {
+            sad_ref += motion_tile_sad_ref(&bench_src[x], &bench_src[VISION_BENCH_PIXELS + x], 160);
+        }
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        for (x = 0; x < 160; x += MOTION_TILE_SIZE) {
+            sad += motion_tile_sad(&bench_src[x], &bench_src[VISION_BENCH_PIXELS + x], 160);
+        }
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = sad_ref == sad;
+    } else if (!strcmp(argv[0], "flow")) {
+        // Both halves of the source buffer are reinterpreted as 160x8 greyscale
+        // bands, compared block by block.
+        uint32_t sad_ref = 0, sad = 0;
+        uint16_t x;
+
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        for (x = 0; x < 160; x += FLOW_BLOCK_SIZE) {
+            sad_ref += flow_block_sad_ref(&bench_src[x], 160, &bench_src[VISION_BENCH_PIXELS + x], 160);
+        }
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        for (x = 0; x < 160; x += FLOW_BLOCK_SIZE) {
+            sad += flow_block_sad(&bench_src[x], 160, &bench_src[VISION_BENCH_PIXELS + x], 160);
+        }
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = sad_ref == sad;
+    } else if (!strcmp(argv[0], "profile")) {
+        // The source buffer is reinterpreted as a 160x8 YUV422 band.
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        line_profile_sum_yuv422_ref(bench_src, 160, 8, (uint16_t *)bench_rgb_ref);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        line_profile_sum_yuv422(bench_src, 160, 8, (uint16_t *)bench_rgb);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_rgb_ref, bench_rgb, 160 * sizeof(uint16_t));
+    } else if (!strcmp(argv[0], "lut")) {
+        // The source buffer is copied and remapped in place as a 160x8 greyscale band.
+        memcpy(bench_ref, bench_src, VISION_BENCH_PIXELS);
+        memcpy(bench_dst, bench_src, VISION_BENCH_PIXELS);
+        chSysLock();
+        chTMStartMeasurementX(&ref);
+        lut_apply_ref(lut_gamma_0_45, bench_ref, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&ref);
+        chTMStartMeasurementX(&fast);
+        lut_apply(lut_gamma_0_45, bench_dst, VISION_BENCH_PIXELS);
+        chTMStopMeasurementX(&fast);
+        chSysUnlock();
+        exact = !memcmp(bench_ref, bench_dst, VISION_BENCH_PIXELS);
+    } else {
+        chprintf(chp, "Unknown kernel\r\n");
+        return;
+    }
+
+    vision_bench_report(chp, ref_name, &ref);
+    vision_bench_report(chp, fast_name, &fast);
+    if (compared) {
+        chprintf(chp, "output   : %s\r\n", exact ? "identical" : "MISMATCH");
+    }
 }
 
 const ShellCommand shell_commands[] = {
@@ -656,8 +1328,22 @@ const ShellCommand shell_commands[] = {
     {"cam_awb", cmd_cam_set_awb},
     {"cam_ae", cmd_cam_set_ae},
     {"cam_exposure", cmd_cam_set_exposure},
+    {"cam_regcache", cmd_cam_regcache},
+    {"cam_ctrl", cmd_cam_ctrl},
+    {"cam_ae_status", cmd_cam_ae_status},
+    {"cam_frames", cmd_cam_frames},
     {"cam_dcmi_prepare", cmd_cam_dcmi_prepare},
+    {"cam_dcmi_prepare_bands", cmd_cam_dcmi_prepare_bands},
     {"cam_dcmi_unprepare", cmd_cam_dcmi_unprepare},
+    {"cam_crop", cmd_cam_crop},
+    {"cam_capture", cmd_cam_capture},
+    {"cam_stream", cmd_cam_stream},
+    {"vision_bench", cmd_vision_bench},
+    {"blob_class", cmd_blob_class},
+    {"blobs", cmd_blobs},
+    {"motion", cmd_motion},
+    {"flow", cmd_flow},
+    {"line", cmd_line},
     {NULL, NULL}
 };
 
@@ -16,11 +16,17 @@
 #include "discovery_demo/button.h"
 
 //#include "aseba_vm/aseba_node.h"
-//#include "aseba_vm/skel_user.h"
+#include "aseba_vm/skel_user.h"
 //#include "aseba_vm/aseba_can_interface.h"
 //#include "aseba_vm/aseba_bridge.h"
 
 #include "camera/po8030.h"
+#include "camera/camera_control.h"
+#include "vision/blob_tracker.h"
+#include "vision/motion_detector.h"
+#include "vision/flow_estimator.h"
+#include "vision/line_follower.h"
+#include "camera/exposure_controller.h"
 
 #define SHELL_WA_SIZE   THD_WORKING_AREA_SIZE(2048)
 
@@ -29,13 +35,23 @@
 #define SPI_DATA_PAYLOAD_SIZE 4092
 #define SPI_DELAY 400
 
+#define FRAME_READY_EVENT EVENT_MASK(0)
+#define BUTTON_EVENT EVENT_MASK(1)
+#define LED_PERIOD MS2ST(500)
+
 parameter_namespace_t parameter_root, aseba_ns;
 
 uint8_t capture_mode = CAPTURE_ONE_SHOT;
-uint8_t *sample_buffer = NULL;
-uint8_t *sample_buffer2 = NULL;
 uint8_t double_buffering = 0;
 
+static uint8_t frame_pool_storage[MAX_BUFF_SIZE] __attribute__((aligned(FRAME_POOL_ALIGNMENT)));
+frame_pool_t frame_pool;
+frame_slot_t *capture_slot[2] = {NULL, NULL};
+EVENTSOURCE_DECL(frame_ready_event);
+static EVENTSOURCE_DECL(button_event);
+static uint32_t published_overruns = 0;
+static uint32_t published_dma_errors = 0;
+
 uint8_t txComplete = 0;
 uint8_t btnState = 0;
 uint8_t dcmiErrorFlag = 0;
@@ -47,12 +63,19 @@ uint8_t spiHeader[SPI_DATA_HEADER_SIZE];
 void frameEndCb(DCMIDriver* dcmip);
 void dmaTransferEndCb(DCMIDriver* dcmip);
 void dcmiErrorCb(DCMIDriver* dcmip, dcmierror_t err);
+void dcmiBandCb(DCMIDriver* dcmip, uint16_t first_row, uint16_t n_rows, const uint8_t *band);
 const DCMIConfig dcmicfg = {
     frameEndCb,
     dmaTransferEndCb,
 	dcmiErrorCb,
-    DCMI_CR_PCKPOL
+    DCMI_CR_PCKPOL,
+    dcmiBandCb,
+    STM32_DMA_FCR_DMDIS | STM32_DMA_FCR_FTH_FULL, // FIFO drained when full...
+    STM32_DMA_CR_MBURST_INCR4 | STM32_DMA_CR_MSIZE_WORD // ...in a single burst of 4 words.
 };
+volatile uint32_t band_count = 0;
+uint8_t buffer_rotation = 0;
+volatile uint32_t frames_dropped = 0;
 
 static bool load_config(void)
 {
@@ -64,6 +87,7 @@ static bool load_config(void)
 void my_button_cb(void) {
 
 	txComplete = 1;
+	chEvtBroadcast(&button_event); // Main pushes the frame now instead of on the next frame or led period.
 
 /*
     if(btnState == 0) {
@@ -90,20 +114,107 @@ void my_button_cb(void) {
 */	
 }
 
+void capture_geometry(uint16_t *width, uint16_t *height, uint32_t *line_size) {
+    struct po8030_configuration conf;
+    uint8_t bytes_per_pixel;
+
+    po8030_get_configuration(&conf);
+    bytes_per_pixel = po8030_get_bytes_per_pixel(conf.curr_format);
+
+    if(DCMID.crop.capcnt != 0) {
+        *width = DCMID.crop.capcnt / bytes_per_pixel;
+        *height = DCMID.crop.vline;
+    } else {
+        *width = conf.width;
+        *height = conf.height;
+    }
+    *line_size = (uint32_t)*width * bytes_per_pixel;
+}
+
 void frameEndCb(DCMIDriver* dcmip) {
     (void) dcmip;
+    chSysLockFromISR();
+    camera_control_frame_end_i();
+    chSysUnlockFromISR();
     //palTogglePad(GPIOD, 13) ; // Orange.
 }
 
 void dmaTransferEndCb(DCMIDriver* dcmip) {
-   (void) dcmip;
+    frame_slot_t *slot, *next = NULL;
+    uint8_t idle = 0;
+
+    // With double buffering the DMA already switched to the other buffer, so the one just filled is the idle one.
+    if(capture_slot[1] != NULL) {
+        idle = dcmiGetIdleBufferIndexX(dcmip);
+    }
+    slot = capture_slot[idle];
+
+    // With more than two slots, the filled slot is replaced by a free one so that it is never
+    // overwritten while being read. The latest frame also holds a slot, it is taken back when no
+    // other one is free (always the case with three slots). If the consumers hold every other slot
+    // the frame is dropped and the DMA keeps capturing into the same slot.
+    if(slot != NULL && buffer_rotation) {
+        next = frame_pool_acquire(&frame_pool);
+        if(next == NULL) {
+            next = frame_pool_reclaim(&frame_pool);
+        }
+        if(next == NULL) {
+            frames_dropped++;
+            return;
+        }
+        chSysLockFromISR();
+        dcmiSetIdleBufferI(dcmip, next->buffer);
+        chSysUnlockFromISR();
+        capture_slot[idle] = next;
+    }
+
+    if(slot != NULL) {
+        struct po8030_configuration conf;
+        uint32_t line_size;
+
+        po8030_get_configuration(&conf);
+        capture_geometry(&slot->header.width, &slot->header.height, &line_size);
+        slot->header.t_start = dcmip->frame_start;
+        slot->header.t_end = chSysGetRealtimeCounterX();
+        slot->header.format = conf.curr_format;
+        slot->header.flags = 0;
+        // Errors that happened since the previous frame was published were hitting this one.
+        if(dcmip->overruns != published_overruns) {
+            slot->header.flags |= FRAME_FLAG_OVERRUN;
+            published_overruns = dcmip->overruns;
+        }
+        if(dcmip->dma_errors != published_dma_errors) {
+            slot->header.flags |= FRAME_FLAG_DMA_ERROR;
+            published_dma_errors = dcmip->dma_errors;
+        }
+        frame_pool_publish(&frame_pool, slot, line_size * slot->header.height);
+        // Without rotation the DMA keeps the slot and captures the next frames into it.
+        if(next != NULL) {
+            frame_pool_detach(&frame_pool, slot);
+        }
+
+        chSysLockFromISR();
+        chEvtBroadcastFlagsI(&frame_ready_event, FRAME_READY_FLAG);
+        chSysUnlockFromISR();
+    }
     //palTogglePad(GPIOD, 15); // Blue.
 }
 
+void dcmiBandCb(DCMIDriver* dcmip, uint16_t first_row, uint16_t n_rows, const uint8_t *band) {
+    (void) dcmip;
+    (void) first_row;
+    (void) n_rows;
+    (void) band;
+    // Band consumers (processing, transmission) hook here, the band is overwritten one band period later.
+    band_count++;
+}
+
 void dcmiErrorCb(DCMIDriver* dcmip, dcmierror_t err) {
-   (void) dcmip;
    (void) err;
-    dcmiErrorFlag = 1;
+    // While streaming the driver recovers by itself, only a failed one shot capture is reported.
+    if(dcmip->state == DCMI_ERROR) {
+        dcmiErrorFlag = 1;
+    }
 	//chSysHalt("DCMI error");
 }
 
@@ -117,8 +228,13 @@ static THD_FUNCTION(spi_thread, p) {
 	uint32_t i = 0;
 	uint16_t transCount = 0; // image size / SPI_BUFF_LEN
 	uint8_t id = 0;
+	frame_slot_t *frame = NULL;
+	event_listener_t frame_listener;
+	uint32_t sent_seq = 0; // Sequence numbers start at 1.
 	
 	uint16_t checksum = 0;
+
+	chEvtRegisterMask(&frame_ready_event, &frame_listener, FRAME_READY_EVENT);
 	
 	spiTxBuff[0] = 0xAA;
 	checksum += spiTxBuff[0];
@@ -138,17 +254,22 @@ static THD_FUNCTION(spi_thread, p) {
 	uint32_t remainingBytes = 0;
 	uint32_t spiDataIndex = 0;
 	
-	// Create a fixed packet content for debugging.
-	sample_buffer = malloc(76800);
+	// Create a fixed packet content for debugging, it is sent until the first frame is captured.
+	frame_pool_configure(&frame_pool, MAX_BUFF_SIZE);
+	frame = frame_pool_acquire(&frame_pool);
 	id = 0;
-	for(i=0; i<76800; i++) {
-		sample_buffer[i] = id;
+	for(i=0; i<MAX_BUFF_SIZE; i++) {
+		frame->buffer[i] = id;
 		if(id == 255) {
 			id = 0;
 		} else {
 			id++;
 		}
-	}	
+	}
+	frame_pool_publish(&frame_pool, frame, MAX_BUFF_SIZE);
+	frame_pool_detach(&frame_pool, frame);
+	// The debug frame is not announced to the other consumers, it is only sent once by this thread.
+	chEvtSignal(chThdGetSelfX(), FRAME_READY_EVENT);
 
 /*
 	while(1) {
@@ -170,30 +291,42 @@ static THD_FUNCTION(spi_thread, p) {
 	
 	while (true) {
 
-		palSetPad(GPIOD, 13) ; // Orange.
-		
-		memset(spiRxBuff, 0x00, SPI_COMMAND_SIZE);	
-		spiSelect(&SPID1);
-		spiExchange(&SPID1, SPI_COMMAND_SIZE, spiTxBuff, spiRxBuff);
-		//spiReceive(&SPID1, SPI_COMMAND_SIZE, spiRxBuff);
-		spiUnselect(&SPID1);
-		
-		// A little pause is needed for the communication to work, 400 NOP loops last about 26 us.
-		// Probably this pause can be avoided since we loose some time computing the checksum...	
-		for(delay=0; delay<SPI_DELAY; delay++) {
-			__NOP();
-		}
-		
-		// Compute the checksum (block check character) to verify the command is received correctly.
-		// If the command is incorrect, wait for the next command, this is an easy way to synchronize the two chips.
-		checksum = 0;
-		for(i=0; i<SPI_COMMAND_SIZE-1; i++) {
-			checksum += spiRxBuff[i];
+		// Sleep until a frame is published, each frame is sent once.
+		chEvtWaitAny(FRAME_READY_EVENT);
+
+		// Borrow the latest frame, it cannot be given back to the DMA until it is sent.
+		frame = frame_pool_borrow_latest(&frame_pool);
+		if(frame == NULL) {
+			continue;
 		}
-		checksum = checksum &0xFF;
-		if(checksum != spiRxBuff[SPI_COMMAND_SIZE-1] || spiRxBuff[0]!=0xAA || spiRxBuff[1]!=0xBB) {	
+		if(frame->header.seq == sent_seq) {
+			frame_pool_release(&frame_pool, frame);
 			continue;
 		}
+
+		palSetPad(GPIOD, 13) ; // Orange.
+		
+		do {
+			memset(spiRxBuff, 0x00, SPI_COMMAND_SIZE);	
+			spiSelect(&SPID1);
+			spiExchange(&SPID1, SPI_COMMAND_SIZE, spiTxBuff, spiRxBuff);
+			//spiReceive(&SPID1, SPI_COMMAND_SIZE, spiRxBuff);
+			spiUnselect(&SPID1);
+			
+			// A little pause is needed for the communication to work, 400 NOP loops last about 26 us.
+			// Probably this pause can be avoided since we loose some time computing the checksum...	
+			for(delay=0; delay<SPI_DELAY; delay++) {
+				__NOP();
+			}
+			
+			// Compute the checksum (block check character) to verify the command is received correctly.
+			// If the command is incorrect, wait for the next command, this is an easy way to synchronize the two chips.
+			checksum = 0;
+			for(i=0; i<SPI_COMMAND_SIZE-1; i++) {
+				checksum += spiRxBuff[i];
+			}
+			checksum = checksum &0xFF;
+		} while(checksum != spiRxBuff[SPI_COMMAND_SIZE-1] || spiRxBuff[0]!=0xAA || spiRxBuff[1]!=0xBB);
 		
 		/*
 		spiSelect(&SPID1);
@@ -221,8 +354,8 @@ static THD_FUNCTION(spi_thread, p) {
 		}
 		*/
 
-		numPackets = 76800/SPI_DATA_PAYLOAD_SIZE;
-		remainingBytes = 76800%SPI_DATA_PAYLOAD_SIZE;
+		numPackets = frame->size/SPI_DATA_PAYLOAD_SIZE;
+		remainingBytes = frame->size%SPI_DATA_PAYLOAD_SIZE;
 		spiDataIndex = 0;	
 
 		for(packetId=0; packetId<numPackets; packetId++) {
@@ -242,7 +375,7 @@ static THD_FUNCTION(spi_thread, p) {
 			*/
 						
 			spiSelect(&SPID1);
-			spiSend(&SPID1, SPI_DATA_PAYLOAD_SIZE, &sample_buffer[spiDataIndex]);
+			spiSend(&SPID1, SPI_DATA_PAYLOAD_SIZE, &frame->buffer[spiDataIndex]);
 			spiUnselect(&SPID1);
 			// A little pause is needed for the communication to work, 400 NOP loops last about 26 us.
 			for(delay=0; delay<SPI_DELAY; delay++) {
@@ -269,7 +402,7 @@ static THD_FUNCTION(spi_thread, p) {
 						
 			spiSelect(&SPID1);
 			//palSetPad(GPIOD, 15); // Blue.
-			spiSend(&SPID1, remainingBytes, &sample_buffer[spiDataIndex]);
+			spiSend(&SPID1, remainingBytes, &frame->buffer[spiDataIndex]);
 			//palClearPad(GPIOD, 15); // Blue.
 			spiUnselect(&SPID1);
 			
@@ -290,18 +423,23 @@ static THD_FUNCTION(spi_thread, p) {
 			}
 		}
 		*/
+
+		sent_seq = frame->header.seq;
+		frame_pool_release(&frame_pool, frame);
 		
 //		dcmiStartOneShot(&DCMID);
 		
 		
 		palClearPad(GPIOD, 13) ; // Orange.
-		
-		chThdSleepMilliseconds(50);
 	}
 }
 
 int main(void)
 {
+    frame_slot_t *frame;
+    event_listener_t frame_listener;
+    event_listener_t button_listener;
+    systime_t led_time;
 
     halInit();
     chSysInit();
@@ -309,6 +447,7 @@ int main(void)
 
     parameter_namespace_declare(&parameter_root, NULL, NULL);
 
+    frame_pool_init(&frame_pool, frame_pool_storage, sizeof(frame_pool_storage));
 
     // UART2 on PA2(TX) and PA3(RX)
     sdStart(&SD2, NULL);
@@ -328,6 +467,8 @@ int main(void)
     //parameter_namespace_declare(&aseba_ns, &parameter_root, "aseba");
     //aseba_declare_parameters(&aseba_ns);
 
+    exposure_controller_declare_parameters(&parameter_root);
+
     /* Load parameter tree from flash. */
     load_config();
 
@@ -359,6 +500,12 @@ int main(void)
     if(po8030_config(FORMAT_YCBYCR, SIZE_QQVGA) != MSG_OK) { // Default configuration.
         dcmiErrorFlag = 1;
     }
+    camera_control_start();
+    exposure_controller_start();
+    blob_tracker_start(blobs_cb);
+    motion_detector_start(motion_cb);
+    flow_estimator_start(flow_cb);
+    line_follower_start(line_cb);
 
 	/*
 	capture_mode = CAPTURE_ONE_SHOT;
@@ -366,8 +513,9 @@ int main(void)
 	po8030_save_current_format(FORMAT_YYYY);
 	po8030_save_current_subsampling(SUBSAMPLING_X1, SUBSAMPLING_X1);
 	po8030_advanced_config(FORMAT_YYYY, 1, 1, 320, 240, SUBSAMPLING_X1, SUBSAMPLING_X1);
-	sample_buffer = (uint8_t*)malloc(po8030_get_image_size());
-	dcmiPrepare(&DCMID, &dcmicfg, po8030_get_image_size(), (uint32_t*)sample_buffer, NULL);
+	frame_pool_configure(&frame_pool, po8030_get_image_size());
+	capture_slot[0] = frame_pool_acquire(&frame_pool);
+	dcmiPrepare(&DCMID, &dcmicfg, po8030_get_image_size(), (uint32_t*)capture_slot[0]->buffer, NULL);
 	palSetPad(GPIOD, 13) ; // Orange.
 	dcmiStartOneShot(&DCMID);
 	*/
@@ -411,17 +559,25 @@ int main(void)
 	chThdCreateStatic(spi_thread_wa, sizeof(spi_thread_wa), NORMALPRIO, spi_thread, NULL);
 	//chThdCreateStatic(spi_thread_wa, sizeof(spi_thread_wa), NORMALPRIO + 1, spi_thread, NULL);
 
+    chEvtRegisterMask(&frame_ready_event, &frame_listener, FRAME_READY_EVENT);
+    chEvtRegisterMask(&button_event, &button_listener, BUTTON_EVENT);
+    led_time = chVTGetSystemTime();
+
     /* Infinite loop. */
     while (1) {
-        chThdSleepMilliseconds(500);
+        // Woken up as soon as a frame is ready or the button is released, the timeout keeps the leds blinking without frames.
+        chEvtWaitAnyTimeout(FRAME_READY_EVENT | BUTTON_EVENT, LED_PERIOD);
 
         // Led toggled to verify main is running and to show DCMI state.
-        if(dcmiErrorFlag == 1) {
-            palClearPad(GPIOD, 12); // Green.
-            palTogglePad(GPIOD, 14); // Red.
-        } else {
-            palClearPad(GPIOD, 14); // Red.
-            palTogglePad(GPIOD, 12); // Green.
+        if(chVTTimeElapsedSinceX(led_time) >= LED_PERIOD) {
+            led_time = chVTGetSystemTime();
+            if(dcmiErrorFlag == 1) {
+                palClearPad(GPIOD, 12); // Green.
+                palTogglePad(GPIOD, 14); // Red.
+            } else {
+                palClearPad(GPIOD, 14); // Red.
+                palTogglePad(GPIOD, 12); // Green.
+            }
         }
 
         //chprintf((BaseSequentialStream *)&SDU1, "%d\r\n", dmaStreamGetTransactionSize(DCMID.dmastp));
@@ -433,16 +589,10 @@ int main(void)
             //palClearPad(GPIOD, 15); // Blue.
             //palClearPad(GPIOD, 13) ; // Orange.
 
-            if(capture_mode == CAPTURE_ONE_SHOT) {
-                chnWrite((BaseSequentialStream *)&SDU1, sample_buffer, po8030_get_image_size());
-            } else {
-                if(double_buffering == 1) { // Send both images.
-                    chnWrite((BaseSequentialStream *)&SDU1, sample_buffer, po8030_get_image_size());
-                    chThdSleepMilliseconds(3000);
-                    chnWrite((BaseSequentialStream *)&SDU1, sample_buffer2, po8030_get_image_size());
-                } else {
-                    chnWrite((BaseSequentialStream *)&SDU1, sample_buffer, po8030_get_image_size());
-                }
+            frame = frame_pool_borrow_latest(&frame_pool);
+            if(frame != NULL) {
+                chnWrite((BaseSequentialStream *)&SDU1, frame->buffer, frame->size);
+                frame_pool_release(&frame_pool, frame);
             }
         }
 
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include "parameter/parameter.h"
+#include "camera/frame_pool.h"
 
 extern parameter_namespace_t parameter_root;
 
@@ -14,9 +15,28 @@ extern parameter_namespace_t parameter_root;
 #define CAPTURE_CONTINUOUS 1
 extern const DCMIConfig dcmicfg;
 extern uint8_t capture_mode;
-extern uint8_t *sample_buffer;
-extern uint8_t *sample_buffer2;
 extern uint8_t double_buffering;
+extern uint8_t buffer_rotation;
+extern volatile uint32_t frames_dropped;
+extern frame_pool_t frame_pool;
+extern frame_slot_t *capture_slot[2];
+extern volatile uint32_t band_count;
+
+/* Places a buffer in the core coupled memory (64 KB CCM, ram4 in the linker
+ * script) instead of the main RAM. The CCM is not reachable by the DMA so
+ * this is only for buffers the CPU processes, and it is not cleared at
+ * startup: the buffer must be initialized before it is read. */
+#define CCM_BUFFER __attribute__((section(".ram4")))
+
+/* Size of the captured frames, taking the DCMI crop window into account. */
+void capture_geometry(uint16_t *width, uint16_t *height, uint32_t *line_size);
+
+/* Broadcast from the DMA interrupt every time a frame is published in
+ * frame_pool. Consumers register a listener and then get the frame with
+ * frame_pool_borrow_latest(), the slot sequence number tells whether frames
+ * were missed. */
+#define FRAME_READY_FLAG 1
+extern event_source_t frame_ready_event;
 
 #ifdef __cplusplus
 }
@@ -14,6 +14,24 @@ CSRC += ./src/usbcfg.c
 CSRC += src/chibios-syscalls/malloc_lock.c
 CSRC += src/chibios-syscalls/newlib_syscalls.c
 CSRC += ./src/config_flash_storage.c
+CSRC += ./src/camera/frame_pool.c
+CSRC += ./src/camera/po8030_regcache.c
+CSRC += ./src/camera/camera_ctrl_queue.c
+CSRC += ./src/camera/dcmi_crop.c
+CSRC += ./src/vision/yuv422.c
+CSRC += ./src/vision/color.c
+CSRC += ./src/vision/bayer.c
+CSRC += ./src/vision/pyramid.c
+CSRC += ./src/vision/rle_cc.c
+CSRC += ./src/vision/blob.c
+CSRC += ./src/vision/integral.c
+CSRC += ./src/vision/motion.c
+CSRC += ./src/vision/flow.c
+CSRC += ./src/vision/line_profile.c
+CSRC += ./src/vision/histogram.c
+CSRC += ./src/camera/auto_exposure.c
+CSRC += ./src/vision/lut.c
+CSRC += ./src/vision/lut_tables.c
 CSRC += src/cmp/cmp.c
 CSRC += src/cmp_mem_access/cmp_mem_access.c
 CSRC += src/crc/crc16.c
@@ -22,3 +40,10 @@ CSRC += src/parameter/parameter.c
 CSRC += src/parameter/parameter_msgpack.c
 CSRC += src/parameter/parameter_print.c
 CSRC += src/camera/po8030.c
+CSRC += src/camera/camera_control.c
+CSRC += src/camera/frame_consumer.c
+CSRC += src/vision/blob_tracker.c
+CSRC += src/vision/motion_detector.c
+CSRC += src/vision/flow_estimator.c
+CSRC += src/vision/line_follower.c
+CSRC += src/camera/exposure_controller.c
@@ -0,0 +1,112 @@
+#include <stdbool.h>
+#include "bayer.h"
+
+/* Same Q8 luma coefficients as the colour conversions. */
+#define R_TO_Y 77
+#define G_TO_Y 150
+#define B_TO_Y 29
+
+static inline void put_pixel(bayer_output_t output, void *dst, uint32_t i,
+                             uint8_t r, uint8_t g, uint8_t b)
+{
+    if (output == BAYER_OUT_GRAY) {
+        ((uint8_t *)dst)[i] = (R_TO_Y * r + G_TO_Y * g + B_TO_Y * b + 128) >> 8;
+    } else {
+        ((uint16_t *)dst)[i] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+}
+
+static inline uint8_t avg2(uint8_t a, uint8_t b)
+{
+    return (a + b + 1) >> 1;
+}
+
+static inline uint8_t avg4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    return (a + b + c + d + 2) >> 2;
+}
+
+void bayer_demosaic_row(const uint8_t *prev, const uint8_t *cur, const uint8_t *next,
+                        uint16_t width, bayer_pattern_t pattern,
+                        bayer_output_t output, void *dst)
+{
+    bool red_row = (pattern & 2) == 0;
+    uint8_t red_col = pattern & 1;
+    uint8_t r, g, b;
+    uint16_t x, l, rt;
+
+    for (x = 0; x < width; x++) {
+        /* Mirrored at the edges, which keeps the colour of the neighbours. */
+        l = (x > 0) ? x - 1 : 1;
+        rt = (x + 1 < width) ? x + 1 : width - 2;
+
+        if ((x & 1) == red_col) {
+            if (red_row) {
+                r = cur[x];
+                g = avg4(prev[x], next[x], cur[l], cur[rt]);
+                b = avg4(prev[l], prev[rt], next[l], next[rt]);
+            } else {
+                /* Green on a blue row, red above and below. */
+                r = avg2(prev[x], next[x]);
+                g = cur[x];
+                b = avg2(cur[l], cur[rt]);
+            }
+        } else {
+            if (red_row) {
+                r = avg2(cur[l], cur[rt]);
+                g = cur[x];
+                b = avg2(prev[x], next[x]);
+            } else {
+                r = avg4(prev[l], prev[rt], next[l], next[rt]);
+                g = avg4(prev[x], next[x], cur[l], cur[rt]);
+                b = cur[x];
+            }
+        }
+
+        put_pixel(output, dst, x, r, g, b);
+    }
+}
+
+void bayer_demosaic(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height,
+                    bayer_pattern_t pattern, bayer_output_t output, void *dst)
+{
+    uint32_t row_size = (output == BAYER_OUT_GRAY) ? width : 2 * (uint32_t)width;
+    const uint8_t *prev, *next;
+    uint16_t y;
+
+    for (y = 0; y < height; y++) {
+        prev = &src[(uint32_t)((y > 0) ? y - 1 : 1) * stride];
+        next = &src[(uint32_t)((y + 1 < height) ? y + 1 : height - 2) * stride];
+        bayer_demosaic_row(prev, &src[(uint32_t)y * stride], next, width,
+                           bayer_pattern_at(pattern, 0, y), output,
+                           (uint8_t *)dst + y * row_size);
+    }
+}
+
+void bayer_bin2x2_row(const uint8_t *row0, const uint8_t *row1, uint16_t width,
+                      bayer_pattern_t pattern, bayer_output_t output, void *dst)
+{
+    uint8_t q[4];
+    uint16_t x;
+
+    for (x = 0; x + 2 <= width; x += 2) {
+        /* Indexed like the pattern: bit 0 is the column, bit 1 the row. */
+        q[0] = row0[x];
+        q[1] = row0[x + 1];
+        q[2] = row1[x];
+        q[3] = row1[x + 1];
+        put_pixel(output, dst, x / 2, q[pattern], avg2(q[pattern ^ 1], q[pattern ^ 2]), q[pattern ^ 3]);
+    }
+}
+
+void bayer_bin2x2(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height,
+                  bayer_pattern_t pattern, bayer_output_t output, void *dst)
+{
+    uint32_t row_size = (output == BAYER_OUT_GRAY) ? width / 2 : 2 * (uint32_t)(width / 2);
+    uint16_t y;
+
+    for (y = 0; y + 2 <= height; y += 2) {
+        bayer_bin2x2_row(&src[(uint32_t)y * stride], &src[(uint32_t)(y + 1) * stride], width,
+                         pattern, output, (uint8_t *)dst + (y / 2) * row_size);
+    }
+}
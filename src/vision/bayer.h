@@ -0,0 +1,74 @@
+#ifndef BAYER_H
+#define BAYER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Demosaicing of the raw Bayer formats of the sensor, which take one byte
+ * per pixel instead of two for YUV422.
+ *
+ * The pattern is named after its first 2x2 block. The values are chosen so
+ * that bit 0 is the column and bit 1 the row of the red pixel in that block,
+ * which makes the pattern of a cropped region easy to derive. */
+typedef enum {
+    BAYER_RGGB = 0,
+    BAYER_GRBG = 1,
+    BAYER_GBRG = 2,
+    BAYER_BGGR = 3,
+} bayer_pattern_t;
+
+typedef enum {
+    BAYER_OUT_RGB565 = 0,   /**< Native uint16_t pixels, red in the top bits. */
+    BAYER_OUT_GRAY,         /**< One byte of luma per pixel. */
+} bayer_output_t;
+
+/** Returns the pattern seen from pixel (x, y) of a frame of the given
+ * pattern, e.g. to process a region of interest starting there. */
+static inline bayer_pattern_t bayer_pattern_at(bayer_pattern_t pattern, uint16_t x, uint16_t y)
+{
+    return (bayer_pattern_t)(pattern ^ ((x & 1) | ((y & 1) << 1)));
+}
+
+/** Bilinear demosaic of one row.
+ *
+ * prev, cur and next are the rows above, at and below the one computed, the
+ * caller passes a mirrored row at the top and bottom edges (i.e. next as
+ * prev for the first row). pattern is the one seen from the first pixel of
+ * cur, see bayer_pattern_at(). width must be at least 2.
+ *
+ * Only three rows are needed at a time, so a frame can be demosaiced a few
+ * rows at a time into a small buffer.
+ */
+void bayer_demosaic_row(const uint8_t *prev, const uint8_t *cur, const uint8_t *next,
+                        uint16_t width, bayer_pattern_t pattern,
+                        bayer_output_t output, void *dst);
+
+/** Bilinear demosaic of a region.
+ *
+ * src points to the first pixel of the region, stride is the length of a
+ * row of the source frame in bytes. The edges of the region are mirrored,
+ * so pixels outside of it are never read. dst receives width x height
+ * pixels. width and height must be at least 2.
+ */
+void bayer_demosaic(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height,
+                    bayer_pattern_t pattern, bayer_output_t output, void *dst);
+
+/** 2x2 binning: every block gives one pixel, using its red and blue
+ * samples and the average of its two greens. Halves the resolution for a
+ * fraction of the cost of the bilinear demosaic. */
+void bayer_bin2x2_row(const uint8_t *row0, const uint8_t *row1, uint16_t width,
+                      bayer_pattern_t pattern, bayer_output_t output, void *dst);
+
+/** 2x2 binning of a region, dst receives (width / 2) x (height / 2)
+ * pixels. */
+void bayer_bin2x2(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height,
+                  bayer_pattern_t pattern, bayer_output_t output, void *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BAYER_H */
@@ -0,0 +1,156 @@
+#include <string.h>
+#include "blob.h"
+
+/** Returns the lowest class of a mask plus one, 0 if there is none. */
+static inline uint8_t first_class(uint8_t mask)
+{
+    return mask ? __builtin_ctz(mask) + 1 : 0;
+}
+
+static void encode_row(rle_cc_t *cc, const blob_lut_t *lut, const uint8_t *row, uint16_t width)
+{
+    uint16_t x, start = 0;
+    uint8_t uv, cls[2], run_cls = 0, i;
+
+    for (x = 0; x + 1 < width; x += 2) {
+        /* Both pixels of a pair share their chroma. */
+        uv = lut->u[row[2 * x + 1]] & lut->v[row[2 * x + 3]];
+        cls[0] = first_class(lut->y[row[2 * x]] & uv);
+        cls[1] = first_class(lut->y[row[2 * x + 2]] & uv);
+
+        for (i = 0; i < 2; i++) {
+            if (cls[i] != run_cls) {
+                if (run_cls) {
+                    rle_cc_add_run(cc, start, x + i - 1, run_cls - 1);
+                }
+                run_cls = cls[i];
+                start = x + i;
+            }
+        }
+    }
+
+    if (run_cls) {
+        rle_cc_add_run(cc, start, x - 1, run_cls - 1);
+    }
+}
+
+static void keep_largest(blob_t *list, uint8_t *count, const blob_t *blob)
+{
+    uint8_t pos = *count;
+
+    if (pos == BLOB_MAX_PER_CLASS) {
+        if (list[pos - 1].area >= blob->area) {
+            return;
+        }
+        pos--;
+    } else {
+        (*count)++;
+    }
+
+    while (pos > 0 && list[pos - 1].area < blob->area) {
+        list[pos] = list[pos - 1];
+        pos--;
+    }
+    list[pos] = *blob;
+}
+
+static void region_done(void *arg, const rle_cc_stats_t *region)
+{
+    blob_tracker_t *tracker = arg;
+    blob_t blob;
+
+    if (region->m00 < tracker->min_area || region->cls >= BLOB_MAX_CLASSES) {
+        return;
+    }
+
+    blob.x_min = region->x_min;
+    blob.y_min = region->y_min;
+    blob.x_max = region->x_max;
+    blob.y_max = region->y_max;
+    blob.cx = (region->m10 + region->m00 / 2) / region->m00;
+    blob.cy = (region->m01 + region->m00 / 2) / region->m00;
+    blob.area = region->m00;
+    keep_largest(tracker->blobs[region->cls], &tracker->count[region->cls], &blob);
+}
+
+void blob_lut_init(blob_lut_t *lut)
+{
+    memset(lut, 0, sizeof(*lut));
+}
+
+void blob_lut_set_class(blob_lut_t *lut, uint8_t cls, const blob_threshold_t *threshold)
+{
+    uint8_t bit = 1 << cls;
+    unsigned i;
+
+    if (cls >= BLOB_MAX_CLASSES) {
+        return;
+    }
+
+    for (i = 0; i < 256; i++) {
+        lut->y[i] &= ~bit;
+        lut->u[i] &= ~bit;
+        lut->v[i] &= ~bit;
+        if (threshold == NULL) {
+            continue;
+        }
+        if (i >= threshold->y_min && i <= threshold->y_max) {
+            lut->y[i] |= bit;
+        }
+        if (i >= threshold->u_min && i <= threshold->u_max) {
+            lut->u[i] |= bit;
+        }
+        if (i >= threshold->v_min && i <= threshold->v_max) {
+            lut->v[i] |= bit;
+        }
+    }
+}
+
+void blob_init(blob_tracker_t *tracker)
+{
+    rle_cc_init(&tracker->cc, tracker->arena, sizeof(tracker->arena),
+                BLOB_MAX_ROW_RUNS, BLOB_MAX_REGIONS, region_done, tracker);
+    blob_begin_frame(tracker, 1);
+}
+
+void blob_begin_frame(blob_tracker_t *tracker, uint32_t min_area)
+{
+    rle_cc_reset(&tracker->cc);
+    tracker->min_area = min_area;
+    tracker->overflow = false;
+    memset(tracker->count, 0, sizeof(tracker->count));
+}
+
+void blob_process_rows(blob_tracker_t *tracker, const blob_lut_t *lut,
+                       const uint8_t *rows, uint16_t width, uint16_t n_rows)
+{
+    uint16_t y;
+
+    for (y = 0; y < n_rows; y++) {
+        encode_row(&tracker->cc, lut, &rows[(uint32_t)2 * y * width], width);
+        rle_cc_end_row(&tracker->cc);
+    }
+}
+
+uint16_t blob_end_frame(blob_tracker_t *tracker)
+{
+    uint16_t total = 0, i;
+
+    tracker->overflow = !rle_cc_end_frame(&tracker->cc);
+
+    for (i = 0; i < BLOB_MAX_CLASSES; i++) {
+        total += tracker->count[i];
+    }
+
+    return total;
+}
+
+uint16_t blob_track_yuv422(blob_tracker_t *tracker, const blob_lut_t *lut,
+                           const uint8_t *frame, uint16_t width, uint16_t height,
+                           uint32_t min_area)
+{
+    blob_begin_frame(tracker, min_area);
+    blob_process_rows(tracker, lut, frame, width, height);
+
+    return blob_end_frame(tracker);
+}
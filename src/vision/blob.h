@@ -0,0 +1,113 @@
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rle_cc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Colour segmentation and blob detection on YUV422 frames (FORMAT_YCBYCR),
+ * in the spirit of CMVision:
+ *
+ * - Every colour class is a box in YUV space. Three lookup tables give, for
+ *   each Y, U and V value, the bit mask of the classes accepting it, so the
+ *   classes of a pixel are the AND of three lookups.
+ * - Each row is run length encoded and fed to the connected components
+ *   engine (rle_cc.h), so a frame can be processed a few rows at a time
+ *   with a memory use independent of the resolution. The blob tracker
+ *   thread feeds it whole frames borrowed from the frame pool.
+ * - The largest blobs of each class are kept. */
+
+/** Number of colour classes, one bit each in the lookup tables. */
+#define BLOB_MAX_CLASSES 4
+
+/** Number of blobs kept per class, the largest ones. */
+#define BLOB_MAX_PER_CLASS 3
+
+/** Maximum number of runs per row, the others are dropped. */
+#define BLOB_MAX_ROW_RUNS 64
+
+/** Maximum number of regions open at the same time. */
+#define BLOB_MAX_REGIONS 128
+
+typedef struct {
+    uint8_t y_min, y_max;
+    uint8_t u_min, u_max;
+    uint8_t v_min, v_max;
+} blob_threshold_t;
+
+typedef struct {
+    uint8_t y[256];
+    uint8_t u[256];
+    uint8_t v[256];
+} blob_lut_t;
+
+typedef struct {
+    uint16_t x_min, y_min;
+    uint16_t x_max, y_max;
+    uint16_t cx, cy;    /**< Centroid, rounded to the nearest pixel. */
+    uint32_t area;      /**< In pixels. */
+} blob_t;
+
+typedef struct {
+    rle_cc_t cc;
+    uint64_t arena[(RLE_CC_ARENA_SIZE(BLOB_MAX_ROW_RUNS, BLOB_MAX_REGIONS) + 7) / 8];
+    uint32_t min_area;
+    bool overflow;      /**< Runs were dropped in the last frame. */
+
+    blob_t blobs[BLOB_MAX_CLASSES][BLOB_MAX_PER_CLASS];
+    uint8_t count[BLOB_MAX_CLASSES];
+} blob_tracker_t;
+
+/** Clears every class from the lookup tables. */
+void blob_lut_init(blob_lut_t *lut);
+
+/** Sets the YUV box of a class, or disables it if threshold is NULL. */
+void blob_lut_set_class(blob_lut_t *lut, uint8_t cls, const blob_threshold_t *threshold);
+
+/** Returns the bit mask of the classes accepting a pixel. */
+static inline uint8_t blob_lut_classify(const blob_lut_t *lut, uint8_t y, uint8_t u, uint8_t v)
+{
+    return lut->y[y] & lut->u[u] & lut->v[v];
+}
+
+/** Must be called once before the first frame. */
+void blob_init(blob_tracker_t *tracker);
+
+/** Starts a frame, dropping any frame left unfinished.
+ *
+ * Blobs smaller than min_area pixels will be ignored.
+ */
+void blob_begin_frame(blob_tracker_t *tracker, uint32_t min_area);
+
+/** Processes the next rows of the frame, rows being width pixels wide.
+ *
+ * Pixels accepted by several classes go to the lowest one.
+ */
+void blob_process_rows(blob_tracker_t *tracker, const blob_lut_t *lut,
+                       const uint8_t *rows, uint16_t width, uint16_t n_rows);
+
+/** Finishes the frame. The results are in tracker->blobs, sorted by
+ * decreasing area, and tracker->count.
+ *
+ * @returns The total number of blobs kept.
+ */
+uint16_t blob_end_frame(blob_tracker_t *tracker);
+
+/** Finds the blobs of a whole frame, see blob_begin_frame(),
+ * blob_process_rows() and blob_end_frame().
+ *
+ * @returns The total number of blobs kept.
+ */
+uint16_t blob_track_yuv422(blob_tracker_t *tracker, const blob_lut_t *lut,
+                           const uint8_t *frame, uint16_t width, uint16_t height,
+                           uint32_t min_area);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOB_H */
@@ -0,0 +1,90 @@
+#include <string.h>
+#include <ch.h>
+#include <hal.h>
+#include "blob_tracker.h"
+#include "main.h"
+#include "camera/po8030.h"
+#include "camera/frame_consumer.h"
+
+static CCM_BUFFER blob_lut_t lut;
+static CCM_BUFFER blob_tracker_t tracker;
+static blob_tracker_result_t result;
+static uint32_t min_area = 1;
+static blob_tracker_callback tracker_callback;
+
+/* Protects the lookup tables and the result. */
+static MUTEX_DECL(tracker_lock);
+
+static THD_FUNCTION(blob_tracker_thd, p)
+{
+    frame_consumer_t consumer;
+    time_measurement_t tm;
+    frame_slot_t *frame;
+
+    (void)p;
+    chRegSetThreadName("blob-tracker");
+
+    frame_consumer_init(&consumer, &frame_pool, &frame_ready_event);
+    chTMObjectInit(&tm);
+
+    while (true) {
+        frame = frame_consumer_wait(&consumer, FRAME_CONSUMER_YUV422, PO8030_MAX_WIDTH, PO8030_MAX_HEIGHT);
+
+        chMtxLock(&tracker_lock);
+        chTMStartMeasurementX(&tm);
+        blob_track_yuv422(&tracker, &lut, frame->buffer,
+                          frame->header.width, frame->header.height, min_area);
+        chTMStopMeasurementX(&tm);
+        if (!frame_consumer_release(&consumer, frame)) {
+            chMtxUnlock(&tracker_lock);
+            continue;
+        }
+        memcpy(result.blobs, tracker.blobs, sizeof(result.blobs));
+        memcpy(result.count, tracker.count, sizeof(result.count));
+        result.seq = consumer.last_seq;
+        result.overflow = tracker.overflow;
+        result.cycles = tm.last;
+        chMtxUnlock(&tracker_lock);
+
+        if (tracker_callback != NULL) {
+            tracker_callback();
+        }
+    }
+}
+
+void blob_tracker_start(blob_tracker_callback callback)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    blob_lut_init(&lut);
+    blob_init(&tracker);
+    tracker_callback = callback;
+    chThdCreateStatic(wa, sizeof(wa), NORMALPRIO - 1, blob_tracker_thd, NULL);
+}
+
+bool blob_tracker_set_class(uint8_t cls, const blob_threshold_t *threshold)
+{
+    if (cls >= BLOB_MAX_CLASSES) {
+        return false;
+    }
+
+    chMtxLock(&tracker_lock);
+    blob_lut_set_class(&lut, cls, threshold);
+    chMtxUnlock(&tracker_lock);
+
+    return true;
+}
+
+void blob_tracker_set_min_area(uint32_t area)
+{
+    chMtxLock(&tracker_lock);
+    min_area = area;
+    chMtxUnlock(&tracker_lock);
+}
+
+void blob_tracker_get(blob_tracker_result_t *out)
+{
+    chMtxLock(&tracker_lock);
+    *out = result;
+    chMtxUnlock(&tracker_lock);
+}
@@ -0,0 +1,45 @@
+#ifndef BLOB_TRACKER_H
+#define BLOB_TRACKER_H
+
+#include <stdint.h>
+#include "blob.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Called from the tracker thread every time a frame was processed. */
+typedef void (*blob_tracker_callback)(void);
+
+typedef struct {
+    blob_t blobs[BLOB_MAX_CLASSES][BLOB_MAX_PER_CLASS];
+    uint8_t count[BLOB_MAX_CLASSES];
+    uint32_t seq;       /**< Sequence number of the frame they were found in. */
+    bool overflow;      /**< Part of the frame was ignored, see blob_tracker_t. */
+    uint32_t cycles;    /**< Processing time of the frame, in CPU cycles. */
+} blob_tracker_result_t;
+
+/** Starts the thread looking for blobs in every published YUV422 frame.
+ *
+ * Frames in other formats are skipped. All classes are disabled until
+ * blob_tracker_set_class() is called.
+ */
+void blob_tracker_start(blob_tracker_callback callback);
+
+/** Sets the YUV box of a class, or disables it if threshold is NULL.
+ *
+ * @returns false if the class does not exist.
+ */
+bool blob_tracker_set_class(uint8_t cls, const blob_threshold_t *threshold);
+
+/** Sets the minimum area of the reported blobs, in pixels. */
+void blob_tracker_set_min_area(uint32_t min_area);
+
+/** Copies the blobs found in the latest processed frame. */
+void blob_tracker_get(blob_tracker_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOB_TRACKER_H */
@@ -0,0 +1,207 @@
+#include "color.h"
+#include "simd.h"
+
+/* Q8 coefficients, YCbCr to RGB. */
+#define CR_TO_R  359    /* 1.402 */
+#define CB_TO_G  (-88)  /* -0.344136 */
+#define CR_TO_G  (-183) /* -0.714136 */
+#define CB_TO_B  454    /* 1.772 */
+
+/* Q8 coefficients, RGB to YCbCr. */
+#define R_TO_Y   77     /* 0.299 */
+#define G_TO_Y   150    /* 0.587 */
+#define B_TO_Y   29     /* 0.114 */
+#define R_TO_CB  (-43)  /* -0.168736 */
+#define G_TO_CB  (-85)  /* -0.331264 */
+#define B_TO_CB  128    /* 0.5 */
+#define R_TO_CR  128    /* 0.5 */
+#define G_TO_CR  (-107) /* -0.418688 */
+#define B_TO_CR  (-21)  /* -0.081312 */
+
+/* The chroma is computed on the sum of two pixels, hence a Q9 result, with
+ * the 128 offset and the rounding folded in. */
+#define CHROMA_OFFSET ((128 << 9) + (1 << 8))
+
+static uint8_t clamp8(int32_t x)
+{
+    return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+static void yuv_pair_to_rgb_ref(const uint8_t *src, uint8_t rgb[2][3])
+{
+    int32_t cb = src[1] - 128;
+    int32_t cr = src[3] - 128;
+    int32_t dr = (CR_TO_R * cr + 128) >> 8;
+    int32_t dg = (CB_TO_G * cb + CR_TO_G * cr + 128) >> 8;
+    int32_t db = (CB_TO_B * cb + 128) >> 8;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        int32_t y = src[2 * i];
+        rgb[i][0] = clamp8(y + dr);
+        rgb[i][1] = clamp8(y + dg);
+        rgb[i][2] = clamp8(y + db);
+    }
+}
+
+static void rgb_pair_to_yuv_ref(const uint8_t rgb[2][3], uint8_t *dst)
+{
+    int32_t rs = rgb[0][0] + rgb[1][0];
+    int32_t gs = rgb[0][1] + rgb[1][1];
+    int32_t bs = rgb[0][2] + rgb[1][2];
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        dst[2 * i] = (R_TO_Y * rgb[i][0] + G_TO_Y * rgb[i][1] + B_TO_Y * rgb[i][2] + 128) >> 8;
+    }
+    dst[1] = clamp8((R_TO_CB * rs + G_TO_CB * gs + B_TO_CB * bs + CHROMA_OFFSET) >> 9);
+    dst[3] = clamp8((R_TO_CR * rs + G_TO_CR * gs + B_TO_CR * bs + CHROMA_OFFSET) >> 9);
+}
+
+static uint16_t rgb565_pack_ref(const uint8_t rgb[3])
+{
+    return ((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3);
+}
+
+static void rgb565_unpack_ref(uint16_t p, uint8_t rgb[3])
+{
+    uint8_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+void yuv422_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t pixels)
+{
+    uint8_t rgb[2][3];
+    uint32_t i;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        yuv_pair_to_rgb_ref(&src[2 * i], rgb);
+        dst[i] = rgb565_pack_ref(rgb[0]);
+        dst[i + 1] = rgb565_pack_ref(rgb[1]);
+    }
+}
+
+void yuv422_to_rgb888_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        yuv_pair_to_rgb_ref(&src[2 * i], (uint8_t (*)[3])&dst[3 * i]);
+    }
+}
+
+void rgb565_to_yuv422_ref(const uint16_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint8_t rgb[2][3];
+    uint32_t i;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        rgb565_unpack_ref(src[i], rgb[0]);
+        rgb565_unpack_ref(src[i + 1], rgb[1]);
+        rgb_pair_to_yuv_ref(rgb, &dst[2 * i]);
+    }
+}
+
+void rgb888_to_yuv422_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        rgb_pair_to_yuv_ref((const uint8_t (*)[3])&src[3 * i], &dst[2 * i]);
+    }
+}
+
+/* Converts the word Y0 Cb Y1 Cr to halfword pairs [R0, R1], [G0, G1] and
+ * [B0, B1]. Both pixels share the chroma, so the offsets are computed once
+ * and added to both lumas with a saturating halfword addition. */
+static inline void yuv_pair_to_rgb(uint32_t w, uint32_t *r, uint32_t *g, uint32_t *b)
+{
+    uint32_t y = simd_uxtb16(w);
+    uint32_t c = simd_ssub16(simd_uxtb16(simd_ror(w, 8)), 0x00800080);
+    int32_t dr = simd_smlad(c, SIMD_PACK16(0, CR_TO_R), 128) >> 8;
+    int32_t dg = simd_smlad(c, SIMD_PACK16(CB_TO_G, CR_TO_G), 128) >> 8;
+    int32_t db = simd_smlad(c, SIMD_PACK16(CB_TO_B, 0), 128) >> 8;
+
+    *r = simd_usat16(simd_sadd16(y, SIMD_PACK16(dr, dr)), 8);
+    *g = simd_usat16(simd_sadd16(y, SIMD_PACK16(dg, dg)), 8);
+    *b = simd_usat16(simd_sadd16(y, SIMD_PACK16(db, db)), 8);
+}
+
+/* Converts halfword pairs [R0, R1], [G0, G1] and [B0, B1] to the word
+ * Y0 Cb Y1 Cr. */
+static inline uint32_t rgb_pair_to_yuv(uint32_t r, uint32_t g, uint32_t b)
+{
+    /* [R0, G0] and [R1, G1] */
+    uint32_t rg0 = simd_pkhbt(r, g, 16);
+    uint32_t rg1 = simd_pkhtb(g, r, 16);
+    uint32_t y0 = simd_smlad(rg0, SIMD_PACK16(R_TO_Y, G_TO_Y), B_TO_Y * (int32_t)(b & 0xFFFF) + 128) >> 8;
+    uint32_t y1 = simd_smlad(rg1, SIMD_PACK16(R_TO_Y, G_TO_Y), B_TO_Y * (int32_t)(b >> 16) + 128) >> 8;
+
+    /* Sums of both pixels, [R0 + R1, G0 + G1] */
+    int32_t bs = simd_smuad(b, 0x00010001);
+    uint32_t rgs = SIMD_PACK16(simd_smuad(r, 0x00010001), simd_smuad(g, 0x00010001));
+    uint32_t cb = simd_usat(simd_smlad(rgs, SIMD_PACK16(R_TO_CB, G_TO_CB), B_TO_CB * bs + CHROMA_OFFSET) >> 9, 8);
+    uint32_t cr = simd_usat(simd_smlad(rgs, SIMD_PACK16(R_TO_CR, G_TO_CR), B_TO_CR * bs + CHROMA_OFFSET) >> 9, 8);
+
+    return y0 | (cb << 8) | (y1 << 16) | (cr << 24);
+}
+
+void yuv422_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t pixels)
+{
+    uint32_t i, r, g, b;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        yuv_pair_to_rgb(simd_load32(&src[2 * i]), &r, &g, &b);
+        simd_store32((uint8_t *)&dst[i],
+                     ((r & 0x00F800F8) << 8) | ((g & 0x00FC00FC) << 3) | ((b & 0x00F800F8) >> 3));
+    }
+}
+
+void yuv422_to_rgb888(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint32_t i, r, g, b;
+    uint8_t *p;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        yuv_pair_to_rgb(simd_load32(&src[2 * i]), &r, &g, &b);
+        p = &dst[3 * i];
+        p[0] = r;
+        p[1] = g;
+        p[2] = b;
+        p[3] = r >> 16;
+        p[4] = g >> 16;
+        p[5] = b >> 16;
+    }
+}
+
+void rgb565_to_yuv422(const uint16_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint32_t i, p, r, g, b;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        /* Both pixels are expanded to 8 bits at once, the masks keep the
+         * shifts from leaking bits across halfwords. */
+        p = simd_load32((const uint8_t *)&src[i]);
+        r = (p >> 11) & 0x001F001F;
+        g = (p >> 5) & 0x003F003F;
+        b = p & 0x001F001F;
+        r = (r << 3) | ((r >> 2) & 0x00070007);
+        g = (g << 2) | ((g >> 4) & 0x00030003);
+        b = (b << 3) | ((b >> 2) & 0x00070007);
+        simd_store32(&dst[2 * i], rgb_pair_to_yuv(r, g, b));
+    }
+}
+
+void rgb888_to_yuv422(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+    uint32_t i;
+    const uint8_t *p;
+
+    for (i = 0; i + 2 <= pixels; i += 2) {
+        p = &src[3 * i];
+        simd_store32(&dst[2 * i], rgb_pair_to_yuv(p[0] | (p[3] << 16), p[1] | (p[4] << 16), p[2] | (p[5] << 16)));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Colour conversions between YUV422 (FORMAT_YCBYCR byte order) and RGB.
+ *
+ * The YCbCr values are full range (JFIF / BT.601 coefficients, Y and
+ * chroma on 0..255 with chroma centered on 128). The coefficients are Q8 fixed
+ * point, which keeps every component within 2 of the exact result.
+ *
+ * RGB565 pixels are native uint16_t (red in the top bits), RGB888 pixels are
+ * the bytes R, G, B.
+ *
+ * As for the YUV422 deinterleaving kernels, every conversion has a portable
+ * reference (suffix _ref) and a version using the Cortex-M4 SIMD instructions
+ * which gives exactly the same output. pixels must be even. */
+
+void yuv422_to_rgb565(const uint8_t *src, uint16_t *dst, uint32_t pixels);
+void yuv422_to_rgb565_ref(const uint8_t *src, uint16_t *dst, uint32_t pixels);
+
+void yuv422_to_rgb888(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+void yuv422_to_rgb888_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+
+/** The chroma of every pair of pixels is computed from their average. */
+void rgb565_to_yuv422(const uint16_t *src, uint8_t *dst, uint32_t pixels);
+void rgb565_to_yuv422_ref(const uint16_t *src, uint8_t *dst, uint32_t pixels);
+
+void rgb888_to_yuv422(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+void rgb888_to_yuv422_ref(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLOR_H */
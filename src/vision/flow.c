@@ -0,0 +1,192 @@
+#include "flow.h"
+#include "simd.h"
+
+/* Smallest level usable, a block and its whole search window. */
+#define FLOW_MIN_SIZE (FLOW_BLOCK_SIZE + 2 * FLOW_SEARCH_RADIUS)
+
+uint32_t flow_block_sad_ref(const uint8_t *a, uint16_t a_stride, const uint8_t *b, uint16_t b_stride)
+{
+    uint32_t sad = 0;
+    uint16_t x, y;
+    int d;
+
+    for (y = 0; y < FLOW_BLOCK_SIZE; y++, a += a_stride, b += b_stride) {
+        for (x = 0; x < FLOW_BLOCK_SIZE; x++) {
+            d = a[x] - b[x];
+            sad += d < 0 ? -d : d;
+        }
+    }
+
+    return sad;
+}
+
+uint32_t flow_block_sad(const uint8_t *a, uint16_t a_stride, const uint8_t *b, uint16_t b_stride)
+{
+    uint32_t sad = 0;
+    uint16_t y;
+
+    for (y = 0; y < FLOW_BLOCK_SIZE; y++, a += a_stride, b += b_stride) {
+        sad = simd_usada8(simd_load32(a), simd_load32(b), sad);
+        sad = simd_usada8(simd_load32(a + 4), simd_load32(b + 4), sad);
+    }
+
+    return sad;
+}
+
+static int16_t median(int16_t *values, uint8_t n)
+{
+    int16_t v;
+    uint8_t i, j;
+
+    for (i = 1; i < n; i++) {
+        v = values[i];
+        for (j = i; j > 0 && values[j - 1] > v; j--) {
+            values[j] = values[j - 1];
+        }
+        values[j] = v;
+    }
+
+    return values[n / 2];
+}
+
+/* Grid position, evenly spread and away from the borders by the search radius. */
+static inline uint16_t grid_position(uint16_t size, uint8_t i, uint8_t n)
+{
+    return FLOW_SEARCH_RADIUS + (size - FLOW_MIN_SIZE) * (2 * i + 1) / (2 * n);
+}
+
+/* Searches the block at (x, y) of prev around (x + dx, y + dy) in cur. */
+static uint32_t search(const pyramid_level_t *prev, const pyramid_level_t *cur,
+                       int16_t x, int16_t y, int16_t *dx, int16_t *dy)
+{
+    const uint8_t *block = &prev->data[(uint32_t)y * prev->stride + x];
+    int16_t cx = *dx, cy = *dy, i, j, px, py;
+    uint32_t sad, best = UINT32_MAX;
+
+    for (j = cy - FLOW_SEARCH_RADIUS; j <= cy + FLOW_SEARCH_RADIUS; j++) {
+        py = y + j;
+        if (py < 0 || py > cur->height - FLOW_BLOCK_SIZE) {
+            continue;
+        }
+        for (i = cx - FLOW_SEARCH_RADIUS; i <= cx + FLOW_SEARCH_RADIUS; i++) {
+            px = x + i;
+            if (px < 0 || px > cur->width - FLOW_BLOCK_SIZE) {
+                continue;
+            }
+            sad = flow_block_sad(block, prev->stride, &cur->data[(uint32_t)py * cur->stride + px], cur->stride);
+            /* Ties go to the smallest displacement, scanned first from the centre row. */
+            if (sad < best || (sad == best && i * i + j * j < *dx * *dx + *dy * *dy)) {
+                best = sad;
+                *dx = i;
+                *dy = j;
+            }
+        }
+    }
+
+    return best;
+}
+
+static void fit(flow_result_t *result, uint16_t width, uint16_t height)
+{
+    float sx = 0, sy = 0, sdx = 0, sdy = 0, num = 0, den = 0, x, y, tx, ty;
+    const flow_vector_t *v;
+    uint8_t i, n = result->num_vectors;
+
+    for (i = 0; i < n; i++) {
+        v = &result->vectors[i];
+        sx += v->x + FLOW_BLOCK_SIZE / 2.0f;
+        sy += v->y + FLOW_BLOCK_SIZE / 2.0f;
+        sdx += v->dx;
+        sdy += v->dy;
+    }
+    tx = sdx / n;
+    ty = sdy / n;
+    sx /= n;
+    sy /= n;
+
+    /* Rotation of the vectors around the centroid of the blocks, once the
+     * translation is removed. */
+    for (i = 0; i < n; i++) {
+        v = &result->vectors[i];
+        x = v->x + FLOW_BLOCK_SIZE / 2.0f - sx;
+        y = v->y + FLOW_BLOCK_SIZE / 2.0f - sy;
+        num += x * (v->dy - ty) - y * (v->dx - tx);
+        den += x * x + y * y;
+    }
+
+    /* The translation is given at the image centre instead of the centroid. */
+    x = width / 2.0f - sx;
+    y = height / 2.0f - sy;
+    if (den > 0) {
+        tx -= num / den * y;
+        ty += num / den * x;
+        result->rotation = (int16_t)(1000.0f * num / den);
+    } else {
+        result->rotation = 0;
+    }
+    result->tx = (int16_t)(tx * FLOW_SCALE);
+    result->ty = (int16_t)(ty * FLOW_SCALE);
+}
+
+bool flow_estimate(const pyramid_t *prev, const pyramid_t *cur, flow_result_t *result)
+{
+    const pyramid_level_t *base = &prev->level[0], *lp;
+    int16_t all_dx[FLOW_GRID_X * FLOW_GRID_Y], all_dy[FLOW_GRID_X * FLOW_GRID_Y];
+    int16_t top, level, global_dx = 0, global_dy = 0, dx, dy;
+    flow_vector_t *v;
+    uint32_t sad;
+    uint8_t gx, gy, n;
+
+    for (top = prev->num_levels - 1; top >= 0; top--) {
+        if (prev->level[top].width >= FLOW_MIN_SIZE && prev->level[top].height >= FLOW_MIN_SIZE) {
+            break;
+        }
+    }
+    if (top < 0 || cur->num_levels < prev->num_levels) {
+        return false;
+    }
+
+    /* Coarse levels only give a global displacement, the median of the
+     * grid, as blocks near the borders often move out of such small images. */
+    for (level = top; level > 0; level--) {
+        lp = &prev->level[level];
+        n = 0;
+        for (gy = 0; gy < FLOW_GRID_Y; gy++) {
+            for (gx = 0; gx < FLOW_GRID_X; gx++, n++) {
+                all_dx[n] = global_dx;
+                all_dy[n] = global_dy;
+                search(lp, &cur->level[level], grid_position(lp->width, gx, FLOW_GRID_X),
+                       grid_position(lp->height, gy, FLOW_GRID_Y), &all_dx[n], &all_dy[n]);
+            }
+        }
+        global_dx = 2 * median(all_dx, n);
+        global_dy = 2 * median(all_dy, n);
+    }
+
+    /* Blocks whose whole search window moved out of the image are left out. */
+    result->num_vectors = 0;
+    for (gy = 0; gy < FLOW_GRID_Y; gy++) {
+        for (gx = 0; gx < FLOW_GRID_X; gx++) {
+            v = &result->vectors[result->num_vectors];
+            v->x = grid_position(base->width, gx, FLOW_GRID_X);
+            v->y = grid_position(base->height, gy, FLOW_GRID_Y);
+            dx = global_dx;
+            dy = global_dy;
+            sad = search(base, &cur->level[0], v->x, v->y, &dx, &dy);
+            if (sad == UINT32_MAX) {
+                continue;
+            }
+            v->sad = sad > UINT16_MAX ? UINT16_MAX : sad;
+            v->dx = dx;
+            v->dy = dy;
+            result->num_vectors++;
+        }
+    }
+    if (result->num_vectors == 0) {
+        return false;
+    }
+
+    fit(result, base->width, base->height);
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pyramid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sparse optical flow by block matching.
+ *
+ * A grid of FLOW_GRID_X x FLOW_GRID_Y blocks of FLOW_BLOCK_SIZE pixels is
+ * matched between two frames, minimising the sum of absolute differences
+ * (USADA8). The grid is first searched within FLOW_SEARCH_RADIUS pixels
+ * at the coarsest pyramid level, the median vector is then doubled and
+ * refined by the same radius at each finer level, every block getting its
+ * own vector at level 0. The search range thus grows with the number of
+ * levels while the cost stays fixed: at most
+ * FLOW_GRID_X * FLOW_GRID_Y * levels * (2 * FLOW_SEARCH_RADIUS + 1)^2
+ * block comparisons per frame.
+ *
+ * The vectors are then fitted with a translation and a rotation around
+ * the image centre, in the least squares sense. */
+
+#define FLOW_BLOCK_SIZE 8
+#define FLOW_GRID_X 4
+#define FLOW_GRID_Y 3
+#define FLOW_SEARCH_RADIUS 2
+
+/** Fixed point scale of the translation. */
+#define FLOW_SCALE 16
+
+typedef struct {
+    uint16_t x, y;      /**< Top left corner of the block at level 0. */
+    int16_t dx, dy;     /**< Displacement from the previous frame, in pixels. */
+    uint16_t sad;
+} flow_vector_t;
+
+typedef struct {
+    flow_vector_t vectors[FLOW_GRID_X * FLOW_GRID_Y];
+    uint8_t num_vectors;
+    int16_t tx, ty;     /**< Global translation, in 1 / FLOW_SCALE pixel. */
+    int16_t rotation;   /**< Rotation around the image centre, in milliradians. */
+} flow_result_t;
+
+/** Sum of absolute differences of two FLOW_BLOCK_SIZE square blocks. */
+uint32_t flow_block_sad(const uint8_t *a, uint16_t a_stride, const uint8_t *b, uint16_t b_stride);
+uint32_t flow_block_sad_ref(const uint8_t *a, uint16_t a_stride, const uint8_t *b, uint16_t b_stride);
+
+/** Estimates the motion between two pyramids of the same size.
+ *
+ * Levels smaller than a block and its search window are not used. Blocks
+ * that moved so far that their search window is out of the image give no
+ * vector.
+ *
+ * @returns false if not even level 0 is large enough, or if no block gave a
+ * vector.
+ */
+bool flow_estimate(const pyramid_t *prev, const pyramid_t *cur, flow_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLOW_H */
@@ -0,0 +1,97 @@
+#include <ch.h>
+#include <hal.h>
+#include "flow_estimator.h"
+#include "pyramid.h"
+#include "main.h"
+#include "camera/frame_consumer.h"
+
+#define GRAY_WIDTH (FLOW_ESTIMATOR_MAX_WIDTH / 2)
+#define GRAY_HEIGHT (FLOW_ESTIMATOR_MAX_HEIGHT / 2)
+
+/* Levels 1 and 2 of the pyramid, level 0 being the halved luma itself. */
+#define LEVELS_SIZE (GRAY_WIDTH / 2 * GRAY_HEIGHT / 2 + GRAY_WIDTH / 4 * GRAY_HEIGHT / 4 + 8)
+
+/* Two of each, for the previous and current frames. */
+static CCM_BUFFER uint32_t gray[2][GRAY_WIDTH * GRAY_HEIGHT / 4];
+static CCM_BUFFER uint32_t levels[2][(LEVELS_SIZE + 3) / 4];
+static CCM_BUFFER uint32_t scratch[2 * FLOW_ESTIMATOR_MAX_WIDTH / 4];
+static pyramid_t pyramids[2];
+
+static flow_estimator_result_t result;
+static flow_estimator_callback estimator_callback;
+
+/* Protects the result. */
+static MUTEX_DECL(estimator_lock);
+
+static THD_FUNCTION(flow_estimator_thd, p)
+{
+    frame_consumer_t consumer;
+    time_measurement_t tm;
+    frame_slot_t *frame;
+    flow_result_t flow;
+    uint16_t width = 0, height = 0;
+    uint8_t cur = 0;
+    bool has_prev = false, valid;
+
+    (void)p;
+    chRegSetThreadName("flow-estimator");
+
+    frame_consumer_init(&consumer, &frame_pool, &frame_ready_event);
+    chTMObjectInit(&tm);
+
+    while (true) {
+        frame = frame_consumer_wait(&consumer, FRAME_CONSUMER_YUV422,
+                                    FLOW_ESTIMATOR_MAX_WIDTH, FLOW_ESTIMATOR_MAX_HEIGHT);
+
+        if (frame->header.width != width || frame->header.height != height) {
+            width = frame->header.width;
+            height = frame->header.height;
+            has_prev = false;
+        }
+
+        chTMStartMeasurementX(&tm);
+        pyramid_downsample_yuv422(frame->buffer, width, height, (uint8_t *)scratch, (uint8_t *)gray[cur]);
+        if (!frame_consumer_release(&consumer, frame)) {
+            continue;   /* gray[cur] is simply overwritten by the next frame. */
+        }
+        if (!pyramid_build(&pyramids[cur], (uint8_t *)gray[cur], width / 2, width / 2, height / 2,
+                           FLOW_ESTIMATOR_LEVELS, (uint8_t *)levels[cur], sizeof(levels[cur]))) {
+            has_prev = false;
+            continue;
+        }
+        valid = has_prev && flow_estimate(&pyramids[!cur], &pyramids[cur], &flow);
+        chTMStopMeasurementX(&tm);
+
+        /* The previous pyramid is only kept if the current one is valid. */
+        has_prev = true;
+        cur = !cur;
+        if (!valid) {
+            continue;
+        }
+
+        chMtxLock(&estimator_lock);
+        result.flow = flow;
+        result.seq = consumer.last_seq;
+        result.cycles = tm.last;
+        chMtxUnlock(&estimator_lock);
+
+        if (estimator_callback != NULL) {
+            estimator_callback();
+        }
+    }
+}
+
+void flow_estimator_start(flow_estimator_callback callback)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    estimator_callback = callback;
+    chThdCreateStatic(wa, sizeof(wa), NORMALPRIO - 1, flow_estimator_thd, NULL);
+}
+
+void flow_estimator_get(flow_estimator_result_t *out)
+{
+    chMtxLock(&estimator_lock);
+    *out = result;
+    chMtxUnlock(&estimator_lock);
+}
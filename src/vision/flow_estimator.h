@@ -0,0 +1,38 @@
+#ifndef FLOW_ESTIMATOR_H
+#define FLOW_ESTIMATOR_H
+
+#include <stdint.h>
+#include "flow.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest frame the estimator handles, larger frames are skipped. */
+#define FLOW_ESTIMATOR_MAX_WIDTH 160
+#define FLOW_ESTIMATOR_MAX_HEIGHT 120
+
+/** Pyramid levels built from the halved luma: 1/2, 1/4 and 1/8 of the frame. */
+#define FLOW_ESTIMATOR_LEVELS 3
+
+/** Called from the estimator thread after every new estimate. */
+typedef void (*flow_estimator_callback)(void);
+
+typedef struct {
+    flow_result_t flow;     /**< In pixels of the halved luma. */
+    uint32_t seq;           /**< Sequence number of the frame. */
+    uint32_t cycles;        /**< Processing time of the frame, in CPU cycles. */
+} flow_estimator_result_t;
+
+/** Starts the thread estimating the motion between consecutive published
+ * YUV422 frames. The first frame after a size change gives no estimate. */
+void flow_estimator_start(flow_estimator_callback callback);
+
+/** Copies the latest estimate. */
+void flow_estimator_get(flow_estimator_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLOW_ESTIMATOR_H */
@@ -0,0 +1,122 @@
+#include <string.h>
+#include "histogram.h"
+#include "simd.h"
+
+/* Clips the region to the rows given, returns false if nothing is left. */
+static bool clip(const histogram_roi_t *roi, uint16_t width, uint16_t first_row, uint16_t n_rows,
+                 uint16_t *x0, uint16_t *x1, uint16_t *y0, uint16_t *y1)
+{
+    uint32_t end;
+
+    *x0 = 0;
+    *x1 = width;
+    *y0 = first_row;
+    *y1 = first_row + n_rows;
+
+    if (roi != NULL && roi->width > 0 && roi->height > 0) {
+        end = (uint32_t)roi->x + roi->width;
+        *x0 = roi->x < width ? roi->x : width;
+        *x1 = end < width ? end : width;
+        end = (uint32_t)roi->y + roi->height;
+        *y0 = roi->y > *y0 ? roi->y : *y0;
+        *y1 = end < *y1 ? end : *y1;
+    }
+
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+void histogram_reset(histogram_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+void histogram_add_yuv422(histogram_t *hist, const uint8_t *rows, uint16_t width,
+                          uint16_t first_row, uint16_t n_rows, const histogram_roi_t *roi)
+{
+    uint32_t w, chroma, sum_y = 0, sum_u = 0, sum_v = 0;
+    uint16_t x, x0, x1, y, y0, y1;
+
+    if (!clip(roi, width, first_row, n_rows, &x0, &x1, &y0, &y1)) {
+        return;
+    }
+    x0 &= ~1u;
+    x1 = (x1 + 1) & ~1u;
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *row = &rows[(uint32_t)2 * width * (y - first_row)];
+
+        /* Y0 Cb Y1 Cr, one pixel pair per word. */
+        for (x = x0; x < x1; x += 2) {
+            w = simd_load32(&row[2 * x]);
+            hist->luma[w & 0xFF]++;
+            hist->luma[(w >> 16) & 0xFF]++;
+            sum_y = simd_usada8(simd_uxtb16(w), 0, sum_y);
+            chroma = simd_uxtb16(simd_ror(w, 8));
+            sum_u += chroma & 0xFFFF;
+            sum_v += chroma >> 16;
+        }
+    }
+
+    hist->count += (uint32_t)(x1 - x0) * (y1 - y0);
+    hist->chroma_count += (uint32_t)(x1 - x0) / 2 * (y1 - y0);
+    hist->sum_y += sum_y;
+    hist->sum_u += sum_u;
+    hist->sum_v += sum_v;
+}
+
+void histogram_add_gray(histogram_t *hist, const uint8_t *rows, uint16_t width,
+                        uint16_t first_row, uint16_t n_rows, const histogram_roi_t *roi)
+{
+    uint32_t sum_y = 0;
+    uint16_t x, x0, x1, y, y0, y1;
+
+    if (!clip(roi, width, first_row, n_rows, &x0, &x1, &y0, &y1)) {
+        return;
+    }
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *row = &rows[(uint32_t)width * (y - first_row)];
+
+        for (x = x0; x < x1; x++) {
+            hist->luma[row[x]]++;
+            sum_y += row[x];
+        }
+    }
+
+    hist->count += (uint32_t)(x1 - x0) * (y1 - y0);
+    hist->sum_y += sum_y;
+}
+
+uint8_t histogram_mean(const histogram_t *hist)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    return (hist->sum_y + hist->count / 2) / hist->count;
+}
+
+uint8_t histogram_percentile(const histogram_t *hist, uint16_t permille)
+{
+    uint64_t limit = (uint64_t)hist->count * permille;
+    uint64_t below = 0;
+    unsigned i;
+
+    for (i = 0; i < HISTOGRAM_BINS - 1; i++) {
+        below += hist->luma[i];
+        if (below * 1000 >= limit) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+void histogram_mean_chroma(const histogram_t *hist, uint8_t *u, uint8_t *v)
+{
+    if (hist->chroma_count == 0) {
+        *u = *v = 128;
+        return;
+    }
+    *u = (hist->sum_u + hist->chroma_count / 2) / hist->chroma_count;
+    *v = (hist->sum_v + hist->chroma_count / 2) / hist->chroma_count;
+}
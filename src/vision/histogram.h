@@ -0,0 +1,66 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Luma histogram and chroma statistics, gathered in a single pass.
+ *
+ * Rows are added with their position in the frame, so statistics can be
+ * accumulated over several calls covering parts of a frame. Only the
+ * pixels inside the metering region are counted. */
+
+#define HISTOGRAM_BINS 256
+
+/** Metering region, in pixels. A zero width or height selects the whole
+ * frame. */
+typedef struct {
+    uint16_t x, y;
+    uint16_t width, height;
+} histogram_roi_t;
+
+typedef struct {
+    uint32_t luma[HISTOGRAM_BINS];
+    uint32_t count;             /**< Number of pixels counted. */
+    uint32_t sum_y;
+    uint32_t sum_u, sum_v;      /**< Sums over pixel pairs, see chroma_count. */
+    uint32_t chroma_count;      /**< Number of pixel pairs counted. */
+} histogram_t;
+
+/** Clears the statistics before a new frame. */
+void histogram_reset(histogram_t *hist);
+
+/** Adds n_rows YUV422 rows (FORMAT_YCBYCR) of width pixels, the first one
+ * being row first_row of the frame.
+ *
+ * The region is widened to whole pixel pairs, which share their chroma.
+ *
+ * @note width must be even.
+ */
+void histogram_add_yuv422(histogram_t *hist, const uint8_t *rows, uint16_t width,
+                          uint16_t first_row, uint16_t n_rows, const histogram_roi_t *roi);
+
+/** Same as histogram_add_yuv422() for greyscale rows, the chroma stays
+ * untouched. */
+void histogram_add_gray(histogram_t *hist, const uint8_t *rows, uint16_t width,
+                        uint16_t first_row, uint16_t n_rows, const histogram_roi_t *roi);
+
+/** Returns the mean luma, 0 if no pixel was counted. */
+uint8_t histogram_mean(const histogram_t *hist);
+
+/** Returns the smallest luma value such that at least permille / 1000 of
+ * the pixels are not brighter. */
+uint8_t histogram_percentile(const histogram_t *hist, uint16_t permille);
+
+/** Gives the mean chroma, 128 if no pixel pair was counted. */
+void histogram_mean_chroma(const histogram_t *hist, uint8_t *u, uint8_t *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HISTOGRAM_H */
@@ -0,0 +1,87 @@
+#include <string.h>
+#include "integral.h"
+
+/** Returns integral row r, the sums of the image rows above row r. */
+static inline uint32_t *integral_row(const integral_t *ii, uint16_t r)
+{
+    return &ii->rows[(uint32_t)(r % ii->num_rows) * (ii->width + 1)];
+}
+
+uint32_t integral_arena_size(uint16_t width, uint16_t num_rows)
+{
+    return (uint32_t)(width + 1) * num_rows * sizeof(uint32_t);
+}
+
+bool integral_init(integral_t *ii, uint16_t width, uint16_t num_rows,
+                   uint32_t *arena, uint32_t arena_size)
+{
+    if (num_rows < 2 || integral_arena_size(width, num_rows) > arena_size) {
+        return false;
+    }
+
+    ii->rows = arena;
+    ii->width = width;
+    ii->num_rows = num_rows;
+    integral_reset(ii);
+
+    return true;
+}
+
+void integral_reset(integral_t *ii)
+{
+    ii->height = 0;
+    memset(integral_row(ii, 0), 0, (ii->width + 1) * sizeof(uint32_t));
+}
+
+void integral_add_rows(integral_t *ii, const uint8_t *src, uint16_t stride, uint16_t n_rows)
+{
+    const uint32_t *prev;
+    uint32_t *cur, acc;
+    uint16_t x, y;
+
+    for (y = 0; y < n_rows; y++, src += stride) {
+        prev = integral_row(ii, ii->height);
+        cur = integral_row(ii, ii->height + 1);
+
+        cur[0] = 0;
+        acc = 0;
+        for (x = 0; x < ii->width; x++) {
+            acc += src[x];
+            cur[x + 1] = prev[x + 1] + acc;
+        }
+        ii->height++;
+    }
+}
+
+uint16_t integral_first_row(const integral_t *ii)
+{
+    return ii->height < ii->num_rows ? 0 : ii->height - ii->num_rows + 1;
+}
+
+uint32_t integral_rect_sum(const integral_t *ii, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    const uint32_t *top = integral_row(ii, y);
+    const uint32_t *bottom = integral_row(ii, y + h);
+
+    return bottom[x + w] - bottom[x] - top[x + w] + top[x];
+}
+
+void integral_box_filter_row(const integral_t *ii, uint16_t y, uint16_t radius, uint8_t *dst)
+{
+    const uint32_t *top, *bottom;
+    uint16_t x, x0, x1, y0, y1;
+    uint32_t area, sum;
+
+    y0 = y > radius ? y - radius : 0;
+    y1 = y + radius + 1 < ii->height ? y + radius + 1 : ii->height;
+    top = integral_row(ii, y0);
+    bottom = integral_row(ii, y1);
+
+    for (x = 0; x < ii->width; x++) {
+        x0 = x > radius ? x - radius : 0;
+        x1 = x + radius + 1 < ii->width ? x + radius + 1 : ii->width;
+        area = (uint32_t)(x1 - x0) * (y1 - y0);
+        sum = bottom[x1] - bottom[x0] - top[x1] + top[x0];
+        dst[x] = (sum + area / 2) / area;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Integral image of a greyscale plane, to get the sum of any rectangle
+ * with four lookups.
+ *
+ * Entry (x, y) of the integral image is the sum of the pixels above and to
+ * the left of pixel (x, y), so it has width + 1 columns and one more row
+ * than the image. A full integral image of a QVGA frame would take 300 kB,
+ * so only the last num_rows rows are kept in a ring buffer. Rows are added
+ * a few at a time, and rectangles can be summed as long as both their top
+ * and bottom rows are still in the ring.
+ *
+ * Sums are kept in 32 bits, which holds frames of up to 16 megapixels. */
+
+typedef struct {
+    uint32_t *rows;
+    uint16_t width;
+    uint16_t num_rows;  /**< Number of integral rows kept. */
+    uint16_t height;    /**< Number of image rows added so far. */
+} integral_t;
+
+/** Returns the arena size needed to keep num_rows integral rows. */
+uint32_t integral_arena_size(uint16_t width, uint16_t num_rows);
+
+/** Sets up an empty integral image keeping num_rows rows.
+ *
+ * Summing rectangles h rows high needs at least h + 1 rows.
+ *
+ * @note The arena must be word aligned.
+ *
+ * @returns false if num_rows is less than 2 or if the arena is too small.
+ */
+bool integral_init(integral_t *ii, uint16_t width, uint16_t num_rows,
+                   uint32_t *arena, uint32_t arena_size);
+
+/** Starts a new frame. */
+void integral_reset(integral_t *ii);
+
+/** Adds the next n_rows rows of the image. */
+void integral_add_rows(integral_t *ii, const uint8_t *src, uint16_t stride, uint16_t n_rows);
+
+/** Returns the first image row which can still be the top of a rectangle. */
+uint16_t integral_first_row(const integral_t *ii);
+
+/** Returns the sum of a w x h rectangle whose top left pixel is (x, y).
+ *
+ * @note Rows y to y + h - 1 must have been added and y must not be less
+ * than integral_first_row().
+ */
+uint32_t integral_rect_sum(const integral_t *ii, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+/** Computes the mean of the (2 radius + 1)^2 box around every pixel of row y.
+ *
+ * Boxes are clipped to the image and to the rows added so far, so a row can
+ * be filtered as soon as row y + radius is added, or at the end of the
+ * frame. dst receives width pixels.
+ *
+ * @note y - radius must not be less than integral_first_row(), so the ring
+ * must keep at least 2 radius + 2 rows.
+ */
+void integral_box_filter_row(const integral_t *ii, uint16_t y, uint16_t radius, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTEGRAL_H */
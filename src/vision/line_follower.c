@@ -0,0 +1,102 @@
+#include <ch.h>
+#include <hal.h>
+#include "line_follower.h"
+#include "main.h"
+#include "camera/po8030.h"
+#include "camera/camera_control.h"
+#include "camera/frame_consumer.h"
+
+static CCM_BUFFER uint16_t profile[LINE_FOLLOWER_MAX_WIDTH];
+static uint8_t contrast = LINE_FOLLOWER_DEFAULT_CONTRAST;
+static bool dark = true;
+static line_follower_result_t result;
+static line_follower_callback follower_callback;
+
+/* Protects the settings and the result. */
+static MUTEX_DECL(follower_lock);
+
+static THD_FUNCTION(line_follower_thd, p)
+{
+    frame_consumer_t consumer;
+    time_measurement_t tm;
+    frame_slot_t *frame;
+    uint16_t width, rows;
+
+    (void)p;
+    chRegSetThreadName("line-follower");
+
+    frame_consumer_init(&consumer, &frame_pool, &frame_ready_event);
+    chTMObjectInit(&tm);
+
+    while (true) {
+        frame = frame_consumer_wait(&consumer, FRAME_CONSUMER_YUV422 | FRAME_CONSUMER_GRAY,
+                                    LINE_FOLLOWER_MAX_WIDTH, LINE_FOLLOWER_MAX_ROWS);
+        width = frame->header.width;
+        rows = frame->header.height;
+
+        chMtxLock(&follower_lock);
+        chTMStartMeasurementX(&tm);
+        if (frame->header.format == FORMAT_YCBYCR) {
+            line_profile_sum_yuv422(frame->buffer, width & ~1u, rows, profile);
+        } else {
+            line_profile_sum_gray(frame->buffer, width, rows, profile);
+        }
+        if (!frame_consumer_release(&consumer, frame)) {
+            chMtxUnlock(&follower_lock);
+            continue;
+        }
+        result.found = line_profile_find(profile, width, (uint32_t)contrast * rows, dark, &result.line);
+        chTMStopMeasurementX(&tm);
+
+        result.width = width;
+        result.seq = consumer.last_seq;
+        result.cycles = tm.last;
+        chMtxUnlock(&follower_lock);
+
+        if (follower_callback != NULL) {
+            follower_callback();
+        }
+    }
+}
+
+void line_follower_start(line_follower_callback callback)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    follower_callback = callback;
+    chThdCreateStatic(wa, sizeof(wa), NORMALPRIO - 1, line_follower_thd, NULL);
+}
+
+bool line_follower_set_window(uint16_t y, uint16_t rows)
+{
+    camera_ctrl_cmd_t cmd = {.kind = CAMERA_CTRL_WINDOW};
+
+    if (rows < 2 || rows > LINE_FOLLOWER_MAX_ROWS || y == 0 || y + rows - 1 > PO8030_MAX_HEIGHT) {
+        return false;
+    }
+
+    cmd.param.window.format = FORMAT_YYYY;
+    cmd.param.window.subsampling_x = SUBSAMPLING_X4;
+    cmd.param.window.subsampling_y = SUBSAMPLING_X1;
+    cmd.param.window.x1 = 1;
+    cmd.param.window.y1 = y;
+    cmd.param.window.width = PO8030_MAX_WIDTH;
+    cmd.param.window.height = rows;
+
+    return camera_control_post(&cmd);
+}
+
+void line_follower_set_detection(uint8_t value, bool dark_line)
+{
+    chMtxLock(&follower_lock);
+    contrast = value;
+    dark = dark_line;
+    chMtxUnlock(&follower_lock);
+}
+
+void line_follower_get(line_follower_result_t *out)
+{
+    chMtxLock(&follower_lock);
+    *out = result;
+    chMtxUnlock(&follower_lock);
+}
@@ -0,0 +1,56 @@
+#ifndef LINE_FOLLOWER_H
+#define LINE_FOLLOWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "line_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest frame the follower handles, larger frames are skipped so that
+ * full frames meant for the other trackers are ignored. */
+#define LINE_FOLLOWER_MAX_WIDTH 640
+#define LINE_FOLLOWER_MAX_ROWS 32
+
+/** Default weakest edge accepted, as a luma step per row. */
+#define LINE_FOLLOWER_DEFAULT_CONTRAST 24
+
+/** Called from the follower thread after every processed frame, whether a
+ * line was found or not. */
+typedef void (*line_follower_callback)(void);
+
+typedef struct {
+    line_t line;        /**< Only valid if found is set. */
+    bool found;
+    uint16_t width;     /**< Width of the profile, in pixels. */
+    uint32_t seq;       /**< Sequence number of the frame. */
+    uint32_t cycles;    /**< Processing time of the frame, in CPU cycles. */
+} line_follower_result_t;
+
+/** Starts the thread reducing every published thin frame, greyscale or
+ * YUV422, to a profile and looking for a line in it. */
+void line_follower_start(line_follower_callback callback);
+
+/** Asks the camera control thread for a greyscale window of rows rows
+ * starting at row y, across the whole sensor width subsampled to 160 pixels.
+ *
+ * @note The DCMI must be prepared again for the new frame size.
+ *
+ * @returns false if the window is out of range or could not be queued.
+ */
+bool line_follower_set_window(uint16_t y, uint16_t rows);
+
+/** Sets the weakest edge accepted, as a luma step per row, and whether the
+ * line is darker than the floor. */
+void line_follower_set_detection(uint8_t contrast, bool dark_line);
+
+/** Copies the result of the latest processed frame. */
+void line_follower_get(line_follower_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINE_FOLLOWER_H */
@@ -0,0 +1,139 @@
+#include <string.h>
+#include "line_profile.h"
+#include "simd.h"
+
+void line_profile_sum_yuv422_ref(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile)
+{
+    uint16_t x, y;
+
+    memset(profile, 0, width * sizeof(*profile));
+    for (y = 0; y < n_rows; y++, rows += 2 * width) {
+        for (x = 0; x < width; x++) {
+            profile[x] += rows[2 * x];
+        }
+    }
+}
+
+void line_profile_sum_yuv422(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile)
+{
+    uint8_t *acc = (uint8_t *)profile;
+    uint16_t x, y;
+
+    memset(profile, 0, width * sizeof(*profile));
+    for (y = 0; y < n_rows; y++, rows += 2 * width) {
+        /* Y0 Cb Y1 Cr: the lumas are already where UXTB16 puts them, which
+         * is also the order of the profile. Sums wrap like uint16_t. */
+        for (x = 0; x < width; x += 2) {
+            simd_store32(&acc[2 * x], simd_sadd16(simd_load32(&acc[2 * x]),
+                                                  simd_uxtb16(simd_load32(&rows[2 * x]))));
+        }
+    }
+}
+
+void line_profile_sum_gray_ref(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile)
+{
+    uint16_t x, y;
+
+    memset(profile, 0, width * sizeof(*profile));
+    for (y = 0; y < n_rows; y++, rows += width) {
+        for (x = 0; x < width; x++) {
+            profile[x] += rows[x];
+        }
+    }
+}
+
+void line_profile_sum_gray(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile)
+{
+    uint8_t *acc = (uint8_t *)profile;
+    uint32_t even, odd, w;
+    uint16_t x, y, end = width & ~3u;
+
+    memset(profile, 0, width * sizeof(*profile));
+
+    /* Columns are accumulated interleaved, [p0, p2] then [p1, p3] for every
+     * 4 pixels, and put back in order once all the rows are added. */
+    for (y = 0; y < n_rows; y++, rows += width) {
+        for (x = 0; x < end; x += 4) {
+            w = simd_load32(&rows[x]);
+            simd_store32(&acc[2 * x], simd_sadd16(simd_load32(&acc[2 * x]), simd_uxtb16(w)));
+            simd_store32(&acc[2 * x + 4], simd_sadd16(simd_load32(&acc[2 * x + 4]), simd_uxtb16(simd_ror(w, 8))));
+        }
+        for (; x < width; x++) {
+            profile[x] += rows[x];
+        }
+    }
+
+    for (x = 0; x < end; x += 4) {
+        even = simd_load32(&acc[2 * x]);
+        odd = simd_load32(&acc[2 * x + 4]);
+        simd_store32(&acc[2 * x], simd_pkhbt(even, odd, 16));
+        simd_store32(&acc[2 * x + 4], simd_pkhtb(odd, even, 16));
+    }
+}
+
+static inline int32_t step(const uint16_t *profile, uint16_t x)
+{
+    return (int32_t)profile[x + 1] - profile[x - 1];
+}
+
+/* Position of the step peak at x, refined with a parabola through its
+ * neighbours, in 1 / LINE_PROFILE_SCALE pixel. */
+static int16_t refine(const uint16_t *profile, uint16_t width, uint16_t x)
+{
+    int32_t left, centre, right, den, offset = 0;
+
+    if (x > 1 && x + 2 < width) {
+        centre = step(profile, x);
+        left = step(profile, x - 1);
+        right = step(profile, x + 1);
+        if (centre < 0) {
+            left = -left;
+            centre = -centre;
+            right = -right;
+        }
+        den = left - 2 * centre + right;
+        if (den < 0) {
+            offset = LINE_PROFILE_SCALE * (left - right) / (2 * den);
+        }
+    }
+
+    return x * LINE_PROFILE_SCALE + offset;
+}
+
+bool line_profile_find(const uint16_t *profile, uint16_t width, uint32_t min_step, bool dark_line, line_t *line)
+{
+    int32_t s, sign = dark_line ? 1 : -1, best_start = 0, best_end = 0;
+    uint16_t x, start = 0, end = 0;
+
+    if (width < 3) {
+        return false;
+    }
+
+    /* The start edge is the strongest step going into the line, the end
+     * edge the strongest step going out of it after the start. */
+    for (x = 1; x + 1 < width; x++) {
+        s = sign * step(profile, x);
+        if (-s > best_start) {
+            best_start = -s;
+            start = x;
+            end = start;
+            best_end = 0;
+        } else if (s > best_end) {
+            best_end = s;
+            end = x;
+        }
+    }
+
+    /* Without an end step after the start, even min_step 0 gives no line. */
+    if (best_start == 0 || best_end == 0 ||
+        (uint32_t)best_start < min_step || (uint32_t)best_end < min_step) {
+        return false;
+    }
+
+    line->left = refine(profile, width, start);
+    line->right = refine(profile, width, end);
+    line->centre = (line->left + line->right) / 2;
+    line->contrast = best_start < best_end ? best_start : best_end;
+
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef LINE_PROFILE_H
+#define LINE_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Line detection on 1D intensity profiles.
+ *
+ * Following a line on the floor only needs a few rows across the line, so
+ * the sensor can be set to a thin window and every frame reduced to one
+ * profile: the sum of its rows, column by column. The edges of the line
+ * are the strongest steps of the profile, located to a fraction of a pixel
+ * by fitting a parabola through the gradient around each peak. */
+
+/** Most rows a profile can sum without overflowing 16 bits. */
+#define LINE_PROFILE_MAX_ROWS 257
+
+/** Fixed point scale of the edge and centre positions. */
+#define LINE_PROFILE_SCALE 16
+
+typedef struct {
+    int16_t left, right;    /**< Edges, in 1 / LINE_PROFILE_SCALE pixel. */
+    int16_t centre;         /**< Middle of the edges, same unit. */
+    uint16_t contrast;      /**< Step of the weakest edge, in profile units. */
+} line_t;
+
+/** Sums the luma of n_rows YUV422 rows (FORMAT_YCBYCR) of width pixels,
+ * profile receives width values.
+ *
+ * @note width must be even.
+ */
+void line_profile_sum_yuv422(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile);
+void line_profile_sum_yuv422_ref(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile);
+
+/** Sums n_rows greyscale rows of width pixels, profile receives width values. */
+void line_profile_sum_gray(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile);
+void line_profile_sum_gray_ref(const uint8_t *rows, uint16_t width, uint16_t n_rows, uint16_t *profile);
+
+/** Finds a line in a profile.
+ *
+ * A dark line on a bright floor starts with the strongest falling step and
+ * ends with the strongest rising step to its right, the other way round for
+ * a bright line. Steps are measured over two pixels.
+ *
+ * @returns false if either edge is weaker than min_step, in profile units.
+ */
+bool line_profile_find(const uint16_t *profile, uint16_t width, uint32_t min_step, bool dark_line, line_t *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINE_PROFILE_H */
@@ -0,0 +1,115 @@
+#include "lut.h"
+#include "simd.h"
+
+void lut_apply_ref(const uint8_t *lut, uint8_t *data, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i < pixels; i++) {
+        data[i] = lut[data[i]];
+    }
+}
+
+void lut_apply(const uint8_t *lut, uint8_t *data, uint32_t pixels)
+{
+    uint32_t i, w;
+
+    /* One load and one store per four pixels instead of four of each. */
+    for (i = 0; i + 4 <= pixels; i += 4) {
+        w = simd_load32(&data[i]);
+        simd_store32(&data[i], lut[w & 0xFF] | (lut[(w >> 8) & 0xFF] << 8) |
+                               (lut[(w >> 16) & 0xFF] << 16) | ((uint32_t)lut[w >> 24] << 24));
+    }
+    for (; i < pixels; i++) {
+        data[i] = lut[data[i]];
+    }
+}
+
+void lut_apply_yuv422_ref(const uint8_t *lut, uint8_t *frame, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i < pixels; i++) {
+        frame[2 * i] = lut[frame[2 * i]];
+    }
+}
+
+void lut_apply_yuv422(const uint8_t *lut, uint8_t *frame, uint32_t pixels)
+{
+    uint32_t i, w;
+
+    /* Y0 Cb Y1 Cr, the chroma bytes are kept as they are. */
+    for (i = 0; i < pixels; i += 2) {
+        w = simd_load32(&frame[2 * i]);
+        simd_store32(&frame[2 * i], (w & 0xFF00FF00u) | lut[w & 0xFF] | (lut[(w >> 16) & 0xFF] << 16));
+    }
+}
+
+void lut_build_threshold(uint8_t *lut, uint8_t threshold)
+{
+    unsigned i;
+
+    for (i = 0; i < LUT_SIZE; i++) {
+        lut[i] = i < threshold ? 0 : 255;
+    }
+}
+
+void lut_build_stretch(uint8_t *lut, uint8_t low, uint8_t high)
+{
+    unsigned i;
+
+    if (high <= low) {
+        lut_build_threshold(lut, low);
+        return;
+    }
+
+    for (i = 0; i < LUT_SIZE; i++) {
+        if (i <= low) {
+            lut[i] = 0;
+        } else if (i >= high) {
+            lut[i] = 255;
+        } else {
+            lut[i] = (255 * (i - low) + (high - low) / 2) / (high - low);
+        }
+    }
+}
+
+void lut_build_auto_contrast(uint8_t *lut, const histogram_t *hist, uint16_t permille)
+{
+    uint8_t low = histogram_percentile(hist, permille);
+    uint8_t high = histogram_percentile(hist, 1000 - permille);
+    unsigned i;
+
+    if (high > low) {
+        lut_build_stretch(lut, low, high);
+        return;
+    }
+
+    /* Nothing to stretch in a flat frame. */
+    for (i = 0; i < LUT_SIZE; i++) {
+        lut[i] = i;
+    }
+}
+
+void lut_build_equalize(uint8_t *lut, const histogram_t *hist)
+{
+    uint32_t cdf = 0, first = 0, range;
+    unsigned i;
+
+    /* The darkest value present maps to 0, the brightest to 255. */
+    for (i = 0; i < LUT_SIZE && first == 0; i++) {
+        first = hist->luma[i];
+    }
+    range = hist->count - first;
+
+    for (i = 0; i < LUT_SIZE; i++) {
+        cdf += hist->luma[i];
+        if (range == 0) {
+            lut[i] = i;
+        } else if (cdf <= first) {
+            lut[i] = 0;
+        } else {
+            lut[i] = ((uint64_t)255 * (cdf - first) + range / 2) / range;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef LUT_H
+#define LUT_H
+
+#include <stdint.h>
+#include "histogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pixel remapping through a 256 entry lookup table, for gamma and
+ * contrast curves, histogram equalisation or thresholding.
+ *
+ * Tables are applied in place, four pixels per word. The standard curves
+ * are constant tables generated by tools/lut_tables.py, the adaptive ones
+ * are rebuilt from the histogram of a frame (histogram.h). */
+
+#define LUT_SIZE 256
+
+extern const uint8_t lut_gamma_0_45[LUT_SIZE];
+extern const uint8_t lut_gamma_2_2[LUT_SIZE];
+extern const uint8_t lut_s_curve[LUT_SIZE];
+
+/** Remaps a greyscale plane in place. */
+void lut_apply(const uint8_t *lut, uint8_t *data, uint32_t pixels);
+void lut_apply_ref(const uint8_t *lut, uint8_t *data, uint32_t pixels);
+
+/** Remaps the luma of a YUV422 frame (FORMAT_YCBYCR) in place, the chroma
+ * is left untouched. pixels must be even. */
+void lut_apply_yuv422(const uint8_t *lut, uint8_t *frame, uint32_t pixels);
+void lut_apply_yuv422_ref(const uint8_t *lut, uint8_t *frame, uint32_t pixels);
+
+/** 0 below threshold, 255 from it on. */
+void lut_build_threshold(uint8_t *lut, uint8_t threshold);
+
+/** Stretches [low, high] linearly to [0, 255], clipping outside. */
+void lut_build_stretch(uint8_t *lut, uint8_t low, uint8_t high);
+
+/** Stretches the luma range of a histogram, ignoring the permille / 1000
+ * darkest and brightest pixels. A flat histogram gives the identity. */
+void lut_build_auto_contrast(uint8_t *lut, const histogram_t *hist, uint16_t permille);
+
+/** Histogram equalisation, spreads the luma values so that they become
+ * about equally frequent. An empty or flat histogram gives the identity. */
+void lut_build_equalize(uint8_t *lut, const histogram_t *hist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUT_H */
@@ -0,0 +1,126 @@
+#include <string.h>
+#include "motion.h"
+#include "pyramid.h"
+#include "simd.h"
+
+#define WORD_ALIGN(x) (((x) + 3) & ~3u)
+
+uint32_t motion_tile_sad_ref(const uint8_t *a, const uint8_t *b, uint16_t stride)
+{
+    uint32_t sad = 0;
+    uint16_t x, y;
+    int d;
+
+    for (y = 0; y < MOTION_TILE_SIZE; y++, a += stride, b += stride) {
+        for (x = 0; x < MOTION_TILE_SIZE; x++) {
+            d = a[x] - b[x];
+            sad += d < 0 ? -d : d;
+        }
+    }
+
+    return sad;
+}
+
+uint32_t motion_tile_sad(const uint8_t *a, const uint8_t *b, uint16_t stride)
+{
+    uint32_t sad = 0;
+    uint16_t y;
+
+    for (y = 0; y < MOTION_TILE_SIZE; y++, a += stride, b += stride) {
+        sad = simd_usada8(simd_load32(a), simd_load32(b), sad);
+        sad = simd_usada8(simd_load32(a + 4), simd_load32(b + 4), sad);
+    }
+
+    return sad;
+}
+
+/* bg += (cur - bg) / 2^shift, rounded. Truncating halvings (UHADD8) would
+ * round every step down, so the background would never catch up with a
+ * frame slightly brighter than itself. */
+static void update_background(uint8_t *bg, const uint8_t *cur, uint32_t size, uint8_t shift)
+{
+    int32_t round = shift > 0 ? 1 << (shift - 1) : 0;
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        bg[i] += ((int32_t)cur[i] - bg[i] + round) >> shift;
+    }
+}
+
+uint32_t motion_arena_size(uint16_t width, uint16_t height)
+{
+    uint32_t plane = WORD_ALIGN((uint32_t)(width / 2) * (height / 2));
+
+    return 2 * plane + WORD_ALIGN(2 * (uint32_t)width);
+}
+
+bool motion_init(motion_t *motion, uint16_t width, uint16_t height,
+                 uint8_t *arena, uint32_t arena_size)
+{
+    uint32_t plane = WORD_ALIGN((uint32_t)(width / 2) * (height / 2));
+
+    if (motion_arena_size(width, height) > arena_size) {
+        return false;
+    }
+
+    motion->width = width / 2;
+    motion->height = height / 2;
+    motion->tiles_x = motion->width / MOTION_TILE_SIZE;
+    motion->tiles_y = motion->height / MOTION_TILE_SIZE;
+    if ((uint32_t)motion->tiles_x * motion->tiles_y > MOTION_MAX_TILES) {
+        return false;
+    }
+
+    motion->background = arena;
+    motion->current = arena + plane;
+    motion->scratch = arena + 2 * plane;
+    motion->has_background = false;
+    motion->threshold = MOTION_DEFAULT_THRESHOLD;
+    motion->learning_shift = MOTION_DEFAULT_LEARNING_SHIFT;
+    memset(motion->activity, 0, sizeof(motion->activity));
+    motion->active_tiles = 0;
+
+    return true;
+}
+
+void motion_decimate_gray(motion_t *motion, const uint8_t *src, uint16_t stride)
+{
+    pyramid_downsample(src, stride, 2 * motion->width, 2 * motion->height, motion->current);
+}
+
+void motion_decimate_yuv422(motion_t *motion, const uint8_t *frame)
+{
+    pyramid_downsample_yuv422(frame, 2 * motion->width, 2 * motion->height,
+                              motion->scratch, motion->current);
+}
+
+uint16_t motion_detect(motion_t *motion)
+{
+    uint32_t size = (uint32_t)motion->width * motion->height;
+    uint32_t limit = (uint32_t)motion->threshold * MOTION_TILE_SIZE * MOTION_TILE_SIZE;
+    uint32_t offset;
+    uint16_t tx, ty, tile = 0;
+
+    memset(motion->activity, 0, sizeof(motion->activity));
+    motion->active_tiles = 0;
+
+    if (!motion->has_background) {
+        memcpy(motion->background, motion->current, size);
+        motion->has_background = true;
+        return 0;
+    }
+
+    for (ty = 0; ty < motion->tiles_y; ty++) {
+        for (tx = 0; tx < motion->tiles_x; tx++, tile++) {
+            offset = (uint32_t)ty * MOTION_TILE_SIZE * motion->width + tx * MOTION_TILE_SIZE;
+            if (motion_tile_sad(&motion->current[offset], &motion->background[offset], motion->width) > limit) {
+                motion->activity[tile / 32] |= 1u << (tile % 32);
+                motion->active_tiles++;
+            }
+        }
+    }
+
+    update_background(motion->background, motion->current, size, motion->learning_shift);
+
+    return motion->active_tiles;
+}
@@ -0,0 +1,90 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Motion detection by differencing frames with a background model.
+ *
+ * Frames are decimated to half their width and height (see pyramid.h) and
+ * split in tiles of MOTION_TILE_SIZE x MOTION_TILE_SIZE decimated pixels,
+ * a partial last row or column of tiles is ignored. A tile is active when
+ * the mean absolute difference between the frame and the background is
+ * above a threshold, the activity map holding one bit per tile.
+ *
+ * The background then moves towards the frame by 1 / 2^learning_shift of
+ * the difference, rounded to the nearest so that it follows brighter and
+ * darker frames alike, up to 2^(learning_shift - 1) levels. */
+
+/** Width and height of a tile, in decimated pixels. */
+#define MOTION_TILE_SIZE 8
+
+/** Maximum number of tiles, a QVGA frame gives 20 x 15. */
+#define MOTION_MAX_TILES 512
+
+/** Settings given by motion_init(). */
+#define MOTION_DEFAULT_THRESHOLD 12
+#define MOTION_DEFAULT_LEARNING_SHIFT 3
+
+typedef struct {
+    uint8_t *background;
+    uint8_t *current;       /**< Latest decimated frame. */
+    uint8_t *scratch;       /**< Two full resolution luma rows. */
+    uint16_t width, height; /**< Decimated size. */
+    uint16_t tiles_x, tiles_y;
+    bool has_background;
+
+    uint8_t threshold;      /**< Mean absolute difference of an active tile. */
+    uint8_t learning_shift;
+
+    uint32_t activity[MOTION_MAX_TILES / 32];
+    uint16_t active_tiles;
+} motion_t;
+
+/** Returns the arena size needed for width x height frames. */
+uint32_t motion_arena_size(uint16_t width, uint16_t height);
+
+/** Sets up the detector for width x height frames.
+ *
+ * The first frame becomes the background.
+ *
+ * @note The arena must be word aligned.
+ *
+ * @returns false if the arena is too small or if the frame has more than
+ * MOTION_MAX_TILES tiles.
+ */
+bool motion_init(motion_t *motion, uint16_t width, uint16_t height,
+                 uint8_t *arena, uint32_t arena_size);
+
+/** Decimates a greyscale frame into motion->current. */
+void motion_decimate_gray(motion_t *motion, const uint8_t *src, uint16_t stride);
+
+/** Decimates the luma of a YUV422 frame (FORMAT_YCBYCR) into motion->current. */
+void motion_decimate_yuv422(motion_t *motion, const uint8_t *frame);
+
+/** Compares motion->current to the background, then updates the background.
+ *
+ * @returns The number of active tiles, always 0 for the first frame.
+ */
+uint16_t motion_detect(motion_t *motion);
+
+/** Returns whether a tile was active in the last frame, tiles being
+ * numbered row by row. */
+static inline bool motion_tile_active(const motion_t *motion, uint16_t tile)
+{
+    return (motion->activity[tile / 32] >> (tile % 32)) & 1;
+}
+
+/** Sum of absolute differences of two MOTION_TILE_SIZE square tiles. */
+uint32_t motion_tile_sad(const uint8_t *a, const uint8_t *b, uint16_t stride);
+uint32_t motion_tile_sad_ref(const uint8_t *a, const uint8_t *b, uint16_t stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_H */
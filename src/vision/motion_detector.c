@@ -0,0 +1,94 @@
+#include <string.h>
+#include <ch.h>
+#include <hal.h>
+#include "motion_detector.h"
+#include "main.h"
+#include "camera/frame_consumer.h"
+
+static motion_t motion;
+static CCM_BUFFER uint32_t arena[(MOTION_DETECTOR_MAX_WIDTH / 2 * MOTION_DETECTOR_MAX_HEIGHT / 2 * 2 +
+                                  2 * MOTION_DETECTOR_MAX_WIDTH) / 4];
+static uint16_t frame_width, frame_height;
+static uint8_t threshold = MOTION_DEFAULT_THRESHOLD;
+static motion_detector_result_t result;
+static motion_detector_callback detector_callback;
+
+/* Protects the settings and the result. */
+static MUTEX_DECL(detector_lock);
+
+static THD_FUNCTION(motion_detector_thd, p)
+{
+    frame_consumer_t consumer;
+    time_measurement_t tm;
+    frame_slot_t *frame;
+    uint16_t active;
+
+    (void)p;
+    chRegSetThreadName("motion-detector");
+
+    frame_consumer_init(&consumer, &frame_pool, &frame_ready_event);
+    chTMObjectInit(&tm);
+
+    while (true) {
+        frame = frame_consumer_wait(&consumer, FRAME_CONSUMER_YUV422,
+                                    MOTION_DETECTOR_MAX_WIDTH, MOTION_DETECTOR_MAX_HEIGHT);
+
+        chMtxLock(&detector_lock);
+        if (frame->header.width != frame_width || frame->header.height != frame_height) {
+            frame_width = frame->header.width;
+            frame_height = frame->header.height;
+            if (!motion_init(&motion, frame_width, frame_height, (uint8_t *)arena, sizeof(arena))) {
+                frame_width = frame_height = 0;
+            }
+        }
+        if (frame_width == 0) {
+            chMtxUnlock(&detector_lock);
+            frame_consumer_release(&consumer, frame);
+            continue;
+        }
+        motion.threshold = threshold;
+
+        chTMStartMeasurementX(&tm);
+        motion_decimate_yuv422(&motion, frame->buffer);
+        if (!frame_consumer_release(&consumer, frame)) {
+            chMtxUnlock(&detector_lock);
+            continue;
+        }
+        active = motion_detect(&motion);
+        chTMStopMeasurementX(&tm);
+
+        memcpy(result.activity, motion.activity, sizeof(result.activity));
+        result.tiles_x = motion.tiles_x;
+        result.tiles_y = motion.tiles_y;
+        result.active_tiles = active;
+        result.seq = consumer.last_seq;
+        result.cycles = tm.last;
+        chMtxUnlock(&detector_lock);
+
+        if (active > 0 && detector_callback != NULL) {
+            detector_callback();
+        }
+    }
+}
+
+void motion_detector_start(motion_detector_callback callback)
+{
+    static THD_WORKING_AREA(wa, 512);
+
+    detector_callback = callback;
+    chThdCreateStatic(wa, sizeof(wa), NORMALPRIO - 1, motion_detector_thd, NULL);
+}
+
+void motion_detector_set_threshold(uint8_t value)
+{
+    chMtxLock(&detector_lock);
+    threshold = value;
+    chMtxUnlock(&detector_lock);
+}
+
+void motion_detector_get(motion_detector_result_t *out)
+{
+    chMtxLock(&detector_lock);
+    *out = result;
+    chMtxUnlock(&detector_lock);
+}
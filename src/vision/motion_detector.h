@@ -0,0 +1,40 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <stdint.h>
+#include "motion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest frame the detector handles, larger frames are skipped. */
+#define MOTION_DETECTOR_MAX_WIDTH 160
+#define MOTION_DETECTOR_MAX_HEIGHT 120
+
+/** Called from the detector thread when a frame has active tiles. */
+typedef void (*motion_detector_callback)(void);
+
+typedef struct {
+    uint32_t activity[MOTION_MAX_TILES / 32];
+    uint16_t tiles_x, tiles_y;
+    uint16_t active_tiles;
+    uint32_t seq;       /**< Sequence number of the frame. */
+    uint32_t cycles;    /**< Processing time of the frame, in CPU cycles. */
+} motion_detector_result_t;
+
+/** Starts the thread comparing every published YUV422 frame to the
+ * background. The background is restarted whenever the frame size changes. */
+void motion_detector_start(motion_detector_callback callback);
+
+/** Sets the mean absolute difference above which a tile is active. */
+void motion_detector_set_threshold(uint8_t threshold);
+
+/** Copies the activity map of the latest processed frame. */
+void motion_detector_get(motion_detector_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_DETECTOR_H */
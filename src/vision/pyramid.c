@@ -0,0 +1,115 @@
+#include <stddef.h>
+#include "pyramid.h"
+#include "yuv422.h"
+#include "simd.h"
+
+#define WORD_ALIGN(x) (((x) + 3) & ~3u)
+
+static inline uint8_t halve(uint8_t a, uint8_t b)
+{
+    return (a + b) >> 1;
+}
+
+static void downsample_row_ref(const uint8_t *row0, const uint8_t *row1, uint16_t out_width, uint8_t *dst)
+{
+    uint16_t x;
+
+    for (x = 0; x < out_width; x++) {
+        dst[x] = halve(halve(row0[2 * x], row1[2 * x]), halve(row0[2 * x + 1], row1[2 * x + 1]));
+    }
+}
+
+void pyramid_downsample_ref(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height, uint8_t *dst)
+{
+    uint16_t y, out_width = width / 2;
+
+    for (y = 0; y < height / 2; y++) {
+        downsample_row_ref(&src[(uint32_t)2 * y * stride], &src[(uint32_t)(2 * y + 1) * stride],
+                           out_width, &dst[(uint32_t)y * out_width]);
+    }
+}
+
+void pyramid_downsample(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height, uint8_t *dst)
+{
+    uint16_t x, y, out_width = width / 2;
+    const uint8_t *row0, *row1;
+    uint8_t *out;
+    uint32_t v0, v1;
+
+    for (y = 0; y < height / 2; y++) {
+        row0 = &src[(uint32_t)2 * y * stride];
+        row1 = &src[(uint32_t)(2 * y + 1) * stride];
+        out = &dst[(uint32_t)y * out_width];
+
+        for (x = 0; x + 4 <= out_width; x += 4) {
+            /* Vertical averages of 8 columns, then of neighbouring bytes,
+             * which leaves the results in bytes 0 and 2. */
+            v0 = simd_uhadd8(simd_load32(&row0[2 * x]), simd_load32(&row1[2 * x]));
+            v1 = simd_uhadd8(simd_load32(&row0[2 * x + 4]), simd_load32(&row1[2 * x + 4]));
+            v0 = simd_uxtb16(simd_uhadd8(v0, v0 >> 8));
+            v1 = simd_uxtb16(simd_uhadd8(v1, v1 >> 8));
+            simd_store32(&out[x], simd_pack_bytes(v0, v1));
+        }
+
+        downsample_row_ref(&row0[2 * x], &row1[2 * x], out_width - x, &out[x]);
+    }
+}
+
+void pyramid_downsample_yuv422(const uint8_t *frame, uint16_t width, uint16_t height,
+                               uint8_t *scratch, uint8_t *dst)
+{
+    uint16_t y, out_width = width / 2;
+
+    for (y = 0; y < height / 2; y++) {
+        yuv422_to_gray(&frame[(uint32_t)4 * y * width], scratch, 2 * width);
+        pyramid_downsample(scratch, width, width, 2, &dst[(uint32_t)y * out_width]);
+    }
+}
+
+uint32_t pyramid_arena_size(uint16_t width, uint16_t height, uint8_t levels)
+{
+    uint32_t size = 0;
+    uint8_t i;
+
+    for (i = 1; i < levels; i++) {
+        width /= 2;
+        height /= 2;
+        size += WORD_ALIGN((uint32_t)width * height);
+    }
+
+    return size;
+}
+
+bool pyramid_build(pyramid_t *pyramid, const uint8_t *src, uint16_t stride,
+                   uint16_t width, uint16_t height, uint8_t levels,
+                   uint8_t *arena, uint32_t arena_size)
+{
+    pyramid_level_t *prev, *level;
+    uint8_t i;
+
+    if (levels == 0 || levels > PYRAMID_MAX_LEVELS ||
+        pyramid_arena_size(width, height, levels) > arena_size) {
+        return false;
+    }
+
+    pyramid->level[0].data = src;
+    pyramid->level[0].width = width;
+    pyramid->level[0].height = height;
+    pyramid->level[0].stride = stride;
+
+    for (i = 1; i < levels; i++) {
+        prev = &pyramid->level[i - 1];
+        level = &pyramid->level[i];
+
+        level->width = prev->width / 2;
+        level->height = prev->height / 2;
+        level->stride = level->width;
+        pyramid_downsample(prev->data, prev->stride, prev->width, prev->height, arena);
+        level->data = arena;
+        arena += WORD_ALIGN((uint32_t)level->width * level->height);
+    }
+
+    pyramid->num_levels = levels;
+
+    return true;
+}
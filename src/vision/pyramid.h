@@ -0,0 +1,69 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Multi-resolution pyramid of a greyscale image, so that coarse-to-fine
+ * algorithms can work at lower resolutions without reconfiguring the
+ * sensor (which costs many I2C writes and at least one frame).
+ *
+ * Every level is half the width and height of the previous one, each pixel
+ * being the average of a 2x2 block. The averages are computed as two
+ * truncating halvings (vertical then horizontal) as done by UHADD8, so they
+ * may be up to 3/4 below the exact mean. An odd last row or column is
+ * dropped. */
+
+/** Number of levels including the source image: 1/1, 1/2, 1/4 and 1/8. */
+#define PYRAMID_MAX_LEVELS 4
+
+typedef struct {
+    const uint8_t *data;
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;    /**< Distance between rows, in bytes. */
+} pyramid_level_t;
+
+typedef struct {
+    pyramid_level_t level[PYRAMID_MAX_LEVELS];
+    uint8_t num_levels;
+} pyramid_t;
+
+/** Halves an image, dst receives (width / 2) x (height / 2) pixels with a
+ * stride of width / 2. */
+void pyramid_downsample(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height, uint8_t *dst);
+void pyramid_downsample_ref(const uint8_t *src, uint16_t stride, uint16_t width, uint16_t height, uint8_t *dst);
+
+/** Halves the luma of a YUV422 frame (FORMAT_YCBYCR), dst receives
+ * (width / 2) x (height / 2) pixels.
+ *
+ * Rows are converted two by two into scratch, which must hold 2 x width
+ * bytes, so that the full resolution luma is never stored.
+ */
+void pyramid_downsample_yuv422(const uint8_t *frame, uint16_t width, uint16_t height,
+                               uint8_t *scratch, uint8_t *dst);
+
+/** Returns the arena size needed for a pyramid of levels levels (including
+ * the source) of a width x height image. */
+uint32_t pyramid_arena_size(uint16_t width, uint16_t height, uint8_t levels);
+
+/** Builds a pyramid of levels levels from an image.
+ *
+ * Level 0 refers to the source image, which is not copied; the other
+ * levels are written to the arena, each starting on a word boundary.
+ *
+ * @returns false if levels is out of range or if the arena is too small.
+ */
+bool pyramid_build(pyramid_t *pyramid, const uint8_t *src, uint16_t stride,
+                   uint16_t width, uint16_t height, uint8_t levels,
+                   uint8_t *arena, uint32_t arena_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PYRAMID_H */
@@ -0,0 +1,276 @@
+#include <string.h>
+#include "rle_cc.h"
+
+#define NO_REGION RLE_CC_FREE
+
+/** Sum of the squares of 0 .. k - 1. */
+static inline uint64_t sum_squares_below(uint32_t k)
+{
+    return (uint64_t)k * (k - 1) * (2 * k - 1) / 6;
+}
+
+static uint16_t find_root(rle_cc_region_t *regions, uint16_t i)
+{
+    uint16_t root = i, next;
+
+    while (regions[root].parent != root) {
+        root = regions[root].parent;
+    }
+    /* Path compression, so that later lookups are short. */
+    while (regions[i].parent != root) {
+        next = regions[i].parent;
+        regions[i].parent = root;
+        i = next;
+    }
+
+    return root;
+}
+
+static uint16_t merge(rle_cc_region_t *regions, uint16_t a, uint16_t b)
+{
+    rle_cc_stats_t *root, *child;
+
+    a = find_root(regions, a);
+    b = find_root(regions, b);
+    if (a == b) {
+        return a;
+    }
+    if (b < a) {
+        uint16_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    root = &regions[a].stats;
+    child = &regions[b].stats;
+    root->m00 += child->m00;
+    root->m10 += child->m10;
+    root->m01 += child->m01;
+    root->m20 += child->m20;
+    root->m02 += child->m02;
+    root->m11 += child->m11;
+    if (child->x_min < root->x_min) {
+        root->x_min = child->x_min;
+    }
+    if (child->x_max > root->x_max) {
+        root->x_max = child->x_max;
+    }
+    if (child->y_min < root->y_min) {
+        root->y_min = child->y_min;
+    }
+    if (child->y_max > root->y_max) {
+        root->y_max = child->y_max;
+    }
+    if (regions[b].last_row > regions[a].last_row) {
+        regions[a].last_row = regions[b].last_row;
+    }
+    regions[b].parent = a;
+
+    return a;
+}
+
+static uint16_t new_region(rle_cc_t *cc, uint16_t x0, uint8_t cls)
+{
+    rle_cc_region_t *region;
+    uint16_t i;
+
+    if (cc->num_free == 0) {
+        return NO_REGION;
+    }
+
+    i = cc->free_list[--cc->num_free];
+    region = &cc->regions[i];
+    memset(&region->stats, 0, sizeof(region->stats));
+    region->stats.cls = cls;
+    region->stats.x_min = x0;
+    region->stats.x_max = x0;
+    region->stats.y_min = cc->row;
+    region->parent = i;
+
+    return i;
+}
+
+static void free_region(rle_cc_t *cc, uint16_t i)
+{
+    cc->regions[i].parent = RLE_CC_FREE;
+    cc->free_list[cc->num_free++] = i;
+}
+
+static void add_stats(rle_cc_stats_t *stats, uint16_t x0, uint16_t x1, uint16_t y)
+{
+    uint32_t n = x1 - x0 + 1;
+    uint32_t sum_x = (uint32_t)(x0 + x1) * n / 2;
+
+    stats->m00 += n;
+    stats->m10 += sum_x;
+    stats->m01 += (uint32_t)y * n;
+    stats->m20 += sum_squares_below(x1 + 1) - sum_squares_below(x0);
+    stats->m02 += (uint64_t)y * y * n;
+    stats->m11 += (uint64_t)y * sum_x;
+    if (x0 < stats->x_min) {
+        stats->x_min = x0;
+    }
+    if (x1 > stats->x_max) {
+        stats->x_max = x1;
+    }
+    stats->y_max = y;
+}
+
+void rle_cc_reset(rle_cc_t *cc)
+{
+    uint16_t i;
+
+    cc->num_free = 0;
+    for (i = cc->max_regions; i > 0; i--) {
+        free_region(cc, i - 1);
+    }
+    cc->num_prev = 0;
+    cc->num_cur = 0;
+    cc->scan = 0;
+    cc->row = 0;
+    cc->overflow = false;
+}
+
+bool rle_cc_init(rle_cc_t *cc, void *arena, size_t arena_size,
+                 uint16_t max_runs, uint16_t max_regions,
+                 rle_cc_callback callback, void *arg)
+{
+    uint8_t *p = arena;
+
+    if (max_regions == 0 || max_regions >= RLE_CC_FREE ||
+        arena_size < RLE_CC_ARENA_SIZE(max_runs, max_regions)) {
+        return false;
+    }
+
+    /* Largest alignment first. */
+    cc->regions = (rle_cc_region_t *)p;
+    p += max_regions * sizeof(rle_cc_region_t);
+    cc->prev = (rle_cc_run_t *)p;
+    p += max_runs * sizeof(rle_cc_run_t);
+    cc->cur = (rle_cc_run_t *)p;
+    p += max_runs * sizeof(rle_cc_run_t);
+    cc->free_list = (uint16_t *)p;
+
+    cc->max_regions = max_regions;
+    cc->max_runs = max_runs;
+    cc->callback = callback;
+    cc->arg = arg;
+    rle_cc_reset(cc);
+
+    return true;
+}
+
+bool rle_cc_add_run(rle_cc_t *cc, uint16_t x0, uint16_t x1, uint8_t cls)
+{
+    const rle_cc_run_t *prev;
+    rle_cc_run_t *run;
+    uint16_t region = NO_REGION, p;
+
+    if (cc->num_cur >= cc->max_runs) {
+        cc->overflow = true;
+        return false;
+    }
+
+    /* Runs are sorted, previous runs ending before this one cannot touch
+     * the next ones either. */
+    while (cc->scan < cc->num_prev && cc->prev[cc->scan].x1 < x0) {
+        cc->scan++;
+    }
+    for (p = cc->scan; p < cc->num_prev && cc->prev[p].x0 <= x1; p++) {
+        prev = &cc->prev[p];
+        if (prev->cls != cls || prev->region == NO_REGION) {
+            continue;
+        }
+        if (region == NO_REGION) {
+            region = find_root(cc->regions, prev->region);
+        } else {
+            region = merge(cc->regions, region, prev->region);
+        }
+    }
+
+    if (region == NO_REGION) {
+        region = new_region(cc, x0, cls);
+        if (region == NO_REGION) {
+            cc->overflow = true;
+            return false;
+        }
+    }
+
+    add_stats(&cc->regions[region].stats, x0, x1, cc->row);
+    cc->regions[region].last_row = cc->row;
+
+    run = &cc->cur[cc->num_cur++];
+    run->x0 = x0;
+    run->x1 = x1;
+    run->region = region;
+    run->cls = cls;
+
+    return true;
+}
+
+void rle_cc_end_row(rle_cc_t *cc)
+{
+    rle_cc_region_t *regions = cc->regions;
+    rle_cc_run_t *swap;
+    uint16_t i;
+
+    /* Runs may point to regions merged later in the row. */
+    for (i = 0; i < cc->num_cur; i++) {
+        cc->cur[i].region = find_root(regions, cc->cur[i].region);
+    }
+
+    /* Once every region points directly to its root, merged regions are
+     * not referenced anymore and can be reused. Roots which did not grow
+     * in this row are complete. */
+    for (i = 0; i < cc->max_regions; i++) {
+        if (regions[i].parent != RLE_CC_FREE) {
+            find_root(regions, i);
+        }
+    }
+    for (i = 0; i < cc->max_regions; i++) {
+        if (regions[i].parent == RLE_CC_FREE) {
+            continue;
+        }
+        if (regions[i].parent != i) {
+            free_region(cc, i);
+        } else if (regions[i].last_row != cc->row) {
+            if (cc->callback != NULL) {
+                cc->callback(cc->arg, &regions[i].stats);
+            }
+            free_region(cc, i);
+        }
+    }
+
+    swap = cc->prev;
+    cc->prev = cc->cur;
+    cc->cur = swap;
+    cc->num_prev = cc->num_cur;
+    cc->num_cur = 0;
+    cc->scan = 0;
+    cc->row++;
+}
+
+bool rle_cc_end_frame(rle_cc_t *cc)
+{
+    bool complete = !cc->overflow;
+    uint16_t i;
+
+    if (cc->num_cur > 0) {
+        rle_cc_end_row(cc);
+    }
+
+    for (i = 0; i < cc->max_regions; i++) {
+        if (cc->regions[i].parent != RLE_CC_FREE) {
+            find_root(cc->regions, i);
+        }
+    }
+    for (i = 0; i < cc->max_regions; i++) {
+        if (cc->regions[i].parent == i && cc->callback != NULL) {
+            cc->callback(cc->arg, &cc->regions[i].stats);
+        }
+    }
+
+    rle_cc_reset(cc);
+
+    return complete;
+}
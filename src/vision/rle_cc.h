@@ -0,0 +1,114 @@
+#ifndef RLE_CC_H
+#define RLE_CC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Connected components labelling on run length encoded rows.
+ *
+ * Rows are fed one after the other as lists of runs. Runs of the same
+ * class touching a run of the previous row (4-connectivity) belong to the
+ * same region, regions are merged with a union-find.
+ *
+ * Only the runs of the previous and current rows are kept, along with the
+ * regions still touching the current row. A region is handed to the
+ * callback as soon as a row does not extend it anymore, so the memory
+ * scales with the number of runs per row and of open regions instead of
+ * with the image size. */
+
+typedef struct {
+    uint8_t cls;
+    uint32_t m00;               /**< Area, in pixels. */
+    uint32_t m10, m01;          /**< Sums of x and of y. */
+    uint64_t m20, m02, m11;     /**< Sums of x^2, y^2 and x*y. */
+    uint16_t x_min, y_min;
+    uint16_t x_max, y_max;
+} rle_cc_stats_t;
+
+/** Marks unused entries of the region table. */
+#define RLE_CC_FREE 0xFFFF
+
+typedef struct {
+    rle_cc_stats_t stats;
+    uint16_t parent;            /**< Union-find link, RLE_CC_FREE if unused. */
+    uint16_t last_row;          /**< Last row with a run in this region. */
+} rle_cc_region_t;
+
+typedef struct {
+    uint16_t x0, x1;            /**< First and last pixel of the run. */
+    uint16_t region;
+    uint8_t cls;
+} rle_cc_run_t;
+
+/** Called with every completed region, the stats are only valid during
+ * the call. */
+typedef void (*rle_cc_callback)(void *arg, const rle_cc_stats_t *region);
+
+typedef struct {
+    rle_cc_region_t *regions;
+    uint16_t *free_list;
+    uint16_t max_regions;
+    uint16_t num_free;
+
+    rle_cc_run_t *prev, *cur;
+    uint16_t max_runs;
+    uint16_t num_prev, num_cur;
+    uint16_t scan;              /**< First previous run that may touch the next run. */
+
+    uint16_t row;
+    bool overflow;              /**< Runs were dropped since the frame started. */
+
+    rle_cc_callback callback;
+    void *arg;
+} rle_cc_t;
+
+/** Arena size needed for max_runs runs per row and max_regions open regions. */
+#define RLE_CC_ARENA_SIZE(max_runs, max_regions) \
+    ((max_regions) * (sizeof(rle_cc_region_t) + sizeof(uint16_t)) + \
+     2 * (max_runs) * sizeof(rle_cc_run_t))
+
+/** Splits the arena and starts the first frame.
+ *
+ * @note The arena must be aligned on 8 bytes.
+ *
+ * @returns false if the arena is smaller than RLE_CC_ARENA_SIZE() or if
+ * max_regions is out of range.
+ */
+bool rle_cc_init(rle_cc_t *cc, void *arena, size_t arena_size,
+                 uint16_t max_runs, uint16_t max_regions,
+                 rle_cc_callback callback, void *arg);
+
+/** Drops the current frame without reporting its regions and starts a new
+ * one at row 0. */
+void rle_cc_reset(rle_cc_t *cc);
+
+/** Adds a run to the current row, runs must be sorted and must not overlap.
+ *
+ * @returns false if the run was dropped because the row or the region
+ * table is full.
+ */
+bool rle_cc_add_run(rle_cc_t *cc, uint16_t x0, uint16_t x1, uint8_t cls);
+
+/** Closes the current row, must also be called for rows without runs.
+ *
+ * Regions which did not grow in this row are reported.
+ */
+void rle_cc_end_row(rle_cc_t *cc);
+
+/** Reports all the remaining regions and starts a new frame at row 0.
+ *
+ * @returns false if runs were dropped during the frame, some regions are
+ * then missing or split.
+ */
+bool rle_cc_end_frame(rle_cc_t *cc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RLE_CC_H */
@@ -0,0 +1,153 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Thin wrappers around the Cortex-M4 DSP instructions used by the vision
+ * kernels. On the target they map to the CMSIS intrinsics, on the host they
+ * are emulated so that the very same kernels can be unit tested. */
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+
+/** Zero extends bytes 0 and 2 into two halfwords. */
+static inline uint32_t simd_uxtb16(uint32_t x)
+{
+    return x & 0x00FF00FFu;
+}
+
+/** Bottom halfword of a, top halfword of (b << shift). */
+static inline uint32_t simd_pkhbt(uint32_t a, uint32_t b, unsigned shift)
+{
+    return (a & 0x0000FFFFu) | ((b << shift) & 0xFFFF0000u);
+}
+
+/** Top halfword of a, bottom halfword of (b >> shift). */
+static inline uint32_t simd_pkhtb(uint32_t a, uint32_t b, unsigned shift)
+{
+    return (a & 0xFFFF0000u) | ((b >> shift) & 0x0000FFFFu);
+}
+
+/** Rotates right, shift must be between 1 and 31. */
+static inline uint32_t simd_ror(uint32_t x, unsigned shift)
+{
+    return (x >> shift) | (x << (32 - shift));
+}
+
+/** Signed halfword additions, wrapping. */
+static inline uint32_t simd_sadd16(uint32_t a, uint32_t b)
+{
+    uint16_t lo = (uint16_t)(a + b);
+    uint16_t hi = (uint16_t)((a >> 16) + (b >> 16));
+    return lo | ((uint32_t)hi << 16);
+}
+
+/** Signed halfword subtractions, wrapping. */
+static inline uint32_t simd_ssub16(uint32_t a, uint32_t b)
+{
+    uint16_t lo = (uint16_t)(a - b);
+    uint16_t hi = (uint16_t)((a >> 16) - (b >> 16));
+    return lo | ((uint32_t)hi << 16);
+}
+
+/** Unsigned byte wise halving additions, (a + b) >> 1 for each byte. */
+static inline uint32_t simd_uhadd8(uint32_t a, uint32_t b)
+{
+    /* Common bits plus half of the differing ones, no carry between bytes. */
+    return (a & b) + (((a ^ b) >> 1) & 0x7F7F7F7Fu);
+}
+
+/** Sum of the absolute differences of the four bytes, added to acc. */
+static inline uint32_t simd_usada8(uint32_t a, uint32_t b, uint32_t acc)
+{
+    int i, d;
+
+    for (i = 0; i < 32; i += 8) {
+        d = (int)((a >> i) & 0xFF) - (int)((b >> i) & 0xFF);
+        acc += d < 0 ? -d : d;
+    }
+    return acc;
+}
+
+/** Saturates a signed value to an unsigned range of bits bits. */
+static inline uint32_t simd_usat(int32_t x, unsigned bits)
+{
+    int32_t max = (1 << bits) - 1;
+    return x < 0 ? 0 : (x > max ? max : x);
+}
+
+/** Saturates both signed halfwords to an unsigned range of bits bits. */
+static inline uint32_t simd_usat16(uint32_t x, unsigned bits)
+{
+    return simd_usat((int16_t)x, bits) | (simd_usat((int16_t)(x >> 16), bits) << 16);
+}
+
+/** Dual signed halfword multiply, products added to acc. */
+static inline int32_t simd_smlad(uint32_t a, uint32_t b, int32_t acc)
+{
+    return acc + (int16_t)a * (int16_t)b + (int16_t)(a >> 16) * (int16_t)(b >> 16);
+}
+
+/** Dual signed halfword multiply, products added together. */
+static inline int32_t simd_smuad(uint32_t a, uint32_t b)
+{
+    return simd_smlad(a, b, 0);
+}
+
+#else
+
+#include <ch.h>
+
+#define simd_uxtb16(x) __UXTB16(x)
+#define simd_pkhbt(a, b, shift) __PKHBT(a, b, shift)
+#define simd_pkhtb(a, b, shift) __PKHTB(a, b, shift)
+#define simd_ror(x, shift) __ROR(x, shift)
+#define simd_uhadd8(a, b) __UHADD8(a, b)
+#define simd_usada8(a, b, acc) __USADA8(a, b, acc)
+#define simd_sadd16(a, b) __SADD16(a, b)
+#define simd_ssub16(a, b) __SSUB16(a, b)
+#define simd_usat(x, bits) __USAT(x, bits)
+#define simd_usat16(x, bits) __USAT16(x, bits)
+#define simd_smlad(a, b, acc) ((int32_t)__SMLAD(a, b, acc))
+#define simd_smuad(a, b) ((int32_t)__SMUAD(a, b))
+
+#endif
+
+/** 32 bits load and store, compiled to a single LDR / STR.
+ *
+ * The Cortex-M4 supports unaligned word accesses, going through memcpy keeps
+ * the compiler from assuming an alignment or aliasing it cannot rely on. */
+static inline uint32_t simd_load32(const uint8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline void simd_store32(uint8_t *p, uint32_t x)
+{
+    memcpy(p, &x, sizeof(x));
+}
+
+/** Packs two signed 16 bits values as halfwords, lo in the bottom one. */
+#define SIMD_PACK16(lo, hi) (((uint32_t)(uint16_t)(lo)) | ((uint32_t)(uint16_t)(hi) << 16))
+
+/** Packs the low bytes of four halfwords into a word.
+ *
+ * Given lo = [x0, x1] and hi = [x2, x3] as halfwords holding values below
+ * 256, returns the bytes [x0, x1, x2, x3].
+ */
+static inline uint32_t simd_pack_bytes(uint32_t lo, uint32_t hi)
+{
+    return simd_pkhbt(lo, hi, 16) | (simd_pkhtb(hi, lo, 16) << 8);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMD_H */
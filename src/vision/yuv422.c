@@ -0,0 +1,81 @@
+#include <stddef.h>
+#include "yuv422.h"
+#include "simd.h"
+
+void yuv422_to_gray_ref(const uint8_t *src, uint8_t *y, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i < pixels; i++) {
+        y[i] = src[2 * i];
+    }
+}
+
+void yuv422_to_gray(const uint8_t *src, uint8_t *y, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i + 4 <= pixels; i += 4) {
+        /* Y0 Cb Y1 Cr | Y2 Cb Y3 Cr -> [Y0, Y1] [Y2, Y3] -> Y0 Y1 Y2 Y3 */
+        uint32_t lo = simd_uxtb16(simd_load32(&src[2 * i]));
+        uint32_t hi = simd_uxtb16(simd_load32(&src[2 * i + 4]));
+        simd_store32(&y[i], simd_pack_bytes(lo, hi));
+    }
+
+    yuv422_to_gray_ref(&src[2 * i], &y[i], pixels - i);
+}
+
+void yuv422_to_planar_ref(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t pixels)
+{
+    uint32_t i;
+
+    for (i = 0; i < pixels / 2; i++) {
+        y[2 * i] = src[4 * i];
+        y[2 * i + 1] = src[4 * i + 2];
+        if (u != NULL) {
+            u[i] = src[4 * i + 1];
+        }
+        if (v != NULL) {
+            v[i] = src[4 * i + 3];
+        }
+    }
+}
+
+void yuv422_to_planar(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t pixels)
+{
+    uint32_t i;
+
+    if (u == NULL && v == NULL) {
+        yuv422_to_gray(src, y, pixels);
+        return;
+    }
+
+    for (i = 0; i + 8 <= pixels; i += 8) {
+        const uint8_t *p = &src[2 * i];
+        uint32_t w0 = simd_load32(p);
+        uint32_t w1 = simd_load32(p + 4);
+        uint32_t w2 = simd_load32(p + 8);
+        uint32_t w3 = simd_load32(p + 12);
+
+        simd_store32(&y[i], simd_pack_bytes(simd_uxtb16(w0), simd_uxtb16(w1)));
+        simd_store32(&y[i + 4], simd_pack_bytes(simd_uxtb16(w2), simd_uxtb16(w3)));
+
+        /* Rotating by one byte brings the chroma in place: [Cb, Cr] */
+        w0 = simd_uxtb16(simd_ror(w0, 8));
+        w1 = simd_uxtb16(simd_ror(w1, 8));
+        w2 = simd_uxtb16(simd_ror(w2, 8));
+        w3 = simd_uxtb16(simd_ror(w3, 8));
+
+        if (u != NULL) {
+            simd_store32(&u[i / 2], simd_pack_bytes(simd_pkhbt(w0, w1, 16), simd_pkhbt(w2, w3, 16)));
+        }
+        if (v != NULL) {
+            simd_store32(&v[i / 2], simd_pack_bytes(simd_pkhtb(w1, w0, 16), simd_pkhtb(w3, w2, 16)));
+        }
+    }
+
+    yuv422_to_planar_ref(&src[2 * i], &y[i],
+                         (u != NULL) ? &u[i / 2] : NULL,
+                         (v != NULL) ? &v[i / 2] : NULL,
+                         pixels - i);
+}
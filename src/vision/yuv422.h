@@ -0,0 +1,34 @@
+#ifndef YUV422_H
+#define YUV422_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deinterleaving of YUV422 frames as output by the sensor in FORMAT_YCBYCR,
+ * i.e. the bytes Y0 Cb Y1 Cr for every pair of pixels.
+ *
+ * Every kernel has a portable reference version (suffix _ref) and a version
+ * using the Cortex-M4 DSP instructions, which must give the same output. The
+ * fast versions process 4 (gray) or 8 (planar) pixels per iteration with 32
+ * bits accesses and use the reference code for the remaining pixels. */
+
+/** Extracts the luma of pixels pixels from a YUV422 buffer. */
+void yuv422_to_gray(const uint8_t *src, uint8_t *y, uint32_t pixels);
+void yuv422_to_gray_ref(const uint8_t *src, uint8_t *y, uint32_t pixels);
+
+/** Splits a YUV422 buffer in planes.
+ *
+ * y receives pixels bytes, u and v pixels / 2 bytes each. Chroma planes
+ * may be NULL if they are not needed. pixels must be even.
+ */
+void yuv422_to_planar(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t pixels);
+void yuv422_to_planar_ref(const uint8_t *src, uint8_t *y, uint8_t *u, uint8_t *v, uint32_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YUV422_H */
@@ -0,0 +1,104 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "camera/auto_exposure.h"
+#include "vision/color.h"
+
+#define PIXELS 64
+
+TEST_GROUP(AutoExposureTestGroup)
+{
+    ae_t ae;
+    awb_t awb;
+    histogram_t hist;
+
+    void setup()
+    {
+        ae_init(&ae);
+        awb_init(&awb);
+    }
+
+    /* A grey scene seen by a sensor whose channels respond with the given
+     * factors, in % of green, scaled by the exposure. */
+    void capture(uint32_t radiance, int red, int blue)
+    {
+        uint8_t rgb[3 * PIXELS], yuv[2 * PIXELS];
+        uint32_t level[3];
+        int i, c;
+
+        level[0] = (uint64_t)radiance * ae.exposure * red * awb.gain_r / (100 * AWB_UNITY_GAIN * AE_ONE_LINE);
+        level[1] = (uint64_t)radiance * ae.exposure * awb.gain_g / (AWB_UNITY_GAIN * AE_ONE_LINE);
+        level[2] = (uint64_t)radiance * ae.exposure * blue * awb.gain_b / (100 * AWB_UNITY_GAIN * AE_ONE_LINE);
+        for (i = 0; i < PIXELS; i++) {
+            for (c = 0; c < 3; c++) {
+                rgb[3 * i + c] = level[c] > 255 ? 255 : level[c];
+            }
+        }
+        rgb888_to_yuv422(rgb, yuv, PIXELS);
+
+        histogram_reset(&hist);
+        histogram_add_yuv422(&hist, yuv, PIXELS, 0, 1, NULL);
+    }
+
+    void converge(uint32_t radiance, int red, int blue)
+    {
+        int i;
+
+        for (i = 0; i < 30; i++) {
+            capture(radiance, red, blue);
+            ae_update(&ae, &hist);
+            awb_update(&awb, &hist);
+        }
+        capture(radiance, red, blue);
+    }
+};
+
+TEST(AutoExposureTestGroup, ReachesTheTarget)
+{
+    /* Dark and bright scenes, the latter saturated at first. */
+    const uint32_t scenes[] = {1, 10, 100};
+
+    for (unsigned i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++) {
+        ae.min_exposure = 1;
+        awb.gain_r = awb.gain_b = AWB_UNITY_GAIN;
+        converge(scenes[i], 100, 100);
+        CHECK(histogram_mean(&hist) + ae.tolerance >= ae.target);
+        CHECK(histogram_mean(&hist) <= ae.target + ae.tolerance);
+        CHECK_FALSE(ae_update(&ae, &hist));
+    }
+}
+
+TEST(AutoExposureTestGroup, ExposureIsBounded)
+{
+    ae.max_exposure = 200 * AE_ONE_LINE;
+    converge(0, 100, 100);
+    CHECK_EQUAL(200 * AE_ONE_LINE, ae.exposure);
+
+    converge(10000, 100, 100);
+    CHECK_EQUAL(ae.min_exposure, ae.exposure);
+}
+
+TEST(AutoExposureTestGroup, WhiteBalanceNeutralisesTheCast)
+{
+    uint8_t u, v;
+
+    /* Reddish and bluish light. */
+    converge(5, 140, 70);
+    histogram_mean_chroma(&hist, &u, &v);
+    CHECK(v >= 128 - 2 * awb.tolerance && v <= 128 + 2 * awb.tolerance);
+    CHECK(u >= 128 - 2 * awb.tolerance && u <= 128 + 2 * awb.tolerance);
+    CHECK(awb.gain_r < AWB_UNITY_GAIN);
+    CHECK(awb.gain_b > AWB_UNITY_GAIN);
+    CHECK_EQUAL(AWB_UNITY_GAIN, awb.gain_g);
+
+    converge(5, 70, 140);
+    CHECK(awb.gain_r > AWB_UNITY_GAIN);
+    CHECK(awb.gain_b < AWB_UNITY_GAIN);
+}
+
+TEST(AutoExposureTestGroup, DarkFramesKeepTheGains)
+{
+    ae.max_exposure = ae.exposure;
+    capture(0, 140, 70);
+    CHECK_FALSE(awb_update(&awb, &hist));
+    CHECK_EQUAL(0x5E, awb.gain_r);
+}
@@ -0,0 +1,161 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/bayer.h"
+
+#define W 8
+#define H 6
+
+/* Builds a raw frame from per channel images, keeping for every pixel the
+ * channel the pattern puts there. */
+static void mosaic(const uint8_t rgb[H][W][3], bayer_pattern_t pattern, uint8_t raw[H][W])
+{
+    int x, y, pos;
+
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            pos = (x & 1) | ((y & 1) << 1);
+            if (pos == pattern) {
+                raw[y][x] = rgb[y][x][0];
+            } else if (pos == (pattern ^ 3)) {
+                raw[y][x] = rgb[y][x][2];
+            } else {
+                raw[y][x] = rgb[y][x][1];
+            }
+        }
+    }
+}
+
+static uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+TEST_GROUP(BayerTestGroup)
+{
+    uint8_t rgb[H][W][3];
+    uint8_t raw[H][W];
+    uint16_t out[H * W];
+    uint8_t gray[H * W];
+
+    void fill(uint8_t r, uint8_t g, uint8_t b)
+    {
+        int x, y;
+
+        for (y = 0; y < H; y++) {
+            for (x = 0; x < W; x++) {
+                rgb[y][x][0] = r;
+                rgb[y][x][1] = g;
+                rgb[y][x][2] = b;
+            }
+        }
+    }
+};
+
+TEST(BayerTestGroup, PatternShiftsWithOffset)
+{
+    CHECK_EQUAL(BAYER_RGGB, bayer_pattern_at(BAYER_RGGB, 2, 4));
+    CHECK_EQUAL(BAYER_GRBG, bayer_pattern_at(BAYER_RGGB, 1, 0));
+    CHECK_EQUAL(BAYER_GBRG, bayer_pattern_at(BAYER_RGGB, 0, 1));
+    CHECK_EQUAL(BAYER_BGGR, bayer_pattern_at(BAYER_RGGB, 1, 1));
+    CHECK_EQUAL(BAYER_RGGB, bayer_pattern_at(BAYER_BGGR, 3, 3));
+}
+
+TEST(BayerTestGroup, UniformColorIsRestoredEverywhere)
+{
+    int p, i;
+
+    fill(200, 100, 40);
+    for (p = BAYER_RGGB; p <= BAYER_BGGR; p++) {
+        mosaic(rgb, (bayer_pattern_t)p, raw);
+        bayer_demosaic(&raw[0][0], W, W, H, (bayer_pattern_t)p, BAYER_OUT_RGB565, out);
+        for (i = 0; i < W * H; i++) {
+            CHECK_EQUAL(rgb565(200, 100, 40), out[i]);
+        }
+    }
+}
+
+TEST(BayerTestGroup, LinearRampsAreInterpolated)
+{
+    int x, y;
+
+    /* Every channel is linear along x, so the interpolation is exact
+     * (up to the rounding) away from the edges. */
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            rgb[y][x][0] = 10 * x;
+            rgb[y][x][1] = 20 + 8 * x;
+            rgb[y][x][2] = 200 - 16 * x;
+        }
+    }
+    mosaic(rgb, BAYER_GRBG, raw);
+    bayer_demosaic(&raw[0][0], W, W, H, BAYER_GRBG, BAYER_OUT_RGB565, out);
+
+    for (y = 0; y < H; y++) {
+        for (x = 1; x < W - 1; x++) {
+            CHECK_EQUAL(rgb565(rgb[y][x][0], rgb[y][x][1], rgb[y][x][2]), out[y * W + x]);
+        }
+    }
+}
+
+TEST(BayerTestGroup, GrayOutputIsLuma)
+{
+    int i;
+
+    fill(255, 0, 0);
+    mosaic(rgb, BAYER_BGGR, raw);
+    bayer_demosaic(&raw[0][0], W, W, H, BAYER_BGGR, BAYER_OUT_GRAY, gray);
+    for (i = 0; i < W * H; i++) {
+        CHECK_EQUAL((77 * 255 + 128) >> 8, gray[i]);
+    }
+
+    fill(90, 90, 90);
+    mosaic(rgb, BAYER_BGGR, raw);
+    bayer_demosaic(&raw[0][0], W, W, H, BAYER_BGGR, BAYER_OUT_GRAY, gray);
+    CHECK_EQUAL(90, gray[0]);
+    CHECK_EQUAL(90, gray[W * H - 1]);
+}
+
+TEST(BayerTestGroup, RegionOfInterestUsesShiftedPattern)
+{
+    int i;
+
+    fill(30, 160, 250);
+    mosaic(rgb, BAYER_RGGB, raw);
+
+    /* 4x3 region starting at (3, 1), never reading outside of it. */
+    memset(out, 0, sizeof(out));
+    bayer_demosaic(&raw[1][3], W, 4, 3, bayer_pattern_at(BAYER_RGGB, 3, 1), BAYER_OUT_RGB565, out);
+    for (i = 0; i < 4 * 3; i++) {
+        CHECK_EQUAL(rgb565(30, 160, 250), out[i]);
+    }
+    CHECK_EQUAL(0, out[4 * 3]);
+}
+
+TEST(BayerTestGroup, BinningAveragesGreens)
+{
+    const uint8_t row0[] = {100, 50, 10, 20};
+    const uint8_t row1[] = {61, 200, 30, 40};
+
+    /* RGGB: R = 100, G = (50 + 61) / 2 rounded, B = 200 */
+    bayer_bin2x2_row(row0, row1, 4, BAYER_RGGB, BAYER_OUT_RGB565, out);
+    CHECK_EQUAL(rgb565(100, 56, 200), out[0]);
+    CHECK_EQUAL(rgb565(10, 25, 40), out[1]);
+
+    /* BGGR: same samples, red and blue swapped */
+    bayer_bin2x2_row(row0, row1, 4, BAYER_BGGR, BAYER_OUT_RGB565, out);
+    CHECK_EQUAL(rgb565(200, 56, 100), out[0]);
+}
+
+TEST(BayerTestGroup, BinnedFrameHasHalfResolution)
+{
+    int i;
+
+    fill(120, 60, 180);
+    mosaic(rgb, BAYER_GBRG, raw);
+    memset(gray, 0xaa, sizeof(gray));
+    bayer_bin2x2(&raw[0][0], W, W, H, BAYER_GBRG, BAYER_OUT_GRAY, gray);
+    for (i = 0; i < (W / 2) * (H / 2); i++) {
+        CHECK_EQUAL((77 * 120 + 150 * 60 + 29 * 180 + 128) >> 8, gray[i]);
+    }
+    CHECK_EQUAL(0xaa, gray[(W / 2) * (H / 2)]);
+}
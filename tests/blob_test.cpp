@@ -0,0 +1,195 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/blob.h"
+
+#define W 16
+#define H 12
+
+/* Y = 200 with strong red chroma for class 0, Y = 100 with strong blue
+ * chroma for class 1, mid grey elsewhere. */
+#define RED_U 90
+#define RED_V 220
+#define BLUE_U 220
+#define BLUE_V 90
+
+TEST_GROUP(BlobTestGroup)
+{
+    uint8_t frame[H][2 * W];
+    blob_lut_t lut;
+    blob_tracker_t tracker;
+
+    void setup()
+    {
+        const blob_threshold_t red = {150, 255, 60, 120, 180, 255};
+        const blob_threshold_t blue = {50, 150, 180, 255, 60, 120};
+        int x, y;
+
+        blob_lut_init(&lut);
+        blob_lut_set_class(&lut, 0, &red);
+        blob_lut_set_class(&lut, 1, &blue);
+        blob_init(&tracker);
+
+        for (y = 0; y < H; y++) {
+            for (x = 0; x < W; x++) {
+                set(x, y, 128, 128, 128);
+            }
+        }
+    }
+
+    /* Chroma is shared by pixel pairs, the whole pair is set. */
+    void set(int x, int y, uint8_t luma, uint8_t u, uint8_t v)
+    {
+        uint8_t *pair = &frame[y][4 * (x / 2)];
+
+        pair[2 * (x & 1)] = luma;
+        pair[1] = u;
+        pair[3] = v;
+    }
+
+    void rect(int x0, int y0, int x1, int y1, uint8_t luma, uint8_t u, uint8_t v)
+    {
+        int x, y;
+
+        for (y = y0; y <= y1; y++) {
+            for (x = x0; x <= x1; x++) {
+                set(x, y, luma, u, v);
+            }
+        }
+    }
+};
+
+TEST(BlobTestGroup, LookupTablesCombineClasses)
+{
+    CHECK_EQUAL(1, blob_lut_classify(&lut, 200, RED_U, RED_V));
+    CHECK_EQUAL(2, blob_lut_classify(&lut, 100, BLUE_U, BLUE_V));
+    CHECK_EQUAL(0, blob_lut_classify(&lut, 100, RED_U, RED_V));
+    CHECK_EQUAL(0, blob_lut_classify(&lut, 128, 128, 128));
+
+    blob_lut_set_class(&lut, 0, NULL);
+    CHECK_EQUAL(0, blob_lut_classify(&lut, 200, RED_U, RED_V));
+    CHECK_EQUAL(2, blob_lut_classify(&lut, 100, BLUE_U, BLUE_V));
+}
+
+TEST(BlobTestGroup, EmptyFrameHasNoBlobs)
+{
+    CHECK_EQUAL(0, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_FALSE(tracker.overflow);
+}
+
+TEST(BlobTestGroup, RectangleGivesBoundingBoxAndCentroid)
+{
+    const blob_t *blob;
+
+    rect(2, 3, 7, 8, 200, RED_U, RED_V);
+
+    CHECK_EQUAL(1, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_EQUAL(1, tracker.count[0]);
+    CHECK_EQUAL(0, tracker.count[1]);
+
+    blob = &tracker.blobs[0][0];
+    CHECK_EQUAL(36, blob->area);
+    CHECK_EQUAL(2, blob->x_min);
+    CHECK_EQUAL(3, blob->y_min);
+    CHECK_EQUAL(7, blob->x_max);
+    CHECK_EQUAL(8, blob->y_max);
+    /* 4.5 and 5.5 rounded up */
+    CHECK_EQUAL(5, blob->cx);
+    CHECK_EQUAL(6, blob->cy);
+}
+
+TEST(BlobTestGroup, UShapeIsMergedIntoOneBlob)
+{
+    /* Two vertical bars only joined by the bottom row, found as separate
+     * runs first. */
+    rect(2, 1, 3, 8, 200, RED_U, RED_V);
+    rect(10, 1, 11, 8, 200, RED_U, RED_V);
+    rect(2, 9, 11, 9, 200, RED_U, RED_V);
+
+    CHECK_EQUAL(1, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_EQUAL(16 + 16 + 10, tracker.blobs[0][0].area);
+    CHECK_EQUAL(2, tracker.blobs[0][0].x_min);
+    CHECK_EQUAL(11, tracker.blobs[0][0].x_max);
+}
+
+TEST(BlobTestGroup, DiagonalNeighboursAreSeparate)
+{
+    rect(2, 2, 3, 3, 200, RED_U, RED_V);
+    rect(4, 4, 5, 5, 200, RED_U, RED_V);
+
+    CHECK_EQUAL(2, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+}
+
+TEST(BlobTestGroup, ClassesAreNotMerged)
+{
+    rect(0, 0, 5, 5, 200, RED_U, RED_V);
+    rect(6, 0, 9, 5, 100, BLUE_U, BLUE_V);
+
+    CHECK_EQUAL(2, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_EQUAL(36, tracker.blobs[0][0].area);
+    CHECK_EQUAL(24, tracker.blobs[1][0].area);
+    CHECK_EQUAL(6, tracker.blobs[1][0].x_min);
+}
+
+TEST(BlobTestGroup, KeepsLargestBlobsSorted)
+{
+    int i;
+
+    /* Areas 2, 4, 6 and 8 pixels, on separate rows. */
+    for (i = 0; i < 4; i++) {
+        rect(0, 2 * i, 2 * i + 1, 2 * i, 200, RED_U, RED_V);
+    }
+
+    CHECK_EQUAL(BLOB_MAX_PER_CLASS, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_EQUAL(8, tracker.blobs[0][0].area);
+    CHECK_EQUAL(6, tracker.blobs[0][1].area);
+    CHECK_EQUAL(4, tracker.blobs[0][2].area);
+
+    /* And ignores the small ones. */
+    CHECK_EQUAL(2, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 5));
+}
+
+TEST(BlobTestGroup, BandsGiveTheSameBlobs)
+{
+    blob_t whole[BLOB_MAX_CLASSES][BLOB_MAX_PER_CLASS];
+
+    rect(2, 1, 3, 8, 200, RED_U, RED_V);
+    rect(10, 1, 11, 8, 200, RED_U, RED_V);
+    rect(2, 9, 11, 9, 200, RED_U, RED_V);
+    rect(6, 2, 7, 4, 100, BLUE_U, BLUE_V);
+    rect(12, 10, 15, 11, 100, BLUE_U, BLUE_V);
+
+    /* Unused entries are left untouched. */
+    memset(tracker.blobs, 0, sizeof(tracker.blobs));
+    CHECK_EQUAL(3, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    memcpy(whole, tracker.blobs, sizeof(whole));
+
+    /* Bands of 5 rows, the last one shorter, as delivered by the DCMI. */
+    memset(tracker.blobs, 0, sizeof(tracker.blobs));
+    blob_begin_frame(&tracker, 1);
+    blob_process_rows(&tracker, &lut, &frame[0][0], W, 5);
+    blob_process_rows(&tracker, &lut, &frame[5][0], W, 5);
+    blob_process_rows(&tracker, &lut, &frame[10][0], W, 2);
+    CHECK_EQUAL(3, blob_end_frame(&tracker));
+    MEMCMP_EQUAL(whole, tracker.blobs, sizeof(whole));
+}
+
+TEST(BlobTestGroup, TooManyRunsIsReported)
+{
+    static uint8_t stripes[2 * 4 * (BLOB_MAX_ROW_RUNS + 1)];
+    unsigned x;
+
+    /* One run every other pixel pair. */
+    memset(stripes, 128, sizeof(stripes));
+    for (x = 0; x < sizeof(stripes); x += 8) {
+        stripes[x] = 200;
+        stripes[x + 1] = RED_U;
+        stripes[x + 2] = 200;
+        stripes[x + 3] = RED_V;
+    }
+
+    CHECK_EQUAL(BLOB_MAX_PER_CLASS, blob_track_yuv422(&tracker, &lut, stripes, sizeof(stripes) / 2, 1, 1));
+    CHECK_TRUE(tracker.overflow);
+
+    CHECK_EQUAL(0, blob_track_yuv422(&tracker, &lut, &frame[0][0], W, H, 1));
+    CHECK_FALSE(tracker.overflow);
+}
@@ -0,0 +1,201 @@
+#include <cstring>
+#include <CppUTest/TestHarness.h>
+#include "camera/camera_ctrl_queue.h"
+
+struct Completion {
+    int calls;
+    int8_t result;
+};
+
+static void completion_cb(void *arg, int8_t result)
+{
+    Completion *c = (Completion *)arg;
+    c->calls++;
+    c->result = result;
+}
+
+static camera_ctrl_cmd_t make_cmd(camera_ctrl_kind_t kind, uint8_t value,
+                                  Completion *c = NULL)
+{
+    camera_ctrl_cmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.kind = kind;
+    cmd.param.value = value;
+    if (c != NULL) {
+        cmd.cb = completion_cb;
+        cmd.cb_arg = c;
+    }
+    return cmd;
+}
+
+TEST_GROUP(CameraCtrlQueueTestGroup)
+{
+    camera_ctrl_queue_t queue;
+    camera_ctrl_cmd_t out;
+
+    void setup()
+    {
+        camera_ctrl_queue_init(&queue);
+    }
+};
+
+TEST(CameraCtrlQueueTestGroup, EmptyQueueHasNothingToTake)
+{
+    CHECK_FALSE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(0, camera_ctrl_queue_pending_count(&queue));
+}
+
+TEST(CameraCtrlQueueTestGroup, InvalidKindIsRejected)
+{
+    camera_ctrl_cmd_t cmd = make_cmd(CAMERA_CTRL_NUM_KINDS, 0);
+
+    CHECK_FALSE(camera_ctrl_queue_post(&queue, &cmd));
+    CHECK_EQUAL(0, camera_ctrl_queue_pending_count(&queue));
+}
+
+TEST(CameraCtrlQueueTestGroup, CommandsAreTakenInPostOrder)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_EXPOSURE, 1);
+    camera_ctrl_cmd_t b = make_cmd(CAMERA_CTRL_BRIGHTNESS, 2);
+
+    camera_ctrl_queue_post(&queue, &a);
+    camera_ctrl_queue_post(&queue, &b);
+    CHECK_EQUAL(2, camera_ctrl_queue_pending_count(&queue));
+
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(CAMERA_CTRL_EXPOSURE, out.kind);
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(CAMERA_CTRL_BRIGHTNESS, out.kind);
+    CHECK_FALSE(camera_ctrl_queue_take(&queue, &out));
+}
+
+TEST(CameraCtrlQueueTestGroup, SameKindIsMerged)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_CONTRAST, 10);
+    camera_ctrl_cmd_t b = make_cmd(CAMERA_CTRL_CONTRAST, 20);
+
+    camera_ctrl_queue_post(&queue, &a);
+    camera_ctrl_queue_post(&queue, &b);
+
+    CHECK_EQUAL(1, camera_ctrl_queue_pending_count(&queue));
+    CHECK_EQUAL(2, queue.posted);
+    CHECK_EQUAL(1, queue.merged);
+
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(20, out.param.value);
+    CHECK_FALSE(camera_ctrl_queue_take(&queue, &out));
+}
+
+TEST(CameraCtrlQueueTestGroup, SupersededCommandIsCompletedWithReset)
+{
+    Completion first = {0, 0}, second = {0, 0};
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_AE, 1, &first);
+    camera_ctrl_cmd_t b = make_cmd(CAMERA_CTRL_AE, 0, &second);
+
+    camera_ctrl_queue_post(&queue, &a);
+    CHECK_EQUAL(0, first.calls);
+
+    camera_ctrl_queue_post(&queue, &b);
+    CHECK_EQUAL(1, first.calls);
+    CHECK_EQUAL(CAMERA_CTRL_SUPERSEDED, first.result);
+    CHECK_EQUAL(0, second.calls);
+}
+
+TEST(CameraCtrlQueueTestGroup, MergedCommandMovesToTheBack)
+{
+    /* AWB off, gain (which disables AWB), AWB on: AWB must be applied
+     * last, otherwise the gain command would leave it disabled. */
+    camera_ctrl_cmd_t awb_off = make_cmd(CAMERA_CTRL_AWB, 0);
+    camera_ctrl_cmd_t gain = make_cmd(CAMERA_CTRL_RGB_GAIN, 0);
+    camera_ctrl_cmd_t awb_on = make_cmd(CAMERA_CTRL_AWB, 1);
+
+    camera_ctrl_queue_post(&queue, &awb_off);
+    camera_ctrl_queue_post(&queue, &gain);
+    camera_ctrl_queue_post(&queue, &awb_on);
+
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(CAMERA_CTRL_RGB_GAIN, out.kind);
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(CAMERA_CTRL_AWB, out.kind);
+    CHECK_EQUAL(1, out.param.value);
+}
+
+TEST(CameraCtrlQueueTestGroup, OrderSurvivesCounterWrapAround)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_MIRROR, 0);
+    camera_ctrl_cmd_t b = make_cmd(CAMERA_CTRL_BRIGHTNESS, 0);
+
+    queue.next_order = 0xFFFFFFFF;
+    camera_ctrl_queue_post(&queue, &a);
+    camera_ctrl_queue_post(&queue, &b);
+
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(CAMERA_CTRL_MIRROR, out.kind);
+}
+
+TEST(CameraCtrlQueueTestGroup, CompleteCallsCallback)
+{
+    Completion c = {0, 0};
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_WINDOW, 0, &c);
+
+    camera_ctrl_queue_post(&queue, &a);
+    camera_ctrl_queue_take(&queue, &out);
+    camera_ctrl_queue_complete(&out, -1);
+
+    CHECK_EQUAL(1, c.calls);
+    CHECK_EQUAL(-1, c.result);
+}
+
+TEST(CameraCtrlQueueTestGroup, CompleteWithoutCallbackDoesNothing)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_WINDOW, 0);
+
+    camera_ctrl_queue_complete(&a, 0);
+}
+
+TEST(CameraCtrlQueueTestGroup, OpenTransactionHoldsCommands)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_EXPOSURE, 0);
+    camera_ctrl_cmd_t b = make_cmd(CAMERA_CTRL_RGB_GAIN, 0);
+
+    camera_ctrl_queue_begin(&queue);
+    camera_ctrl_queue_post(&queue, &a);
+    camera_ctrl_queue_post(&queue, &b);
+
+    CHECK_FALSE(camera_ctrl_queue_ready(&queue));
+    CHECK_FALSE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_EQUAL(2, camera_ctrl_queue_pending_count(&queue));
+
+    camera_ctrl_queue_commit(&queue);
+
+    CHECK_TRUE(camera_ctrl_queue_ready(&queue));
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_TRUE(camera_ctrl_queue_take(&queue, &out));
+    CHECK_FALSE(camera_ctrl_queue_ready(&queue));
+}
+
+TEST(CameraCtrlQueueTestGroup, TransactionsCanBeNested)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_AE, 0);
+
+    camera_ctrl_queue_begin(&queue);
+    camera_ctrl_queue_begin(&queue);
+    camera_ctrl_queue_post(&queue, &a);
+
+    camera_ctrl_queue_commit(&queue);
+    CHECK_FALSE(camera_ctrl_queue_ready(&queue));
+
+    camera_ctrl_queue_commit(&queue);
+    CHECK_TRUE(camera_ctrl_queue_ready(&queue));
+}
+
+TEST(CameraCtrlQueueTestGroup, UnbalancedCommitIsIgnored)
+{
+    camera_ctrl_cmd_t a = make_cmd(CAMERA_CTRL_AE, 0);
+
+    camera_ctrl_queue_commit(&queue);
+    camera_ctrl_queue_begin(&queue);
+    camera_ctrl_queue_post(&queue, &a);
+
+    CHECK_FALSE(camera_ctrl_queue_ready(&queue));
+}
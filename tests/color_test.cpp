@@ -0,0 +1,155 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include "vision/color.h"
+#include "random_fill.h"
+
+#define PIXELS 64
+
+static uint8_t clamp_float(double x)
+{
+    x = floor(x + 0.5);
+    return x < 0 ? 0 : (x > 255 ? 255 : (uint8_t)x);
+}
+
+static void float_yuv_to_rgb(const uint8_t *yuv, int i, uint8_t rgb[3])
+{
+    double y = yuv[2 * i], cb = yuv[4 * (i / 2) + 1] - 128.0, cr = yuv[4 * (i / 2) + 3] - 128.0;
+
+    rgb[0] = clamp_float(y + 1.402 * cr);
+    rgb[1] = clamp_float(y - 0.344136 * cb - 0.714136 * cr);
+    rgb[2] = clamp_float(y + 1.772 * cb);
+}
+
+static void float_rgb_to_yuv(const uint8_t *rgb, uint8_t *yuv)
+{
+    double r = (rgb[0] + rgb[3]) / 2.0, g = (rgb[1] + rgb[4]) / 2.0, b = (rgb[2] + rgb[5]) / 2.0;
+
+    yuv[0] = clamp_float(0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2]);
+    yuv[2] = clamp_float(0.299 * rgb[3] + 0.587 * rgb[4] + 0.114 * rgb[5]);
+    yuv[1] = clamp_float(128 - 0.168736 * r - 0.331264 * g + 0.5 * b);
+    yuv[3] = clamp_float(128 + 0.5 * r - 0.418688 * g - 0.081312 * b);
+}
+
+TEST_GROUP(ColorTestGroup)
+{
+    uint8_t src[3 * PIXELS];
+    uint8_t out[3 * PIXELS], out_ref[3 * PIXELS];
+    uint16_t out565[PIXELS], out565_ref[PIXELS];
+
+    void setup()
+    {
+        random_fill(src, sizeof(src), 42);
+        /* Extreme values, to check the saturation. */
+        src[0] = 255; src[1] = 255; src[2] = 0; src[3] = 0;
+        src[4] = 0; src[5] = 0; src[6] = 255; src[7] = 255;
+
+        memset(out, 0, sizeof(out));
+        memset(out_ref, 0, sizeof(out_ref));
+        memset(out565, 0, sizeof(out565));
+        memset(out565_ref, 0, sizeof(out565_ref));
+    }
+};
+
+TEST(ColorTestGroup, YUVToRGB888IsCloseToFloat)
+{
+    uint8_t rgb[3];
+    int i, c;
+
+    yuv422_to_rgb888_ref(src, out_ref, PIXELS);
+    for (i = 0; i < PIXELS; i++) {
+        float_yuv_to_rgb(src, i, rgb);
+        for (c = 0; c < 3; c++) {
+            CHECK(abs(rgb[c] - out_ref[3 * i + c]) <= 2);
+        }
+    }
+}
+
+TEST(ColorTestGroup, YUVToRGB565IsCloseToFloat)
+{
+    uint8_t rgb[3];
+    int i;
+
+    yuv422_to_rgb565_ref(src, out565_ref, PIXELS);
+    for (i = 0; i < PIXELS; i++) {
+        float_yuv_to_rgb(src, i, rgb);
+        CHECK(abs((rgb[0] >> 3) - (out565_ref[i] >> 11)) <= 1);
+        CHECK(abs((rgb[1] >> 2) - ((out565_ref[i] >> 5) & 0x3F)) <= 1);
+        CHECK(abs((rgb[2] >> 3) - (out565_ref[i] & 0x1F)) <= 1);
+    }
+}
+
+TEST(ColorTestGroup, RGB888ToYUVIsCloseToFloat)
+{
+    uint8_t yuv[4];
+    int i, c;
+
+    rgb888_to_yuv422_ref(src, out_ref, PIXELS);
+    for (i = 0; i < PIXELS; i += 2) {
+        float_rgb_to_yuv(&src[3 * i], yuv);
+        for (c = 0; c < 4; c++) {
+            CHECK(abs(yuv[c] - out_ref[2 * i + c]) <= 2);
+        }
+    }
+}
+
+TEST(ColorTestGroup, RGB565ToYUVIsCloseToFloat)
+{
+    uint16_t rgb565[PIXELS];
+    uint8_t rgb[6], yuv[4];
+    int i, c;
+
+    memcpy(rgb565, src, sizeof(rgb565));
+    rgb565_to_yuv422_ref(rgb565, out_ref, PIXELS);
+    for (i = 0; i < PIXELS; i += 2) {
+        for (c = 0; c < 2; c++) {
+            uint16_t p = rgb565[i + c];
+            rgb[3 * c] = ((p >> 11) << 3) | (p >> 13);
+            rgb[3 * c + 1] = (((p >> 5) & 0x3F) << 2) | ((p >> 9) & 0x3);
+            rgb[3 * c + 2] = ((p & 0x1F) << 3) | ((p >> 2) & 0x7);
+        }
+        float_rgb_to_yuv(rgb, yuv);
+        for (c = 0; c < 4; c++) {
+            CHECK(abs(yuv[c] - out_ref[2 * i + c]) <= 2);
+        }
+    }
+}
+
+TEST(ColorTestGroup, RoundTripKeepsGrey)
+{
+    uint8_t grey[2 * 2], rgb[3 * 2], back[2 * 2];
+    int y;
+
+    for (y = 0; y < 256; y++) {
+        grey[0] = y; grey[1] = 128; grey[2] = y; grey[3] = 128;
+        yuv422_to_rgb888(grey, rgb, 2);
+        CHECK_EQUAL(y, rgb[0]);
+        CHECK_EQUAL(y, rgb[1]);
+        CHECK_EQUAL(y, rgb[2]);
+        rgb888_to_yuv422(rgb, back, 2);
+        MEMCMP_EQUAL(grey, back, sizeof(grey));
+    }
+}
+
+TEST(ColorTestGroup, SIMDMatchesReference)
+{
+    uint16_t rgb565[PIXELS];
+
+    yuv422_to_rgb888_ref(src, out_ref, PIXELS);
+    yuv422_to_rgb888(src, out, PIXELS);
+    MEMCMP_EQUAL(out_ref, out, sizeof(out));
+
+    yuv422_to_rgb565_ref(src, out565_ref, PIXELS);
+    yuv422_to_rgb565(src, out565, PIXELS);
+    MEMCMP_EQUAL(out565_ref, out565, sizeof(out565));
+
+    rgb888_to_yuv422_ref(src, out_ref, PIXELS);
+    rgb888_to_yuv422(src, out, PIXELS);
+    MEMCMP_EQUAL(out_ref, out, sizeof(out));
+
+    memcpy(rgb565, src, sizeof(rgb565));
+    rgb565_to_yuv422_ref(rgb565, out_ref, PIXELS);
+    rgb565_to_yuv422(rgb565, out, PIXELS);
+    MEMCMP_EQUAL(out_ref, out, sizeof(out));
+}
@@ -0,0 +1,126 @@
+#include <CppUTest/TestHarness.h>
+#include "camera/dcmi_crop.h"
+
+TEST_GROUP(DCMICropTestGroup)
+{
+    dcmi_crop_window_t window;
+};
+
+TEST(DCMICropTestGroup, GreyscaleUsesOneClockPerPixel)
+{
+    dcmi_crop_rect_t rect = {8, 10, 64, 48};
+
+    CHECK_TRUE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+    CHECK_EQUAL(8, window.hoffcnt);
+    CHECK_EQUAL(10, window.vst);
+    CHECK_EQUAL(64, window.capcnt);
+    CHECK_EQUAL(48, window.vline);
+    CHECK_EQUAL(64 * 48, dcmi_crop_size(&window));
+}
+
+TEST(DCMICropTestGroup, ColorUsesTwoClocksPerPixel)
+{
+    dcmi_crop_rect_t rect = {5, 0, 32, 16};
+
+    CHECK_TRUE(dcmi_crop_compute(&rect, 160, 120, 2, 0, &window));
+    CHECK_EQUAL(10, window.hoffcnt);
+    CHECK_EQUAL(64, window.capcnt);
+    CHECK_EQUAL(64 * 16, dcmi_crop_size(&window));
+}
+
+TEST(DCMICropTestGroup, FullFrameIsValid)
+{
+    dcmi_crop_rect_t rect = {0, 0, 640, 480};
+
+    CHECK_TRUE(dcmi_crop_compute(&rect, 640, 480, 2, 0, &window));
+    CHECK_EQUAL(1280, window.capcnt);
+    CHECK_EQUAL(480, window.vline);
+}
+
+TEST(DCMICropTestGroup, EmptyRectangleIsRejected)
+{
+    dcmi_crop_rect_t rect = {0, 0, 0, 10};
+
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+    rect.width = 4;
+    rect.height = 0;
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+}
+
+TEST(DCMICropTestGroup, RectangleOutsideFrameIsRejected)
+{
+    dcmi_crop_rect_t rect = {100, 0, 64, 10};
+
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+
+    rect.x = 0;
+    rect.y = 115;
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+}
+
+TEST(DCMICropTestGroup, LinesMustBeWordSized)
+{
+    dcmi_crop_rect_t rect = {0, 0, 30, 10};
+
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, 0, &window));
+    /* 30 pixels of 2 bytes are 60 bytes, which is fine. */
+    CHECK_TRUE(dcmi_crop_compute(&rect, 160, 120, 2, 0, &window));
+}
+
+TEST(DCMICropTestGroup, YUV422NeedsWholeMacropixels)
+{
+    dcmi_crop_rect_t rect = {5, 3, 32, 16};
+
+    /* An odd x would start the line on Y Cr instead of Cb Y. */
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 2, DCMI_CROP_EVEN_X, &window));
+    rect.x = 6;
+    CHECK_TRUE(dcmi_crop_compute(&rect, 160, 120, 2, DCMI_CROP_EVEN_X, &window));
+    CHECK_EQUAL(12, window.hoffcnt);
+    CHECK_EQUAL(3, window.vst);
+}
+
+TEST(DCMICropTestGroup, BayerKeepsThePattern)
+{
+    const uint8_t align = DCMI_CROP_EVEN_X | DCMI_CROP_EVEN_Y;
+    dcmi_crop_rect_t rect = {4, 3, 32, 16};
+
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, align, &window));
+    rect.x = 5;
+    rect.y = 2;
+    CHECK_FALSE(dcmi_crop_compute(&rect, 160, 120, 1, align, &window));
+    rect.x = 4;
+    CHECK_TRUE(dcmi_crop_compute(&rect, 160, 120, 1, align, &window));
+    CHECK_EQUAL(4, window.hoffcnt);
+    CHECK_EQUAL(2, window.vst);
+}
+
+TEST(DCMICropTestGroup, ClampKeepsSizeAndMovesInside)
+{
+    dcmi_crop_rect_t rect = {150, 100, 32, 32};
+
+    dcmi_crop_clamp(&rect, 160, 120);
+    CHECK_EQUAL(128, rect.x);
+    CHECK_EQUAL(88, rect.y);
+    CHECK_EQUAL(32, rect.width);
+    CHECK_EQUAL(32, rect.height);
+}
+
+TEST(DCMICropTestGroup, ClampShrinksOversizedRectangle)
+{
+    dcmi_crop_rect_t rect = {10, 10, 200, 200};
+
+    dcmi_crop_clamp(&rect, 160, 120);
+    CHECK_EQUAL(0, rect.x);
+    CHECK_EQUAL(0, rect.y);
+    CHECK_EQUAL(160, rect.width);
+    CHECK_EQUAL(120, rect.height);
+}
+
+TEST(DCMICropTestGroup, ClampLeavesValidRectangleUntouched)
+{
+    dcmi_crop_rect_t rect = {4, 6, 32, 16};
+
+    dcmi_crop_clamp(&rect, 160, 120);
+    CHECK_EQUAL(4, rect.x);
+    CHECK_EQUAL(6, rect.y);
+}
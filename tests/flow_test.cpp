@@ -0,0 +1,173 @@
+#include <CppUTest/TestHarness.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vision/flow.h"
+#include "random_fill.h"
+
+#define W 80
+#define H 60
+#define LEVELS 3
+
+/* Smooth random texture: random values every 6 pixels, bilinearly
+ * interpolated, so that the pyramid levels still hold details. */
+static float texture(float x, float y)
+{
+    static float grid[32][32];
+    static bool init = false;
+    int i, j;
+    float fx, fy;
+
+    if (!init) {
+        uint32_t seed = 11;
+        for (i = 0; i < 32 * 32; i++) {
+            (&grid[0][0])[i] = (random_next(&seed) >> 16) % 200 + 28;
+        }
+        init = true;
+    }
+
+    x = x / 6 + 8;
+    y = y / 6 + 8;
+    i = (int)floorf(x);
+    j = (int)floorf(y);
+    fx = x - i;
+    fy = y - j;
+    return (grid[j][i] * (1 - fx) + grid[j][i + 1] * fx) * (1 - fy) +
+           (grid[j + 1][i] * (1 - fx) + grid[j + 1][i + 1] * fx) * fy;
+}
+
+/* Renders the texture moved by (tx, ty) and rotated by angle around the centre. */
+static void render(uint8_t image[H][W], float tx, float ty, float angle)
+{
+    float c = cosf(angle), s = sinf(angle), x, y;
+    int i, j;
+
+    for (j = 0; j < H; j++) {
+        for (i = 0; i < W; i++) {
+            x = i - W / 2.0f - tx;
+            y = j - H / 2.0f - ty;
+            image[j][i] = (uint8_t)(texture(c * x + s * y, -s * x + c * y) + 0.5f);
+        }
+    }
+}
+
+TEST_GROUP(FlowTestGroup)
+{
+    uint8_t prev_image[H][W], cur_image[H][W];
+    uint8_t prev_arena[W * H / 2], cur_arena[W * H / 2];
+    pyramid_t prev, cur;
+    flow_result_t result;
+
+    void estimate(float tx, float ty, float angle)
+    {
+        render(prev_image, 0, 0, 0);
+        render(cur_image, tx, ty, angle);
+        CHECK_TRUE(pyramid_build(&prev, &prev_image[0][0], W, W, H, LEVELS, prev_arena, sizeof(prev_arena)));
+        CHECK_TRUE(pyramid_build(&cur, &cur_image[0][0], W, W, H, LEVELS, cur_arena, sizeof(cur_arena)));
+        CHECK_TRUE(flow_estimate(&prev, &cur, &result));
+    }
+
+    /* Exhaustive search at full resolution. */
+    void full_search(const flow_vector_t *v, int radius, int *best_dx, int *best_dy)
+    {
+        uint32_t sad, best = UINT32_MAX;
+
+        for (int dy = -radius; dy <= radius; dy++) {
+            for (int dx = -radius; dx <= radius; dx++) {
+                if (v->x + dx < 0 || v->x + dx > W - FLOW_BLOCK_SIZE ||
+                    v->y + dy < 0 || v->y + dy > H - FLOW_BLOCK_SIZE) {
+                    continue;
+                }
+                sad = flow_block_sad_ref(&prev_image[v->y][v->x], W, &cur_image[v->y + dy][v->x + dx], W);
+                if (sad < best) {
+                    best = sad;
+                    *best_dx = dx;
+                    *best_dy = dy;
+                }
+            }
+        }
+    }
+};
+
+TEST(FlowTestGroup, SadMatchesReference)
+{
+    uint8_t a[13 * FLOW_BLOCK_SIZE], b[17 * FLOW_BLOCK_SIZE];
+
+    random_fill(a, sizeof(a), 9);
+    random_fill(b, sizeof(b), 10);
+    CHECK_EQUAL(flow_block_sad_ref(a + 1, 13, b + 2, 17), flow_block_sad(a + 1, 13, b + 2, 17));
+}
+
+TEST(FlowTestGroup, StaticSceneHasNoMotion)
+{
+    estimate(0, 0, 0);
+    CHECK_EQUAL(FLOW_GRID_X * FLOW_GRID_Y, result.num_vectors);
+    CHECK_EQUAL(0, result.tx);
+    CHECK_EQUAL(0, result.ty);
+    CHECK_EQUAL(0, result.rotation);
+}
+
+TEST(FlowTestGroup, SmallTranslation)
+{
+    estimate(2, -1, 0);
+    CHECK_EQUAL(2 * FLOW_SCALE, result.tx);
+    CHECK_EQUAL(-1 * FLOW_SCALE, result.ty);
+    CHECK_EQUAL(0, result.rotation);
+}
+
+TEST(FlowTestGroup, PyramidWidensSearchRange)
+{
+    int i, dx = 0, dy = 0;
+
+    /* Far beyond the search radius at level 0. */
+    estimate(-7, 5, 0);
+    CHECK_EQUAL(-7 * FLOW_SCALE, result.tx);
+    CHECK_EQUAL(5 * FLOW_SCALE, result.ty);
+
+    /* Same vectors as the exhaustive search, block by block. */
+    for (i = 0; i < result.num_vectors; i++) {
+        full_search(&result.vectors[i], 10, &dx, &dy);
+        CHECK_EQUAL(dx, result.vectors[i].dx);
+        CHECK_EQUAL(dy, result.vectors[i].dy);
+        CHECK_EQUAL(0, result.vectors[i].sad);
+    }
+}
+
+TEST(FlowTestGroup, BlocksMovedOutOfTheImageAreLeftOut)
+{
+    int i;
+
+    /* On a narrower image, the left column of blocks is predicted out of
+     * the image and gives no vector. */
+    render(prev_image, 0, 0, 0);
+    render(cur_image, -11, 0, 0);
+    CHECK_TRUE(pyramid_build(&prev, &prev_image[0][0], W, 48, H, LEVELS, prev_arena, sizeof(prev_arena)));
+    CHECK_TRUE(pyramid_build(&cur, &cur_image[0][0], W, 48, H, LEVELS, cur_arena, sizeof(cur_arena)));
+    CHECK_TRUE(flow_estimate(&prev, &cur, &result));
+
+    CHECK_EQUAL((FLOW_GRID_X - 1) * FLOW_GRID_Y, result.num_vectors);
+    for (i = 0; i < result.num_vectors; i++) {
+        CHECK(result.vectors[i].sad < UINT16_MAX);
+    }
+    CHECK_EQUAL(-11 * FLOW_SCALE, result.tx);
+    CHECK_EQUAL(0, result.ty);
+}
+
+TEST(FlowTestGroup, RotationIsEstimated)
+{
+    estimate(0, 0, 0.08f);
+    CHECK(abs(result.rotation - 80) < 20);
+    CHECK(abs(result.tx) < FLOW_SCALE);
+    CHECK(abs(result.ty) < FLOW_SCALE);
+
+    estimate(1, 0, -0.08f);
+    CHECK(abs(result.rotation + 80) < 20);
+    CHECK(abs(result.tx - FLOW_SCALE) < FLOW_SCALE);
+}
+
+TEST(FlowTestGroup, TooSmallImageIsRefused)
+{
+    CHECK_TRUE(pyramid_build(&prev, &prev_image[0][0], W, FLOW_BLOCK_SIZE, H, 1, prev_arena, sizeof(prev_arena)));
+    CHECK_TRUE(pyramid_build(&cur, &cur_image[0][0], W, FLOW_BLOCK_SIZE, H, 1, cur_arena, sizeof(cur_arena)));
+    CHECK_FALSE(flow_estimate(&prev, &cur, &result));
+}
@@ -0,0 +1,348 @@
+#include <CppUTest/TestHarness.h>
+#include "camera/frame_pool.h"
+
+TEST_GROUP(FramePoolTestGroup)
+{
+    uint32_t storage[64];
+    frame_pool_t pool;
+
+    void setup()
+    {
+        frame_pool_init(&pool, (uint8_t *)storage, sizeof(storage));
+    }
+};
+
+TEST(FramePoolTestGroup, EmptyPoolHasNoSlots)
+{
+    POINTERS_EQUAL(NULL, frame_pool_acquire(&pool));
+    POINTERS_EQUAL(NULL, frame_pool_borrow_latest(&pool));
+}
+
+TEST(FramePoolTestGroup, StorageIsSplitInSlots)
+{
+    CHECK_EQUAL(4, frame_pool_configure(&pool, 64));
+    CHECK_EQUAL(4, frame_pool_free_count(&pool));
+    POINTERS_EQUAL(storage, pool.slots[0].buffer);
+    POINTERS_EQUAL(&storage[16], pool.slots[1].buffer);
+}
+
+TEST(FramePoolTestGroup, SlotCountIsCapped)
+{
+    CHECK_EQUAL(FRAME_POOL_MAX_SLOTS, frame_pool_configure(&pool, 4));
+}
+
+TEST(FramePoolTestGroup, SlotsAreKeptAligned)
+{
+    // 3 bytes get rounded up to a full DMA burst
+    frame_pool_configure(&pool, 3);
+    POINTERS_EQUAL(&storage[FRAME_POOL_ALIGNMENT / 4], pool.slots[1].buffer);
+}
+
+TEST(FramePoolTestGroup, TooBigSlotIsRefused)
+{
+    CHECK_EQUAL(0, frame_pool_configure(&pool, sizeof(storage) + 4));
+    CHECK_EQUAL(1, frame_pool_configure(&pool, sizeof(storage)));
+}
+
+TEST(FramePoolTestGroup, AcquireGivesEveryFreeSlotOnce)
+{
+    frame_pool_configure(&pool, 128);
+
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    CHECK(a != NULL);
+    CHECK(b != NULL);
+    CHECK(a != b);
+    CHECK_EQUAL(FRAME_SLOT_CAPTURE, a->state);
+    POINTERS_EQUAL(NULL, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, AbortedCaptureGoesBackToFreeList)
+{
+    frame_pool_configure(&pool, 256);
+    frame_slot_t *slot = frame_pool_acquire(&pool);
+
+    frame_pool_abort(&pool, slot);
+
+    CHECK_EQUAL(FRAME_SLOT_FREE, slot->state);
+    POINTERS_EQUAL(NULL, frame_pool_borrow_latest(&pool));
+    POINTERS_EQUAL(slot, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, PublishedFrameCanBeBorrowed)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *slot = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, slot, 100);
+
+    frame_slot_t *borrowed = frame_pool_borrow_latest(&pool);
+    POINTERS_EQUAL(slot, borrowed);
+    CHECK_EQUAL(100, borrowed->size);
+    CHECK_EQUAL(1, borrowed->refs);
+}
+
+TEST(FramePoolTestGroup, PublishedFramesAreNumbered)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_publish(&pool, b, 100);
+    CHECK_EQUAL(1, a->header.seq);
+    CHECK_EQUAL(2, b->header.seq);
+
+    /* Reconfiguring the pool does not restart the numbering. */
+    frame_pool_detach(&pool, a);
+    frame_pool_detach(&pool, b);
+    frame_pool_configure(&pool, 64);
+    a = frame_pool_acquire(&pool);
+    frame_pool_publish(&pool, a, 10);
+    CHECK_EQUAL(3, a->header.seq);
+}
+
+TEST(FramePoolTestGroup, PublishKeepsProducerHeader)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *slot = frame_pool_acquire(&pool);
+
+    slot->header.t_start = 100;
+    slot->header.t_end = 200;
+    slot->header.width = 160;
+    slot->header.height = 120;
+    slot->header.flags = FRAME_FLAG_OVERRUN;
+    frame_pool_publish(&pool, slot, 100);
+
+    frame_slot_t *borrowed = frame_pool_borrow_latest(&pool);
+    CHECK_EQUAL(100, borrowed->header.t_start);
+    CHECK_EQUAL(200, borrowed->header.t_end);
+    CHECK_EQUAL(160, borrowed->header.width);
+    CHECK_EQUAL(120, borrowed->header.height);
+    CHECK_EQUAL(FRAME_FLAG_OVERRUN, borrowed->header.flags);
+}
+
+TEST(FramePoolTestGroup, UnconsumedFramesAreCountedAsOverwritten)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_detach(&pool, a);
+    frame_pool_publish(&pool, b, 100);
+    CHECK_EQUAL(1, frame_pool_overwritten_count(&pool));
+
+    frame_pool_release(&pool, frame_pool_borrow_latest(&pool));
+    a = frame_pool_acquire(&pool);
+    frame_pool_publish(&pool, a, 100);
+    CHECK_EQUAL(1, frame_pool_overwritten_count(&pool));
+}
+
+TEST(FramePoolTestGroup, NewFrameRecyclesUnusedPreviousOne)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_detach(&pool, a);
+    frame_pool_publish(&pool, b, 100);
+
+    CHECK_EQUAL(FRAME_SLOT_FREE, a->state);
+    POINTERS_EQUAL(a, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, BorrowedFrameIsNotRecycled)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_detach(&pool, a);
+    frame_pool_borrow_latest(&pool);
+    frame_pool_publish(&pool, b, 100);
+
+    CHECK_EQUAL(FRAME_SLOT_READY, a->state);
+    POINTERS_EQUAL(NULL, frame_pool_acquire(&pool));
+
+    // Last consumer gives it back, slot returns to the DMA
+    frame_pool_release(&pool, a);
+    CHECK_EQUAL(FRAME_SLOT_FREE, a->state);
+    POINTERS_EQUAL(a, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, SlotIsFreedWhenLastConsumerReleases)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_detach(&pool, a);
+    frame_slot_t *usb = frame_pool_borrow_latest(&pool);
+    frame_pool_retain(&pool, usb); // Shared with the SPI consumer
+    frame_pool_publish(&pool, b, 100);
+
+    frame_pool_release(&pool, a);
+    CHECK_EQUAL(FRAME_SLOT_READY, a->state);
+
+    frame_pool_release(&pool, a);
+    CHECK_EQUAL(FRAME_SLOT_FREE, a->state);
+}
+
+TEST(FramePoolTestGroup, LatestFrameStaysAvailableAfterRelease)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_release(&pool, frame_pool_borrow_latest(&pool));
+
+    CHECK_EQUAL(FRAME_SLOT_READY, a->state);
+    POINTERS_EQUAL(a, frame_pool_borrow_latest(&pool));
+}
+
+TEST(FramePoolTestGroup, CannotReconfigureWhileInUse)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+
+    CHECK_EQUAL(0, frame_pool_configure(&pool, 64));
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_borrow_latest(&pool);
+    CHECK_EQUAL(0, frame_pool_configure(&pool, 64));
+
+    frame_pool_release(&pool, a);
+    CHECK_EQUAL(0, frame_pool_configure(&pool, 64));
+
+    // The capture stopped
+    frame_pool_detach(&pool, a);
+    CHECK_EQUAL(4, frame_pool_configure(&pool, 64));
+    POINTERS_EQUAL(NULL, frame_pool_borrow_latest(&pool));
+}
+
+TEST(FramePoolTestGroup, DMATargetIsNotRecycled)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    // Double buffering without rotation, both slots stay DMA targets
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_publish(&pool, b, 100);
+
+    CHECK_EQUAL(FRAME_SLOT_READY, a->state);
+    POINTERS_EQUAL(NULL, frame_pool_acquire(&pool));
+
+    frame_pool_detach(&pool, a);
+    CHECK_EQUAL(FRAME_SLOT_FREE, a->state);
+    POINTERS_EQUAL(a, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, DetachedCaptureGoesBackToFreeList)
+{
+    frame_pool_configure(&pool, 256);
+    frame_slot_t *slot = frame_pool_acquire(&pool);
+
+    frame_pool_detach(&pool, slot);
+
+    CHECK_EQUAL(FRAME_SLOT_FREE, slot->state);
+    POINTERS_EQUAL(slot, frame_pool_acquire(&pool));
+}
+
+TEST(FramePoolTestGroup, OverwriteOfDMATargetIsDetected)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_slot_t *borrowed = frame_pool_borrow_latest(&pool);
+    uint32_t seq = borrowed->header.seq;
+    CHECK_TRUE(frame_pool_unchanged(&pool, borrowed, seq));
+
+    // The DMA moves back to a once b is complete
+    frame_pool_publish(&pool, b, 100);
+    CHECK_FALSE(frame_pool_unchanged(&pool, borrowed, seq));
+
+    frame_pool_release(&pool, borrowed);
+
+    // With a single buffer only the end of the next capture is seen
+    seq = b->header.seq;
+    CHECK_TRUE(frame_pool_unchanged(&pool, b, seq));
+    frame_pool_publish(&pool, b, 100);
+    CHECK_FALSE(frame_pool_unchanged(&pool, b, seq));
+}
+
+TEST(FramePoolTestGroup, DetachedFrameIsNotOverwritten)
+{
+    frame_pool_configure(&pool, 128);
+    frame_slot_t *a = frame_pool_acquire(&pool);
+    frame_slot_t *b = frame_pool_acquire(&pool);
+
+    frame_pool_publish(&pool, a, 100);
+    frame_pool_detach(&pool, a);
+    frame_slot_t *borrowed = frame_pool_borrow_latest(&pool);
+    frame_pool_publish(&pool, b, 100);
+
+    CHECK_TRUE(frame_pool_unchanged(&pool, borrowed, 1));
+    frame_pool_release(&pool, borrowed);
+}
+
+/* Same steps as dmaTransferEndCb() with buffer rotation. */
+static frame_slot_t *rotate(frame_pool_t *pool, frame_slot_t **capture, uint8_t idle)
+{
+    frame_slot_t *filled = capture[idle];
+    frame_slot_t *next = frame_pool_acquire(pool);
+
+    if (next == NULL) {
+        next = frame_pool_reclaim(pool);
+    }
+    if (next == NULL) {
+        return NULL;
+    }
+    capture[idle] = next;
+    frame_pool_publish(pool, filled, 100);
+    frame_pool_detach(pool, filled);
+    return filled;
+}
+
+TEST(FramePoolTestGroup, ThreeSlotsKeepRotating)
+{
+    CHECK_EQUAL(3, frame_pool_configure(&pool, 80));
+    frame_slot_t *capture[2];
+    capture[0] = frame_pool_acquire(&pool);
+    capture[1] = frame_pool_acquire(&pool);
+
+    for (int i = 0; i < 10; i++) {
+        frame_slot_t *published = rotate(&pool, capture, i % 2);
+        CHECK(published != NULL);
+        POINTERS_EQUAL(published, pool.latest);
+        CHECK(capture[0] != published && capture[1] != published);
+        CHECK(capture[0] != capture[1]);
+    }
+    CHECK_EQUAL(10, pool.sequence);
+}
+
+TEST(FramePoolTestGroup, BorrowedLatestIsNotReclaimed)
+{
+    frame_pool_configure(&pool, 80);
+    frame_slot_t *capture[2];
+    capture[0] = frame_pool_acquire(&pool);
+    capture[1] = frame_pool_acquire(&pool);
+
+    rotate(&pool, capture, 0);
+    frame_slot_t *borrowed = frame_pool_borrow_latest(&pool);
+
+    // Every slot is in use, the frame is dropped
+    POINTERS_EQUAL(NULL, rotate(&pool, capture, 1));
+    POINTERS_EQUAL(borrowed, pool.latest);
+
+    frame_pool_release(&pool, borrowed);
+    CHECK(rotate(&pool, capture, 1) != NULL);
+    CHECK_EQUAL(0, frame_pool_overwritten_count(&pool));
+}
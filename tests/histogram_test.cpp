@@ -0,0 +1,127 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/histogram.h"
+
+#define W 16
+#define H 10
+
+TEST_GROUP(HistogramTestGroup)
+{
+    uint8_t yuv[H][2 * W];
+    uint8_t gray[H][W];
+    histogram_t hist, bands;
+
+    void setup()
+    {
+        int x, y;
+
+        /* Luma x + 10 * y, chroma depending on the column pair. */
+        for (y = 0; y < H; y++) {
+            for (x = 0; x < W; x++) {
+                gray[y][x] = x + 10 * y;
+                yuv[y][2 * x] = gray[y][x];
+                yuv[y][2 * x + 1] = x & 1 ? 100 + x : 150 - x;
+            }
+        }
+        histogram_reset(&hist);
+        histogram_reset(&bands);
+    }
+};
+
+TEST(HistogramTestGroup, WholeFrame)
+{
+    uint32_t sum = 0;
+    uint8_t u, v;
+    int x, y;
+
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, H, NULL);
+
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            sum += gray[y][x];
+        }
+    }
+    CHECK_EQUAL(W * H, hist.count);
+    CHECK_EQUAL(W * H / 2, hist.chroma_count);
+    CHECK_EQUAL(sum, hist.sum_y);
+    CHECK_EQUAL(2, hist.luma[11]);  /* (11, 0) and (1, 1) */
+    CHECK_EQUAL((sum + W * H / 2) / (W * H), histogram_mean(&hist));
+
+    /* U is 150 - x for the even x, V 100 + x for the odd x. */
+    histogram_mean_chroma(&hist, &u, &v);
+    CHECK_EQUAL(143, u);
+    CHECK_EQUAL(108, v);
+}
+
+TEST(HistogramTestGroup, GrayMatchesYuv422)
+{
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, H, NULL);
+    histogram_add_gray(&bands, &gray[0][0], W, 0, H, NULL);
+
+    MEMCMP_EQUAL(hist.luma, bands.luma, sizeof(hist.luma));
+    CHECK_EQUAL(hist.sum_y, bands.sum_y);
+    CHECK_EQUAL(0, bands.chroma_count);
+}
+
+TEST(HistogramTestGroup, BandsGiveTheSameStatistics)
+{
+    const histogram_roi_t roi = {3, 2, 8, 5};
+
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, H, &roi);
+    histogram_add_yuv422(&bands, &yuv[0][0], W, 0, 4, &roi);
+    histogram_add_yuv422(&bands, &yuv[4][0], W, 4, 4, &roi);
+    histogram_add_yuv422(&bands, &yuv[8][0], W, 8, 2, &roi);
+
+    MEMCMP_EQUAL(&hist, &bands, sizeof(hist));
+}
+
+TEST(HistogramTestGroup, RegionIsWidenedToPixelPairs)
+{
+    const histogram_roi_t roi = {3, 2, 8, 5};
+
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, H, &roi);
+    histogram_add_gray(&bands, &gray[0][0], W, 0, H, &roi);
+
+    /* Columns 2 to 11 for YUV422, 3 to 10 for greyscale. */
+    CHECK_EQUAL(10 * 5, hist.count);
+    CHECK_EQUAL(8 * 5, bands.count);
+    CHECK_EQUAL(1, hist.luma[2 + 10 * 2]);
+    CHECK_EQUAL(0, bands.luma[2 + 10 * 2]);
+    CHECK_EQUAL(0, hist.luma[2 + 10 * 7]);
+}
+
+TEST(HistogramTestGroup, RegionOutsideTheRowsIsIgnored)
+{
+    const histogram_roi_t roi = {0, 8, W, 2};
+    const histogram_roi_t outside = {W, 0, 4, 4};
+
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, 4, &roi);
+    histogram_add_yuv422(&hist, &yuv[0][0], W, 0, H, &outside);
+    CHECK_EQUAL(0, hist.count);
+    CHECK_EQUAL(0, histogram_mean(&hist));
+}
+
+TEST(HistogramTestGroup, Percentiles)
+{
+    const uint16_t permilles[] = {0, 1, 250, 500, 900, 999, 1000};
+    unsigned i, value, below;
+    int x, y;
+
+    histogram_add_gray(&hist, &gray[0][0], W, 0, H, NULL);
+
+    for (i = 0; i < sizeof(permilles) / sizeof(permilles[0]); i++) {
+        for (value = 0; value < 256; value++) {
+            below = 0;
+            for (y = 0; y < H; y++) {
+                for (x = 0; x < W; x++) {
+                    below += gray[y][x] <= value;
+                }
+            }
+            if (below * 1000 >= (unsigned)W * H * permilles[i]) {
+                break;
+            }
+        }
+        CHECK_EQUAL(value, histogram_percentile(&hist, permilles[i]));
+    }
+    CHECK_EQUAL(10 * (H - 1) + W - 1, histogram_percentile(&hist, 1000));
+}
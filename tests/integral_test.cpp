@@ -0,0 +1,126 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/integral.h"
+#include "random_fill.h"
+
+#define W 23
+#define H 17
+
+TEST_GROUP(IntegralTestGroup)
+{
+    uint8_t image[H][W];
+    uint32_t arena[(W + 1) * (H + 1)];
+    integral_t ii;
+
+    void setup()
+    {
+        random_fill(image, sizeof(image), 3);
+    }
+
+    uint32_t brute_sum(int x, int y, int w, int h)
+    {
+        uint32_t sum = 0;
+
+        for (int j = y; j < y + h; j++) {
+            for (int i = x; i < x + w; i++) {
+                sum += image[j][i];
+            }
+        }
+        return sum;
+    }
+};
+
+TEST(IntegralTestGroup, ArenaSize)
+{
+    CHECK_EQUAL((W + 1) * 4 * sizeof(uint32_t), integral_arena_size(W, 4));
+    CHECK_FALSE(integral_init(&ii, W, 4, arena, integral_arena_size(W, 4) - 1));
+    CHECK_FALSE(integral_init(&ii, W, 1, arena, sizeof(arena)));
+    CHECK_TRUE(integral_init(&ii, W, 4, arena, integral_arena_size(W, 4)));
+}
+
+TEST(IntegralTestGroup, FullImageRectSums)
+{
+    int x, y, w, h;
+
+    CHECK_TRUE(integral_init(&ii, W, H + 1, arena, sizeof(arena)));
+    integral_add_rows(&ii, &image[0][0], W, H);
+    CHECK_EQUAL(0, integral_first_row(&ii));
+
+    for (y = 0; y < H; y += 3) {
+        for (x = 0; x < W; x += 4) {
+            for (h = 1; y + h <= H; h += 5) {
+                for (w = 1; x + w <= W; w += 3) {
+                    CHECK_EQUAL(brute_sum(x, y, w, h), integral_rect_sum(&ii, x, y, w, h));
+                }
+            }
+        }
+    }
+}
+
+TEST(IntegralTestGroup, RingKeepsLastRows)
+{
+    int y;
+
+    /* 4 integral rows allow rectangles up to 3 rows high. */
+    CHECK_TRUE(integral_init(&ii, W, 4, arena, sizeof(arena)));
+
+    for (y = 0; y < H; y++) {
+        integral_add_rows(&ii, &image[y][0], W, 1);
+        if (y >= 2) {
+            CHECK_EQUAL(y - 2, integral_first_row(&ii));
+            CHECK_EQUAL(brute_sum(0, y - 2, W, 3), integral_rect_sum(&ii, 0, y - 2, W, 3));
+            CHECK_EQUAL(brute_sum(5, y - 1, 7, 2), integral_rect_sum(&ii, 5, y - 1, 7, 2));
+        }
+    }
+}
+
+TEST(IntegralTestGroup, ResetStartsNewFrame)
+{
+    CHECK_TRUE(integral_init(&ii, W, 5, arena, sizeof(arena)));
+    integral_add_rows(&ii, &image[0][0], W, H);
+
+    integral_reset(&ii);
+    integral_add_rows(&ii, &image[3][0], W, 2);
+    CHECK_EQUAL(brute_sum(0, 3, W, 2), integral_rect_sum(&ii, 0, 0, W, 2));
+}
+
+TEST(IntegralTestGroup, BoxFilterMatchesBruteForce)
+{
+    uint8_t out[W];
+    int x, y, x0, x1, y0, y1, r = 2;
+    uint32_t area;
+
+    /* The ring is just large enough, rows are filtered once row y + r is in. */
+    CHECK_TRUE(integral_init(&ii, W, 2 * r + 2, arena, sizeof(arena)));
+
+    for (y = 0; y < H + r; y++) {
+        if (y < H) {
+            integral_add_rows(&ii, &image[y][0], W, 1);
+        }
+        if (y < r) {
+            continue;
+        }
+        integral_box_filter_row(&ii, y - r, r, out);
+
+        y0 = y - 2 * r < 0 ? 0 : y - 2 * r;
+        y1 = y + 1 > H ? H : y + 1;
+        for (x = 0; x < W; x++) {
+            x0 = x - r < 0 ? 0 : x - r;
+            x1 = x + r + 1 > W ? W : x + r + 1;
+            area = (x1 - x0) * (y1 - y0);
+            CHECK_EQUAL((brute_sum(x0, y0, x1 - x0, y1 - y0) + area / 2) / area, out[x]);
+        }
+    }
+}
+
+TEST(IntegralTestGroup, SaturatedFrameDoesNotOverflow)
+{
+    static uint8_t white[480][640];
+    static uint32_t big[641 * 481];
+
+    memset(white, 255, sizeof(white));
+    CHECK_TRUE(integral_init(&ii, 640, 481, big, sizeof(big)));
+    integral_add_rows(&ii, &white[0][0], 640, 480);
+    CHECK_EQUAL(255u * 640 * 480, integral_rect_sum(&ii, 0, 0, 640, 480));
+    CHECK_EQUAL(255u * 2 * 3, integral_rect_sum(&ii, 638, 477, 2, 3));
+}
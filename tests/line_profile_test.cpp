@@ -0,0 +1,161 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/line_profile.h"
+#include "random_fill.h"
+
+#define W 64
+#define H 6
+
+TEST_GROUP(LineProfileTestGroup)
+{
+    uint8_t gray[H][W];
+    uint8_t yuv[H][2 * W];
+    uint16_t profile[W];
+    line_t line;
+
+    void setup()
+    {
+        memset(&line, 0, sizeof(line));
+    }
+
+    /* Floor of luma 200 with a dark line of luma 40 covering [x0, x1),
+     * the pixels at the borders being partially covered. */
+    void render(float x0, float x1)
+    {
+        int x, y;
+        float cover;
+
+        for (x = 0; x < W; x++) {
+            cover = (x + 1 < x1 ? x + 1 : x1) - (x > x0 ? x : x0);
+            cover = cover < 0 ? 0 : cover;
+            for (y = 0; y < H; y++) {
+                gray[y][x] = (uint8_t)(200 - 160 * cover + 0.5f);
+            }
+        }
+        to_yuv422();
+    }
+
+    void to_yuv422()
+    {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                yuv[y][2 * x] = gray[y][x];
+                yuv[y][2 * x + 1] = x & 1 ? 90 : 170;
+            }
+        }
+    }
+};
+
+TEST(LineProfileTestGroup, SumsMatchReference)
+{
+    uint16_t ref[W + 1];
+    int width;
+
+    random_fill(gray, sizeof(gray), 5);
+    to_yuv422();
+
+    /* Widths which are not multiples of 4 take the scalar tail. */
+    for (width = W - 3; width <= W; width++) {
+        line_profile_sum_gray_ref(&gray[0][0], width, H - 1, ref);
+        line_profile_sum_gray(&gray[0][0], width, H - 1, profile);
+        MEMCMP_EQUAL(ref, profile, width * sizeof(profile[0]));
+    }
+
+    line_profile_sum_yuv422_ref(&yuv[0][0], W, H, ref);
+    line_profile_sum_yuv422(&yuv[0][0], W, H, profile);
+    MEMCMP_EQUAL(ref, profile, sizeof(profile));
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    MEMCMP_EQUAL(ref, profile, sizeof(profile));
+}
+
+TEST(LineProfileTestGroup, MaximumRowsDoNotOverflow)
+{
+    static uint8_t white[LINE_PROFILE_MAX_ROWS][8];
+
+    memset(white, 255, sizeof(white));
+    line_profile_sum_gray(&white[0][0], 8, LINE_PROFILE_MAX_ROWS, profile);
+    CHECK_EQUAL(255 * LINE_PROFILE_MAX_ROWS, profile[7]);
+}
+
+TEST(LineProfileTestGroup, SharpLineIsCentred)
+{
+    render(20, 30);
+    line_profile_sum_yuv422(&yuv[0][0], W, H, profile);
+
+    CHECK_TRUE(line_profile_find(profile, W, 100, true, &line));
+    /* The edges lie between pixels 19 and 20, and 29 and 30. */
+    CHECK_EQUAL(19 * LINE_PROFILE_SCALE + LINE_PROFILE_SCALE / 2, line.left);
+    CHECK_EQUAL(29 * LINE_PROFILE_SCALE + LINE_PROFILE_SCALE / 2, line.right);
+    CHECK_EQUAL(24 * LINE_PROFILE_SCALE + LINE_PROFILE_SCALE / 2, line.centre);
+    CHECK_EQUAL(160 * H, line.contrast);
+}
+
+TEST(LineProfileTestGroup, SubPixelPositions)
+{
+    float x0;
+
+    /* A quarter pixel resolution at least, as the line moves. */
+    for (x0 = 10; x0 < 12; x0 += 0.25f) {
+        render(x0, x0 + 7.5f);
+        line_profile_sum_gray(&gray[0][0], W, H, profile);
+        CHECK_TRUE(line_profile_find(profile, W, 100, true, &line));
+        CHECK((line.centre - (x0 + 3.75f - 0.5f) * LINE_PROFILE_SCALE) <= LINE_PROFILE_SCALE / 4);
+        CHECK((line.centre - (x0 + 3.75f - 0.5f) * LINE_PROFILE_SCALE) >= -LINE_PROFILE_SCALE / 4);
+    }
+}
+
+TEST(LineProfileTestGroup, BrightLine)
+{
+    int x, y;
+
+    render(40, 44);
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            gray[y][x] = 240 - gray[y][x];
+        }
+    }
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+
+    CHECK_FALSE(line_profile_find(profile, W, 100, true, &line));
+    CHECK_TRUE(line_profile_find(profile, W, 100, false, &line));
+    CHECK_EQUAL(41 * LINE_PROFILE_SCALE + LINE_PROFILE_SCALE / 2, line.centre);
+}
+
+TEST(LineProfileTestGroup, WeakOrMissingLineIsRejected)
+{
+    render(20, 30);
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_FALSE(line_profile_find(profile, W, 160 * H + 1, true, &line));
+
+    /* Only one edge in view. */
+    render(50, W + 10);
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_FALSE(line_profile_find(profile, W, 100, true, &line));
+
+    render(W + 1, W + 2);
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_FALSE(line_profile_find(profile, W, 1, true, &line));
+}
+
+TEST(LineProfileTestGroup, ZeroMinimumStepNeedsBothEdges)
+{
+    /* A line, then a stronger falling step with nothing rising after it:
+     * the end of the first line must not be paired with the later start. */
+    render(10, 20);
+    for (int y = 0; y < H; y++) {
+        for (int x = 40; x < W; x++) {
+            gray[y][x] = 0;
+        }
+    }
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_FALSE(line_profile_find(profile, W, 0, true, &line));
+
+    render(W + 1, W + 2);
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_FALSE(line_profile_find(profile, W, 0, true, &line));
+
+    render(10, 20);
+    line_profile_sum_gray(&gray[0][0], W, H, profile);
+    CHECK_TRUE(line_profile_find(profile, W, 0, true, &line));
+    CHECK(line.right > line.left);
+}
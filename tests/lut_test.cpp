@@ -0,0 +1,148 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include <math.h>
+#include "vision/lut.h"
+#include "random_fill.h"
+
+#define PIXELS 103
+
+TEST_GROUP(LutTestGroup)
+{
+    uint8_t lut[LUT_SIZE];
+    uint8_t image[2 * PIXELS], expected[2 * PIXELS];
+    histogram_t hist;
+
+    void setup()
+    {
+        unsigned i;
+
+        fill_image();
+        for (i = 0; i < LUT_SIZE; i++) {
+            lut[i] = 255 - i / 2;
+        }
+        histogram_reset(&hist);
+    }
+
+    void fill_image()
+    {
+        random_fill(image, sizeof(image), 11);
+        memcpy(expected, image, sizeof(image));
+    }
+};
+
+TEST(LutTestGroup, ApplyMatchesReference)
+{
+    uint32_t pixels;
+
+    /* Lengths which are not multiples of 4 take the scalar tail, and an
+     * odd start is not word aligned. */
+    for (pixels = PIXELS - 4; pixels <= PIXELS; pixels++) {
+        fill_image();
+        lut_apply_ref(lut, &expected[1], pixels);
+        lut_apply(lut, &image[1], pixels);
+        MEMCMP_EQUAL(expected, image, sizeof(image));
+    }
+}
+
+TEST(LutTestGroup, Yuv422MatchesReference)
+{
+    lut_apply_yuv422_ref(lut, expected, PIXELS - 1);
+    lut_apply_yuv422(lut, image, PIXELS - 1);
+    MEMCMP_EQUAL(expected, image, sizeof(image));
+}
+
+TEST(LutTestGroup, Yuv422RemapsOnlyTheLuma)
+{
+    unsigned i;
+
+    lut_apply_yuv422(lut, image, PIXELS - 1);
+    for (i = 0; i < PIXELS - 1; i++) {
+        CHECK_EQUAL(lut[expected[2 * i]], image[2 * i]);
+        CHECK_EQUAL(expected[2 * i + 1], image[2 * i + 1]);
+    }
+}
+
+TEST(LutTestGroup, GeneratedTablesFollowTheirCurves)
+{
+    unsigned i;
+
+    for (i = 0; i < LUT_SIZE; i++) {
+        CHECK_EQUAL((int)floor(255 * pow(i / 255.0, 1 / 2.2) + 0.5), lut_gamma_0_45[i]);
+        CHECK_EQUAL((int)floor(255 * pow(i / 255.0, 2.2) + 0.5), lut_gamma_2_2[i]);
+        if (i > 0) {
+            CHECK(lut_s_curve[i] >= lut_s_curve[i - 1]);
+        }
+    }
+    CHECK_EQUAL(0, lut_s_curve[0]);
+    CHECK_EQUAL(255, lut_s_curve[255]);
+    CHECK(lut_s_curve[64] < 64);
+    CHECK(lut_s_curve[192] > 192);
+}
+
+TEST(LutTestGroup, ThresholdAndStretch)
+{
+    lut_build_threshold(lut, 100);
+    CHECK_EQUAL(0, lut[99]);
+    CHECK_EQUAL(255, lut[100]);
+
+    lut_build_stretch(lut, 50, 100);
+    CHECK_EQUAL(0, lut[0]);
+    CHECK_EQUAL(0, lut[50]);
+    CHECK_EQUAL(128, lut[75]);
+    CHECK_EQUAL(255, lut[100]);
+    CHECK_EQUAL(255, lut[200]);
+}
+
+TEST(LutTestGroup, AutoContrastIgnoresOutliers)
+{
+    uint8_t gray[100];
+    unsigned i;
+
+    /* Values 60 to 139, plus a black and a white pixel. */
+    for (i = 0; i < 100; i++) {
+        gray[i] = 60 + i % 80;
+    }
+    gray[0] = 0;
+    gray[1] = 255;
+    histogram_add_gray(&hist, gray, 100, 0, 1, NULL);
+
+    lut_build_auto_contrast(lut, &hist, 20);
+    CHECK(lut[62] < 8);
+    CHECK(lut[138] > 247);
+
+    histogram_reset(&hist);
+    memset(gray, 77, sizeof(gray));
+    histogram_add_gray(&hist, gray, 100, 0, 1, NULL);
+    lut_build_auto_contrast(lut, &hist, 20);
+    CHECK_EQUAL(77, lut[77]);
+}
+
+TEST(LutTestGroup, EqualizationFlattensTheHistogram)
+{
+    static uint8_t gray[64 * 64];
+    histogram_t after;
+    unsigned i, changed = 0;
+
+    /* Dark image with a narrow range, quadratic distribution. */
+    for (i = 0; i < sizeof(gray); i++) {
+        gray[i] = 20 + (i * i) / (sizeof(gray) * sizeof(gray) / 64);
+    }
+    histogram_add_gray(&hist, gray, sizeof(gray), 0, 1, NULL);
+    lut_build_equalize(lut, &hist);
+    lut_apply(lut, gray, sizeof(gray));
+
+    histogram_reset(&after);
+    histogram_add_gray(&after, gray, sizeof(gray), 0, 1, NULL);
+    CHECK_EQUAL(0, histogram_percentile(&after, 0));
+    CHECK_EQUAL(255, histogram_percentile(&after, 1000));
+    CHECK(histogram_mean(&after) > 110 && histogram_mean(&after) < 145);
+
+    /* A constant image is left as it is. */
+    histogram_reset(&hist);
+    hist.luma[42] = hist.count = 10;
+    lut_build_equalize(lut, &hist);
+    for (i = 0; i < LUT_SIZE; i++) {
+        changed += lut[i] != i;
+    }
+    CHECK_EQUAL(0, changed);
+}
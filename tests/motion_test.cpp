@@ -0,0 +1,145 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/motion.h"
+#include "random_fill.h"
+
+/* 4 x 3 tiles once decimated. */
+#define W (2 * 4 * MOTION_TILE_SIZE)
+#define H (2 * 3 * MOTION_TILE_SIZE)
+
+TEST_GROUP(MotionTestGroup)
+{
+    uint8_t gray[H][W];
+    uint8_t yuv[H][2 * W];
+    uint32_t arena[(W / 2 * H / 2 * 2 + 2 * W) / 4];
+    motion_t motion;
+
+    void setup()
+    {
+        memset(gray, 100, sizeof(gray));
+        CHECK_TRUE(motion_init(&motion, W, H, (uint8_t *)arena, sizeof(arena)));
+    }
+
+    void square(int x0, int y0, int size, uint8_t value)
+    {
+        for (int y = y0; y < y0 + size; y++) {
+            for (int x = x0; x < x0 + size; x++) {
+                gray[y][x] = value;
+            }
+        }
+    }
+
+    uint16_t detect()
+    {
+        motion_decimate_gray(&motion, &gray[0][0], W);
+        return motion_detect(&motion);
+    }
+};
+
+TEST(MotionTestGroup, ArenaAndTileLimits)
+{
+    CHECK_EQUAL(sizeof(arena), motion_arena_size(W, H));
+    CHECK_FALSE(motion_init(&motion, W, H, (uint8_t *)arena, sizeof(arena) - 1));
+    CHECK_EQUAL(4, motion.tiles_x);
+    CHECK_EQUAL(3, motion.tiles_y);
+
+    static uint32_t big[(1024 * 1024 / 2) / 4];
+    /* 32 x 32 tiles */
+    CHECK_FALSE(motion_init(&motion, 32 * 2 * MOTION_TILE_SIZE, 32 * 2 * MOTION_TILE_SIZE, (uint8_t *)big, sizeof(big)));
+}
+
+TEST(MotionTestGroup, SadMatchesReference)
+{
+    uint8_t a[MOTION_TILE_SIZE * 11], b[MOTION_TILE_SIZE * 11];
+
+    random_fill(a, sizeof(a), 5);
+    random_fill(b, sizeof(b), 6);
+    /* Odd stride, so loads are unaligned. */
+    CHECK_EQUAL(motion_tile_sad_ref(a + 1, b + 3, 11), motion_tile_sad(a + 1, b + 3, 11));
+}
+
+TEST(MotionTestGroup, FirstFrameIsBackground)
+{
+    CHECK_EQUAL(0, detect());
+    CHECK_EQUAL(0, detect());
+}
+
+TEST(MotionTestGroup, ChangedTileIsActive)
+{
+    detect();
+
+    /* A square covering decimated tile (2, 1) only. */
+    square(2 * 2 * MOTION_TILE_SIZE, 2 * MOTION_TILE_SIZE, 2 * MOTION_TILE_SIZE, 200);
+    CHECK_EQUAL(1, detect());
+    CHECK_TRUE(motion_tile_active(&motion, 1 * 4 + 2));
+    CHECK_FALSE(motion_tile_active(&motion, 1 * 4 + 1));
+}
+
+TEST(MotionTestGroup, SmallChangesAreIgnored)
+{
+    detect();
+
+    /* Mean difference of 10, below the default threshold. */
+    memset(gray, 110, sizeof(gray));
+    CHECK_EQUAL(0, detect());
+}
+
+TEST(MotionTestGroup, BackgroundLearnsStaticChange)
+{
+    int frames = 0;
+
+    motion.learning_shift = 1;
+    detect();
+    memset(gray, 200, sizeof(gray));
+    while (detect() > 0) {
+        frames++;
+        CHECK(frames < 10);
+    }
+    /* Differences of 100, 50 and 25, then 12 which is not above the
+     * threshold, the halvings being rounded. */
+    CHECK_EQUAL(3, frames);
+    CHECK_EQUAL(0, motion.active_tiles);
+}
+
+TEST(MotionTestGroup, BackgroundFollowsSmallSteps)
+{
+    int frames;
+
+    /* Steps smaller than 2^learning_shift used to be learnt downwards only. */
+    motion.learning_shift = MOTION_DEFAULT_LEARNING_SHIFT;
+    motion.threshold = 5;
+    memset(gray, 100, sizeof(gray));
+    detect();
+
+    memset(gray, 107, sizeof(gray));
+    for (frames = 0; frames < 50 && detect() > 0; frames++) {
+    }
+    CHECK(frames < 50);
+    CHECK(motion.background[0] >= 107 - (1 << (MOTION_DEFAULT_LEARNING_SHIFT - 1)));
+
+    memset(gray, 100, sizeof(gray));
+    for (frames = 0; frames < 50 && detect() > 0; frames++) {
+    }
+    CHECK(frames < 50);
+    CHECK(motion.background[0] <= 100 + (1 << (MOTION_DEFAULT_LEARNING_SHIFT - 1)));
+}
+
+TEST(MotionTestGroup, YUVDecimationMatchesGray)
+{
+    uint8_t expected[W / 2 * H / 2];
+    int x, y;
+
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            gray[y][x] = x * 3 + y;
+            yuv[y][2 * x] = gray[y][x];
+            yuv[y][2 * x + 1] = 0x55;
+        }
+    }
+    motion_decimate_gray(&motion, &gray[0][0], W);
+    memcpy(expected, motion.current, sizeof(expected));
+    memset(motion.current, 0, sizeof(expected));
+
+    motion_decimate_yuv422(&motion, &yuv[0][0]);
+    MEMCMP_EQUAL(expected, motion.current, sizeof(expected));
+}
@@ -0,0 +1,453 @@
+#include <CppUTest/TestHarness.h>
+#include <cstring>
+#include "camera/po8030_regcache.h"
+
+// Simulated sensor counting the I2C transactions it receives.
+struct FakeSensor {
+    uint8_t bank;
+    uint8_t regs[PO8030_REGCACHE_BANKS][256];
+    int writes;
+    int reads;
+    int bursts;
+    int8_t error;
+};
+
+static int8_t fake_write(void *arg, uint8_t reg, uint8_t value)
+{
+    FakeSensor *s = (FakeSensor *)arg;
+    if (s->error) {
+        return s->error;
+    }
+    s->writes++;
+    if (reg == PO8030_REGCACHE_BANK_REG) {
+        s->bank = value;
+    } else {
+        s->regs[s->bank][reg] = value;
+    }
+    return 0;
+}
+
+static int8_t fake_write_burst(void *arg, uint8_t reg, const uint8_t *values, uint8_t n)
+{
+    FakeSensor *s = (FakeSensor *)arg;
+    if (s->error) {
+        return s->error;
+    }
+    s->bursts++;
+    for (int i = 0; i < n; i++) {
+        s->regs[s->bank][reg + i] = values[i];
+    }
+    return 0;
+}
+
+static int8_t fake_read(void *arg, uint8_t reg, uint8_t *value)
+{
+    FakeSensor *s = (FakeSensor *)arg;
+    if (s->error) {
+        return s->error;
+    }
+    s->reads++;
+    *value = s->regs[s->bank][reg];
+    return 0;
+}
+
+TEST_GROUP(PO8030RegCacheTestGroup)
+{
+    FakeSensor sensor;
+    po8030_regcache_t cache;
+
+    void setup()
+    {
+        memset(&sensor, 0, sizeof(sensor));
+        po8030_bus_t bus = {fake_write, fake_read, NULL, &sensor};
+        po8030_regcache_init(&cache, &bus);
+    }
+};
+
+TEST(PO8030RegCacheTestGroup, FirstBankSelectionGoesOnTheBus)
+{
+    po8030_regcache_select_bank(&cache, 1);
+
+    CHECK_EQUAL(1, sensor.writes);
+    CHECK_EQUAL(1, sensor.bank);
+    CHECK_EQUAL(1, cache.misses);
+}
+
+TEST(PO8030RegCacheTestGroup, RedundantBankSwitchIsSkipped)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_select_bank(&cache, 1);
+
+    CHECK_EQUAL(1, sensor.writes);
+    CHECK_EQUAL(1, cache.hits);
+}
+
+TEST(PO8030RegCacheTestGroup, WritingBankRegisterSelectsBank)
+{
+    po8030_regcache_write(&cache, PO8030_REGCACHE_BANK_REG, 2);
+    CHECK_EQUAL(2, cache.bank);
+
+    po8030_regcache_select_bank(&cache, 2);
+    CHECK_EQUAL(1, sensor.writes);
+}
+
+TEST(PO8030RegCacheTestGroup, SameValueWriteIsSkipped)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x9E, 42);
+    po8030_regcache_write(&cache, 0x9E, 42);
+
+    CHECK_EQUAL(2, sensor.writes);
+    CHECK_EQUAL(42, sensor.regs[1][0x9E]);
+}
+
+TEST(PO8030RegCacheTestGroup, DifferentValueIsWritten)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x9E, 42);
+    po8030_regcache_write(&cache, 0x9E, 43);
+
+    CHECK_EQUAL(3, sensor.writes);
+    CHECK_EQUAL(43, sensor.regs[1][0x9E]);
+}
+
+TEST(PO8030RegCacheTestGroup, BanksAreShadowedSeparately)
+{
+    po8030_regcache_select_bank(&cache, 0);
+    po8030_regcache_write(&cache, 0x10, 1);
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x10, 1);
+
+    CHECK_EQUAL(4, sensor.writes);
+    CHECK_EQUAL(1, sensor.regs[0][0x10]);
+    CHECK_EQUAL(1, sensor.regs[1][0x10]);
+}
+
+TEST(PO8030RegCacheTestGroup, ReadIsServedFromShadow)
+{
+    uint8_t value;
+    sensor.regs[2][0x04] = 0x5A;
+    po8030_regcache_select_bank(&cache, 2);
+
+    po8030_regcache_read(&cache, 0x04, &value);
+    po8030_regcache_read(&cache, 0x04, &value);
+
+    CHECK_EQUAL(0x5A, value);
+    CHECK_EQUAL(1, sensor.reads);
+}
+
+TEST(PO8030RegCacheTestGroup, WrittenValueIsReadBackFromShadow)
+{
+    uint8_t value;
+    po8030_regcache_select_bank(&cache, 2);
+    po8030_regcache_write(&cache, 0x04, 0x07);
+
+    po8030_regcache_read(&cache, 0x04, &value);
+
+    CHECK_EQUAL(0x07, value);
+    CHECK_EQUAL(0, sensor.reads);
+}
+
+TEST(PO8030RegCacheTestGroup, UnknownBankIsNeverCached)
+{
+    uint8_t value;
+    po8030_regcache_write(&cache, 0x10, 1);
+    po8030_regcache_write(&cache, 0x10, 1);
+    po8030_regcache_read(&cache, 0x10, &value);
+
+    CHECK_EQUAL(2, sensor.writes);
+    CHECK_EQUAL(1, sensor.reads);
+}
+
+TEST(PO8030RegCacheTestGroup, SharedRegistersAreNotCached)
+{
+    uint8_t value;
+    po8030_regcache_select_bank(&cache, 0);
+    po8030_regcache_read(&cache, 0x00, &value);
+    po8030_regcache_read(&cache, 0x00, &value);
+
+    CHECK_EQUAL(2, sensor.reads);
+}
+
+TEST(PO8030RegCacheTestGroup, UncachedRegistersAlwaysGoOnTheBus)
+{
+    uint8_t value;
+    po8030_regcache_mark_uncached(&cache, 0, 0x17);
+    po8030_regcache_select_bank(&cache, 0);
+
+    po8030_regcache_write(&cache, 0x17, 1);
+    po8030_regcache_write(&cache, 0x17, 1);
+    po8030_regcache_read(&cache, 0x17, &value);
+
+    CHECK_EQUAL(3, sensor.writes);
+    CHECK_EQUAL(1, sensor.reads);
+}
+
+TEST(PO8030RegCacheTestGroup, InvalidateForgetsEverything)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x9E, 42);
+
+    po8030_regcache_invalidate(&cache);
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x9E, 42);
+
+    CHECK_EQUAL(4, sensor.writes);
+}
+
+TEST(PO8030RegCacheTestGroup, FailedBankSwitchMakesBankUnknown)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    sensor.error = -1;
+
+    CHECK_EQUAL(-1, po8030_regcache_select_bank(&cache, 2));
+    CHECK_EQUAL(PO8030_REGCACHE_BANK_UNKNOWN, cache.bank);
+}
+
+TEST(PO8030RegCacheTestGroup, FailedWriteIsNotShadowed)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_write(&cache, 0x9E, 42);
+
+    sensor.error = -1;
+    CHECK_EQUAL(-1, po8030_regcache_write(&cache, 0x9E, 43));
+
+    sensor.error = 0;
+    po8030_regcache_write(&cache, 0x9E, 42);
+    CHECK_EQUAL(3, sensor.writes);
+}
+
+TEST(PO8030RegCacheTestGroup, StatsCanBeReset)
+{
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_select_bank(&cache, 1);
+    po8030_regcache_reset_stats(&cache);
+
+    CHECK_EQUAL(0, cache.hits);
+    CHECK_EQUAL(0, cache.misses);
+}
+
+TEST_GROUP(PO8030RegTableTestGroup)
+{
+    FakeSensor sensor;
+    po8030_regcache_t cache;
+
+    void setup()
+    {
+        memset(&sensor, 0, sizeof(sensor));
+        po8030_bus_t bus = {fake_write, fake_read, fake_write_burst, &sensor};
+        po8030_regcache_init(&cache, &bus);
+    }
+
+    void use_single_writes()
+    {
+        cache.bus.write_burst = NULL;
+    }
+};
+
+TEST(PO8030RegTableTestGroup, EmptyTableDoesNothing)
+{
+    CHECK_EQUAL(0, po8030_regcache_apply(&cache, NULL, 0));
+    CHECK_EQUAL(0, sensor.writes + sensor.bursts);
+}
+
+TEST(PO8030RegTableTestGroup, TableIsAppliedToTheRightBanks)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {1, 0x93, 0x20},
+        {2, 0x04, 0x07},
+    };
+
+    CHECK_EQUAL(0, po8030_regcache_apply(&cache, table, 3));
+
+    CHECK_EQUAL(0x01, sensor.regs[0][0x08]);
+    CHECK_EQUAL(0x20, sensor.regs[1][0x93]);
+    CHECK_EQUAL(0x07, sensor.regs[2][0x04]);
+    CHECK_EQUAL(2, sensor.bank);
+}
+
+TEST(PO8030RegTableTestGroup, BankSwitchesAreCoalesced)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {0, 0x20, 0x02},
+        {0, 0x30, 0x03},
+    };
+    use_single_writes();
+
+    po8030_regcache_apply(&cache, table, 3);
+
+    // One bank switch and three register writes
+    CHECK_EQUAL(4, sensor.writes);
+}
+
+TEST(PO8030RegTableTestGroup, ConsecutiveRegistersAreBurstWritten)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x00},
+        {0, 0x09, 0x01},
+        {0, 0x0A, 0x00},
+        {0, 0x0B, 0x01},
+    };
+
+    po8030_regcache_apply(&cache, table, 4);
+
+    CHECK_EQUAL(1, sensor.bursts);
+    CHECK_EQUAL(1, sensor.writes); // Bank switch
+    CHECK_EQUAL(0x01, sensor.regs[0][0x0B]);
+}
+
+TEST(PO8030RegTableTestGroup, BurstsAreSplitOnGaps)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x01},
+        {0, 0x35, 0x01},
+        {0, 0x36, 0x01},
+    };
+
+    po8030_regcache_apply(&cache, table, 4);
+
+    CHECK_EQUAL(2, sensor.bursts);
+}
+
+TEST(PO8030RegTableTestGroup, BurstsAreSplitOnBankChange)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x01},
+        {1, 0x0A, 0x01},
+        {1, 0x0B, 0x01},
+    };
+
+    po8030_regcache_apply(&cache, table, 4);
+
+    CHECK_EQUAL(2, sensor.bursts);
+    CHECK_EQUAL(0x01, sensor.regs[1][0x0A]);
+    CHECK_EQUAL(0x00, sensor.regs[0][0x0A]);
+}
+
+TEST(PO8030RegTableTestGroup, BurstsAreLimitedInSize)
+{
+    po8030_reg_t table[PO8030_REGCACHE_MAX_BURST + 1];
+    for (int i = 0; i < PO8030_REGCACHE_MAX_BURST + 1; i++) {
+        table[i].bank = 0;
+        table[i].reg = 0x10 + i;
+        table[i].value = 1;
+    }
+
+    po8030_regcache_apply(&cache, table, PO8030_REGCACHE_MAX_BURST + 1);
+
+    CHECK_EQUAL(1, sensor.bursts);
+    CHECK_EQUAL(2, sensor.writes); // Bank switch and last register
+    CHECK_EQUAL(1, sensor.regs[0][0x10 + PO8030_REGCACHE_MAX_BURST]);
+}
+
+TEST(PO8030RegTableTestGroup, ReapplyingTableIsFree)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x02},
+        {1, 0x93, 0x20},
+    };
+
+    po8030_regcache_apply(&cache, table, 3);
+    int transactions = sensor.writes + sensor.bursts;
+    po8030_regcache_apply(&cache, table, 3);
+
+    // Only the switch back to the first bank is needed
+    CHECK_EQUAL(transactions + 2, sensor.writes + sensor.bursts);
+}
+
+TEST(PO8030RegTableTestGroup, BurstIsTrimmedToChangedRegisters)
+{
+    const po8030_reg_t first[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x02},
+        {0, 0x0A, 0x03},
+        {0, 0x0B, 0x04},
+    };
+    const po8030_reg_t second[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x05},
+        {0, 0x0A, 0x06},
+        {0, 0x0B, 0x04},
+    };
+
+    po8030_regcache_apply(&cache, first, 4);
+    sensor.regs[0][0x08] = 0xAA; // Would be overwritten if not trimmed
+    sensor.regs[0][0x0B] = 0xAA;
+    po8030_regcache_apply(&cache, second, 4);
+
+    CHECK_EQUAL(2, sensor.bursts);
+    CHECK_EQUAL(0xAA, sensor.regs[0][0x08]);
+    CHECK_EQUAL(0x05, sensor.regs[0][0x09]);
+    CHECK_EQUAL(0x06, sensor.regs[0][0x0A]);
+    CHECK_EQUAL(0xAA, sensor.regs[0][0x0B]);
+}
+
+TEST(PO8030RegTableTestGroup, SingleChangedRegisterIsNotBurst)
+{
+    const po8030_reg_t first[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x02},
+    };
+    const po8030_reg_t second[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x03},
+    };
+
+    po8030_regcache_apply(&cache, first, 2);
+    po8030_regcache_apply(&cache, second, 2);
+
+    CHECK_EQUAL(1, sensor.bursts);
+    CHECK_EQUAL(2, sensor.writes);
+    CHECK_EQUAL(2, cache.hits); // Register 0x08 and the bank selection
+}
+
+TEST(PO8030RegTableTestGroup, UncachedRegistersAreAlwaysWritten)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x17, 0x00},
+        {0, 0x18, 0x80},
+        {0, 0x19, 0x00},
+    };
+    po8030_regcache_mark_uncached(&cache, 0, 0x18);
+
+    po8030_regcache_apply(&cache, table, 3);
+    po8030_regcache_apply(&cache, table, 3);
+
+    CHECK_EQUAL(1, sensor.bursts);
+    CHECK_EQUAL(2, sensor.writes); // Bank switch and register 0x18
+}
+
+TEST(PO8030RegTableTestGroup, ErrorStopsTheTable)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {1, 0x93, 0x20},
+    };
+    use_single_writes();
+    sensor.error = -2;
+
+    CHECK_EQUAL(-2, po8030_regcache_apply(&cache, table, 2));
+    CHECK_EQUAL(0x00, sensor.regs[1][0x93]);
+}
+
+TEST(PO8030RegTableTestGroup, FailedBurstIsNotShadowed)
+{
+    const po8030_reg_t table[] = {
+        {0, 0x08, 0x01},
+        {0, 0x09, 0x02},
+    };
+
+    po8030_regcache_select_bank(&cache, 0);
+    sensor.error = -1;
+    CHECK_EQUAL(-1, po8030_regcache_apply(&cache, table, 2));
+
+    sensor.error = 0;
+    po8030_regcache_apply(&cache, table, 2);
+    CHECK_EQUAL(1, sensor.bursts);
+    CHECK_EQUAL(0x02, sensor.regs[0][0x09]);
+}
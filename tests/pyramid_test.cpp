@@ -0,0 +1,95 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/pyramid.h"
+#include "random_fill.h"
+
+#define W 43
+#define H 21
+
+TEST_GROUP(PyramidTestGroup)
+{
+    uint8_t image[H][W];
+    uint8_t out[(W / 2) * (H / 2) + 4], out_ref[(W / 2) * (H / 2) + 4];
+    uint8_t arena[512];
+    pyramid_t pyramid;
+
+    void setup()
+    {
+        random_fill(image, sizeof(image), 7);
+        memset(out, 0x55, sizeof(out));
+        memset(out_ref, 0x55, sizeof(out_ref));
+    }
+};
+
+TEST(PyramidTestGroup, ReferenceAveragesBlocks)
+{
+    const uint8_t block[] = {10, 20, 30, 41};
+
+    pyramid_downsample_ref(block, 2, 2, 2, out);
+    /* (10 + 30) / 2 = 20, (20 + 41) / 2 = 30, (20 + 30) / 2 = 25 */
+    CHECK_EQUAL(25, out[0]);
+    CHECK_EQUAL(0x55, out[1]);
+}
+
+TEST(PyramidTestGroup, SaturatedValuesDoNotOverflow)
+{
+    uint8_t white[4][16];
+
+    memset(white, 255, sizeof(white));
+    pyramid_downsample(&white[0][0], 16, 16, 4, out);
+    for (int i = 0; i < 16; i++) {
+        CHECK_EQUAL(255, out[i]);
+    }
+}
+
+TEST(PyramidTestGroup, SIMDMatchesReference)
+{
+    uint16_t w;
+
+    /* Every width exercises a different tail, with a wider stride. */
+    for (w = 2; w <= W; w++) {
+        pyramid_downsample_ref(&image[0][0], W, w, H, out_ref);
+        pyramid_downsample(&image[0][0], W, w, H, out);
+        MEMCMP_EQUAL(out_ref, out, sizeof(out));
+    }
+}
+
+TEST(PyramidTestGroup, ArenaSizeIsWordAligned)
+{
+    /* 21x10 -> 210 bytes rounded to 212, then 10x5 -> 50 rounded to 52 */
+    CHECK_EQUAL(0, pyramid_arena_size(W, H, 1));
+    CHECK_EQUAL(212, pyramid_arena_size(W, H, 2));
+    CHECK_EQUAL(264, pyramid_arena_size(W, H, 3));
+}
+
+TEST(PyramidTestGroup, BuildsEveryLevel)
+{
+    CHECK_TRUE(pyramid_build(&pyramid, &image[0][0], W, W, H, PYRAMID_MAX_LEVELS, arena, sizeof(arena)));
+    CHECK_EQUAL(PYRAMID_MAX_LEVELS, pyramid.num_levels);
+
+    POINTERS_EQUAL(&image[0][0], pyramid.level[0].data);
+    CHECK_EQUAL(21, pyramid.level[1].width);
+    CHECK_EQUAL(10, pyramid.level[1].height);
+    CHECK_EQUAL(10, pyramid.level[2].width);
+    CHECK_EQUAL(5, pyramid.level[2].height);
+    CHECK_EQUAL(5, pyramid.level[3].width);
+    CHECK_EQUAL(2, pyramid.level[3].height);
+
+    /* Each level is built from the previous one. */
+    pyramid_downsample_ref(&image[0][0], W, W, H, out_ref);
+    MEMCMP_EQUAL(out_ref, pyramid.level[1].data, 21 * 10);
+    pyramid_downsample_ref(pyramid.level[2].data, 10, 10, 5, out_ref);
+    MEMCMP_EQUAL(out_ref, pyramid.level[3].data, 5 * 2);
+}
+
+TEST(PyramidTestGroup, RefusesSmallArena)
+{
+    CHECK_FALSE(pyramid_build(&pyramid, &image[0][0], W, W, H, 3, arena, 263));
+    CHECK_TRUE(pyramid_build(&pyramid, &image[0][0], W, W, H, 3, arena, 264));
+}
+
+TEST(PyramidTestGroup, RefusesInvalidLevelCount)
+{
+    CHECK_FALSE(pyramid_build(&pyramid, &image[0][0], W, W, H, 0, arena, sizeof(arena)));
+    CHECK_FALSE(pyramid_build(&pyramid, &image[0][0], W, W, H, PYRAMID_MAX_LEVELS + 1, arena, sizeof(arena)));
+}
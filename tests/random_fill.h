@@ -0,0 +1,26 @@
+#ifndef RANDOM_FILL_H
+#define RANDOM_FILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Linear congruential generator, so that the test data is the same on
+ * every run and on every host. */
+static inline uint32_t random_next(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed;
+}
+
+/* Fills a buffer with pseudo random bytes. */
+static inline void random_fill(void *buffer, size_t size, uint32_t seed)
+{
+    uint8_t *p = (uint8_t *)buffer;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        p[i] = random_next(&seed) >> 16;
+    }
+}
+
+#endif /* RANDOM_FILL_H */
@@ -0,0 +1,247 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include <stdlib.h>
+#include "vision/rle_cc.h"
+#include "random_fill.h"
+
+#define W 40
+#define H 30
+#define MAX_RESULTS (W * H)
+
+static int compare_stats(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(rle_cc_stats_t));
+}
+
+static rle_cc_stats_t found[MAX_RESULTS];
+static int num_found;
+
+static void collect(void *arg, const rle_cc_stats_t *region)
+{
+    (void)arg;
+    found[num_found++] = *region;
+}
+
+TEST_GROUP(RleCCTestGroup)
+{
+    uint8_t image[H][W];
+    uint64_t arena[(RLE_CC_ARENA_SIZE(W, 64) + 7) / 8];
+    rle_cc_t cc;
+    bool complete;
+
+    void setup()
+    {
+        reset();
+    }
+
+    /* Clears the image and the results, and starts a new labelling. */
+    void reset()
+    {
+        memset(image, 0, sizeof(image));
+        memset(found, 0, sizeof(found));
+        num_found = 0;
+        CHECK_TRUE(rle_cc_init(&cc, arena, sizeof(arena), W, 64, collect, NULL));
+    }
+
+    /* Feeds the image, pixel values being the classes, 0 is background. */
+    void run(int rows)
+    {
+        int x, y, start;
+
+        for (y = 0; y < rows; y++) {
+            for (x = 0; x < W; x = start) {
+                start = x + 1;
+                if (image[y][x] == 0) {
+                    continue;
+                }
+                while (start < W && image[y][start] == image[y][x]) {
+                    start++;
+                }
+                rle_cc_add_run(&cc, x, start - 1, image[y][x]);
+            }
+            rle_cc_end_row(&cc);
+        }
+        complete = rle_cc_end_frame(&cc);
+    }
+
+    void random_image(uint32_t seed, int classes, int density)
+    {
+        for (unsigned i = 0; i < sizeof(image); i++) {
+            random_next(&seed);
+            (&image[0][0])[i] = ((seed >> 16) % 100) < (unsigned)density ? 1 + (seed >> 8) % classes : 0;
+        }
+    }
+
+    /* Flood fill reference, returns the regions sorted. */
+    int reference(rle_cc_stats_t *out)
+    {
+        static uint8_t seen[H][W];
+        static int stack[W * H];
+        int n = 0, x, y, top, p, px, py;
+        rle_cc_stats_t *s;
+
+        memset(seen, 0, sizeof(seen));
+        for (y = 0; y < H; y++) {
+            for (x = 0; x < W; x++) {
+                if (image[y][x] == 0 || seen[y][x]) {
+                    continue;
+                }
+                s = &out[n++];
+                memset(s, 0, sizeof(*s));
+                s->cls = image[y][x];
+                s->x_min = s->x_max = x;
+                s->y_min = s->y_max = y;
+                top = 0;
+                stack[top++] = y * W + x;
+                seen[y][x] = 1;
+                while (top > 0) {
+                    p = stack[--top];
+                    px = p % W;
+                    py = p / W;
+                    s->m00++;
+                    s->m10 += px;
+                    s->m01 += py;
+                    s->m20 += px * px;
+                    s->m02 += py * py;
+                    s->m11 += px * py;
+                    if (px < s->x_min) s->x_min = px;
+                    if (px > s->x_max) s->x_max = px;
+                    if (py < s->y_min) s->y_min = py;
+                    if (py > s->y_max) s->y_max = py;
+                    const int nx[4] = {px - 1, px + 1, px, px};
+                    const int ny[4] = {py, py, py - 1, py + 1};
+                    for (int k = 0; k < 4; k++) {
+                        if (nx[k] >= 0 && nx[k] < W && ny[k] >= 0 && ny[k] < H &&
+                            !seen[ny[k]][nx[k]] && image[ny[k]][nx[k]] == s->cls) {
+                            seen[ny[k]][nx[k]] = 1;
+                            stack[top++] = ny[k] * W + nx[k];
+                        }
+                    }
+                }
+            }
+        }
+        qsort(out, n, sizeof(*out), compare_stats);
+        return n;
+    }
+};
+
+TEST(RleCCTestGroup, RefusesSmallArena)
+{
+    CHECK_FALSE(rle_cc_init(&cc, arena, RLE_CC_ARENA_SIZE(8, 16) - 1, 8, 16, collect, NULL));
+    CHECK_TRUE(rle_cc_init(&cc, arena, RLE_CC_ARENA_SIZE(8, 16), 8, 16, collect, NULL));
+    CHECK_FALSE(rle_cc_init(&cc, arena, sizeof(arena), 8, 0, collect, NULL));
+}
+
+TEST(RleCCTestGroup, RectangleMoments)
+{
+    int x, y;
+
+    /* 3x2 rectangle at (2, 4) */
+    for (y = 4; y < 6; y++) {
+        for (x = 2; x < 5; x++) {
+            image[y][x] = 1;
+        }
+    }
+    run(H);
+
+    CHECK_EQUAL(1, num_found);
+    CHECK_EQUAL(6, found[0].m00);
+    CHECK_EQUAL((2 + 3 + 4) * 2, found[0].m10);
+    CHECK_EQUAL((4 + 5) * 3, found[0].m01);
+    CHECK_EQUAL((4 + 9 + 16) * 2, found[0].m20);
+    CHECK_EQUAL((16 + 25) * 3, found[0].m02);
+    CHECK_EQUAL((2 + 3 + 4) * (4 + 5), found[0].m11);
+    CHECK_EQUAL(2, found[0].x_min);
+    CHECK_EQUAL(4, found[0].x_max);
+    CHECK_EQUAL(4, found[0].y_min);
+    CHECK_EQUAL(5, found[0].y_max);
+}
+
+TEST(RleCCTestGroup, RegionsAreReportedOnceComplete)
+{
+    image[0][0] = 1;
+    image[5][0] = 1;
+
+    rle_cc_add_run(&cc, 0, 0, 1);
+    rle_cc_end_row(&cc);
+    CHECK_EQUAL(0, num_found);
+    rle_cc_end_row(&cc);
+    CHECK_EQUAL(1, num_found);
+    rle_cc_end_frame(&cc);
+    CHECK_EQUAL(1, num_found);
+}
+
+TEST(RleCCTestGroup, SpiralNeedsLateMerges)
+{
+    /* The arms of the U and the inner bar are only joined by the last
+     * row, after being opened as three separate regions. */
+    int y;
+
+    for (y = 0; y < 10; y++) {
+        image[y][0] = 1;
+        image[y][10] = 1;
+        image[y][20] = 1;
+    }
+    for (y = 0; y <= 20; y++) {
+        image[10][y] = 1;
+    }
+    run(H);
+
+    CHECK_EQUAL(1, num_found);
+    CHECK_EQUAL(30 + 21, found[0].m00);
+}
+
+TEST(RleCCTestGroup, MatchesFloodFill)
+{
+    static rle_cc_stats_t expected[MAX_RESULTS];
+    int seed, n;
+
+    for (seed = 1; seed < 20; seed++) {
+        reset();
+        random_image(seed, 1 + seed % 3, 30 + seed * 2);
+        run(H);
+        n = reference(expected);
+
+        CHECK_TRUE(complete);
+        CHECK_EQUAL(n, num_found);
+        qsort(found, num_found, sizeof(found[0]), compare_stats);
+        MEMCMP_EQUAL(expected, found, n * sizeof(found[0]));
+    }
+}
+
+TEST(RleCCTestGroup, FramesAreIndependent)
+{
+    static rle_cc_stats_t expected[MAX_RESULTS];
+    int n;
+
+    random_image(42, 2, 50);
+    run(H);
+    n = reference(expected);
+
+    /* The second frame starts cleanly after the first one. */
+    num_found = 0;
+    run(H);
+    CHECK_EQUAL(n, num_found);
+    qsort(found, num_found, sizeof(found[0]), compare_stats);
+    MEMCMP_EQUAL(expected, found, n * sizeof(found[0]));
+}
+
+TEST(RleCCTestGroup, FullRegionTableDropsRuns)
+{
+    int x;
+
+    CHECK_TRUE(rle_cc_init(&cc, arena, sizeof(arena), W, 4, collect, NULL));
+    for (x = 0; x < W; x += 2) {
+        image[0][x] = 1;
+    }
+    run(1);
+
+    CHECK_FALSE(complete);
+    CHECK_EQUAL(4, num_found);
+
+    /* The next frame is not affected. */
+    memset(image, 0, sizeof(image));
+    image[0][0] = 1;
+    run(1);
+    CHECK_TRUE(complete);
+}
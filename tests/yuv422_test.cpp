@@ -0,0 +1,92 @@
+#include <CppUTest/TestHarness.h>
+#include <string.h>
+#include "vision/yuv422.h"
+#include "random_fill.h"
+
+#define PIXELS 37
+
+TEST_GROUP(YUV422TestGroup)
+{
+    uint8_t src[2 * PIXELS + 1];
+    uint8_t y[PIXELS + 1], y_ref[PIXELS + 1];
+    uint8_t u[PIXELS / 2 + 1], u_ref[PIXELS / 2 + 1];
+    uint8_t v[PIXELS / 2 + 1], v_ref[PIXELS / 2 + 1];
+
+    void setup()
+    {
+        random_fill(src, sizeof(src), 12345);
+        memset(y, 0xaa, sizeof(y));
+        memset(y_ref, 0xaa, sizeof(y_ref));
+        memset(u, 0xaa, sizeof(u));
+        memset(u_ref, 0xaa, sizeof(u_ref));
+        memset(v, 0xaa, sizeof(v));
+        memset(v_ref, 0xaa, sizeof(v_ref));
+    }
+};
+
+TEST(YUV422TestGroup, ReferenceGrayTakesEvenBytes)
+{
+    const uint8_t pixels[] = {10, 128, 20, 130, 30, 127, 40, 129};
+
+    yuv422_to_gray_ref(pixels, y, 4);
+    CHECK_EQUAL(10, y[0]);
+    CHECK_EQUAL(20, y[1]);
+    CHECK_EQUAL(30, y[2]);
+    CHECK_EQUAL(40, y[3]);
+}
+
+TEST(YUV422TestGroup, ReferencePlanarSplitsChroma)
+{
+    const uint8_t pixels[] = {10, 1, 20, 2, 30, 3, 40, 4};
+
+    yuv422_to_planar_ref(pixels, y, u, v, 4);
+    CHECK_EQUAL(20, y[1]);
+    CHECK_EQUAL(40, y[3]);
+    CHECK_EQUAL(1, u[0]);
+    CHECK_EQUAL(3, u[1]);
+    CHECK_EQUAL(2, v[0]);
+    CHECK_EQUAL(4, v[1]);
+}
+
+TEST(YUV422TestGroup, GrayMatchesReference)
+{
+    unsigned n;
+
+    /* Every length exercises a different tail. */
+    for (n = 0; n <= PIXELS; n++) {
+        yuv422_to_gray_ref(src, y_ref, n);
+        yuv422_to_gray(src, y, n);
+        MEMCMP_EQUAL(y_ref, y, sizeof(y));
+    }
+}
+
+TEST(YUV422TestGroup, GrayWorksOnUnalignedBuffers)
+{
+    yuv422_to_gray_ref(&src[1], &y_ref[1], PIXELS - 1);
+    yuv422_to_gray(&src[1], &y[1], PIXELS - 1);
+    MEMCMP_EQUAL(y_ref, y, sizeof(y));
+}
+
+TEST(YUV422TestGroup, PlanarMatchesReference)
+{
+    unsigned n;
+
+    for (n = 0; n <= PIXELS; n += 2) {
+        yuv422_to_planar_ref(src, y_ref, u_ref, v_ref, n);
+        yuv422_to_planar(src, y, u, v, n);
+        MEMCMP_EQUAL(y_ref, y, sizeof(y));
+        MEMCMP_EQUAL(u_ref, u, sizeof(u));
+        MEMCMP_EQUAL(v_ref, v, sizeof(v));
+    }
+}
+
+TEST(YUV422TestGroup, PlanarSkipsMissingPlanes)
+{
+    yuv422_to_planar_ref(src, y_ref, NULL, v_ref, 32);
+    yuv422_to_planar(src, y, NULL, v, 32);
+    MEMCMP_EQUAL(y_ref, y, sizeof(y));
+    MEMCMP_EQUAL(v_ref, v, sizeof(v));
+
+    yuv422_to_planar(src, y, NULL, NULL, 32);
+    MEMCMP_EQUAL(y_ref, y, sizeof(y));
+}
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+"""
+Generates src/vision/lut_tables.c, the standard tone curves of lut.h.
+
+The tables are committed, run this script again after changing a curve:
+
+    python3 tools/lut_tables.py > src/vision/lut_tables.c
+"""
+
+import math
+
+
+def gamma(g):
+    return lambda x: x ** g
+
+
+def s_curve(gain):
+    """Logistic contrast curve through (0, 0), (0.5, 0.5) and (1, 1)."""
+    low = 1 / (1 + math.exp(gain / 2))
+    high = 1 / (1 + math.exp(-gain / 2))
+    return lambda x: (1 / (1 + math.exp(-gain * (x - 0.5))) - low) / (high - low)
+
+
+TABLES = [
+    ("lut_gamma_0_45", "Gamma 1 / 2.2, brightens the shadows.", gamma(1 / 2.2)),
+    ("lut_gamma_2_2", "Gamma 2.2, darkens the shadows.", gamma(2.2)),
+    ("lut_s_curve", "Logistic S-curve, raises the mid-tone contrast.", s_curve(8)),
+]
+
+
+def table(curve):
+    values = [int(math.floor(255 * curve(i / 255) + 0.5)) for i in range(256)]
+    lines = []
+    for row in range(0, 256, 16):
+        lines.append("    " + ", ".join("{:3d}".format(v) for v in values[row:row + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    print("/* Generated by tools/lut_tables.py, do not edit. */")
+    print()
+    print('#include "lut.h"')
+    for name, doc, curve in TABLES:
+        print()
+        print("/* {} */".format(doc))
+        print("const uint8_t {}[LUT_SIZE] = {{".format(name))
+        print(table(curve))
+        print("};")
+
+
+if __name__ == "__main__":
+    main()